@@ -0,0 +1,306 @@
+/*
+ * alloc.c - Allocation profiler
+ *
+ * Built with make ALLOCPROF=1 (-DGW_ALLOCPROF), gwbasic.h turns every
+ * malloc, calloc, realloc and free in the interpreter into a call to
+ * the functions here, passing the file and line of the call.  Each
+ * block gets a small header recording its size, the call site and the
+ * BASIC line that was running, so frees are charged back to where the
+ * block came from.  For every call site and every BASIC line the
+ * profiler keeps the number of allocations, the bytes allocated, the
+ * bytes live now and the peak of live bytes, and prints both tables on
+ * stderr at exit, largest first.
+ *
+ * Without GW_ALLOCPROF this file is empty.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#ifdef GW_ALLOCPROF
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#define MAXSITES 1024       /* Distinct call sites (open addressing) */
+#define MAXLINES 65537      /* Line numbers, and one slot for direct mode */
+#define ALLOC_ROWS 40       /* BASIC lines shown */
+
+/* Totals for a call site or a BASIC line */
+typedef struct {
+    const char *file;       /* Call site, NULL if the slot is free */
+    int line;
+    long count;             /* Allocations */
+    long bytes;             /* Bytes allocated */
+    long live;              /* Bytes allocated and not yet freed */
+    long peak;              /* Most bytes live at once */
+} alloc_site_t;
+
+/* In front of every block - 16 bytes keeps the data aligned */
+typedef struct {
+    unsigned long size;
+    int site;               /* Index into sites[] */
+    int basline;            /* Index into lines[] */
+} alloc_hdr_t;
+
+static alloc_site_t sites[MAXSITES];
+static alloc_site_t lines[MAXLINES];
+static alloc_site_t total;
+static int started;
+
+#if defined(GW_THREADS) && defined(__GNUC__)
+/* PARALLEL FOR workers allocate too */
+static volatile int lock;
+#define LOCK() while (__sync_lock_test_and_set(&lock, 1)) { }
+#define UNLOCK() __sync_lock_release(&lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+static void alloc_report();
+
+/*
+ * Slot of a call site
+ */
+static int
+site_index(file, line)
+const char *file;
+int line;
+{
+    unsigned long h;
+    int i;
+    int n;
+
+    h = ((unsigned long)file >> 3) * 31UL + (unsigned long)line;
+    i = (int)(h % MAXSITES);
+    for (n = 0; n < MAXSITES; n++) {
+        if (!sites[i].file) {
+            sites[i].file = file;
+            sites[i].line = line;
+            return i;
+        }
+        if (sites[i].file == file && sites[i].line == line) {
+            return i;
+        }
+        i = (i + 1) % MAXSITES;
+    }
+    return 0;
+}
+
+/*
+ * Add (or with a negative size, remove) a block
+ */
+static void
+account(s, size, isnew)
+alloc_site_t *s;
+long size;
+int isnew;
+{
+    if (isnew) {
+        s->count++;
+        s->bytes += size;
+    }
+    s->live += size;
+    if (s->live > s->peak) {
+        s->peak = s->live;
+    }
+}
+
+/*
+ * Charge a block to the call site and the running BASIC line
+ */
+static void *
+track(p, size, file, line)
+alloc_hdr_t *p;
+unsigned long size;
+const char *file;
+int line;
+{
+    int k;
+
+    if (!p) {
+        return NULL;
+    }
+    LOCK();
+    if (!started) {
+        started = 1;
+        atexit(alloc_report);
+    }
+    p->size = size;
+    p->site = site_index(file, line);
+    k = g_state && g_state->running && g_state->curlin >= 0 ?
+        g_state->curlin : MAXLINES - 1;
+    p->basline = k < MAXLINES ? k : MAXLINES - 1;
+    account(&sites[p->site], (long)size, 1);
+    account(&lines[p->basline], (long)size, 1);
+    account(&total, (long)size, 1);
+    UNLOCK();
+    return (void *)(p + 1);
+}
+
+/*
+ * Take a block off the books
+ */
+static void
+untrack(p)
+alloc_hdr_t *p;
+{
+    LOCK();
+    account(&sites[p->site], -(long)p->size, 0);
+    account(&lines[p->basline], -(long)p->size, 0);
+    account(&total, -(long)p->size, 0);
+    UNLOCK();
+}
+
+void *
+alloc_malloc(size, file, line)
+unsigned long size;
+const char *file;
+int line;
+{
+    return track((alloc_hdr_t *)malloc(sizeof(alloc_hdr_t) + size),
+                 size, file, line);
+}
+
+void *
+alloc_calloc(n, size, file, line)
+unsigned long n;
+unsigned long size;
+const char *file;
+int line;
+{
+    return track((alloc_hdr_t *)calloc(1, sizeof(alloc_hdr_t) + n * size),
+                 n * size, file, line);
+}
+
+void *
+alloc_realloc(old, size, file, line)
+void *old;
+unsigned long size;
+const char *file;
+int line;
+{
+    alloc_hdr_t *p;
+
+    if (!old) {
+        return alloc_malloc(size, file, line);
+    }
+    p = (alloc_hdr_t *)old - 1;
+    untrack(p);
+    p = (alloc_hdr_t *)realloc((void *)p, sizeof(alloc_hdr_t) + size);
+    if (!p) {
+        /* The old block is still there */
+        p = (alloc_hdr_t *)old - 1;
+        LOCK();
+        account(&sites[p->site], (long)p->size, 0);
+        account(&lines[p->basline], (long)p->size, 0);
+        account(&total, (long)p->size, 0);
+        UNLOCK();
+        return NULL;
+    }
+    return track(p, size, file, line);
+}
+
+void
+alloc_free(ptr)
+void *ptr;
+{
+    alloc_hdr_t *p;
+
+    if (!ptr) {
+        return;
+    }
+    p = (alloc_hdr_t *)ptr - 1;
+    untrack(p);
+    free((void *)p);
+}
+
+/*
+ * Order slots by bytes allocated
+ */
+static int
+by_bytes(a, b)
+const void *a;
+const void *b;
+{
+    const alloc_site_t *x;
+    const alloc_site_t *y;
+
+    x = *(const alloc_site_t **)a;
+    y = *(const alloc_site_t **)b;
+    if (x->bytes != y->bytes) {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return x->count < y->count ? 1 : (x->count > y->count ? -1 : 0);
+}
+
+/*
+ * Print the tables (run by atexit)
+ */
+static void
+alloc_report()
+{
+    alloc_site_t **order;
+    const char *base;
+    char where[64];
+    int n;
+    int i;
+
+    order = (alloc_site_t **)malloc(MAXLINES * sizeof(alloc_site_t *));
+    if (!order) {
+        return;
+    }
+    fflush(stdout);
+    fprintf(stderr, "\nAllocations: %ld, %ld bytes, peak %ld bytes live, "
+            "%ld bytes live at exit\n",
+            total.count, total.bytes, total.peak, total.live);
+
+    n = 0;
+    for (i = 0; i < MAXSITES; i++) {
+        if (sites[i].file && sites[i].count > 0) {
+            order[n++] = &sites[i];
+        }
+    }
+    qsort((void *)order, (size_t)n, sizeof(alloc_site_t *), by_bytes);
+    fprintf(stderr, "%-24s %10s %12s %12s %12s\n",
+            "call site", "count", "bytes", "peak live", "live");
+    for (i = 0; i < n; i++) {
+        base = strrchr(order[i]->file, '/');
+        sprintf(where, "%.50s:%d", base ? base + 1 : order[i]->file,
+                order[i]->line);
+        fprintf(stderr, "%-24s %10ld %12ld %12ld %12ld\n", where,
+                order[i]->count, order[i]->bytes, order[i]->peak,
+                order[i]->live);
+    }
+
+    n = 0;
+    for (i = 0; i < MAXLINES; i++) {
+        if (lines[i].count > 0) {
+            lines[i].line = i;
+            order[n++] = &lines[i];
+        }
+    }
+    qsort((void *)order, (size_t)n, sizeof(alloc_site_t *), by_bytes);
+    fprintf(stderr, "\n%-24s %10s %12s %12s %12s\n",
+            "BASIC line", "count", "bytes", "peak live", "live");
+    for (i = 0; i < n && i < ALLOC_ROWS; i++) {
+        if (order[i]->line == MAXLINES - 1) {
+            strcpy(where, "(not running)");
+        } else {
+            sprintf(where, "%d", order[i]->line);
+        }
+        fprintf(stderr, "%-24s %10ld %12ld %12ld %12ld\n", where,
+                order[i]->count, order[i]->bytes, order[i]->peak,
+                order[i]->live);
+    }
+    if (n > ALLOC_ROWS) {
+        fprintf(stderr, "(%d more lines)\n", n - ALLOC_ROWS);
+    }
+    free((void *)order);
+}
+
+#endif /* GW_ALLOCPROF */
@@ -174,6 +174,7 @@ int nindices;
     long offset;      /* Use long for offset calculation */
     long multiplier;
 
+    STAT_INC(array_element);
     arr = find_array(name, 0);
     if (!arr) {
         error(ERR_SUBSCRIPT);
@@ -220,6 +221,9 @@ clear_arrays()
     array_t *next;
     int i;
 
+    /* Compiled code refers to the array data */
+    jit_release();
+
     for (arr = g_state->arrlist; arr != NULL; arr = next) {
         next = arr->next;
 
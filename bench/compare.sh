@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# compare.sh - Compare two result files written by bench/run.sh
+#
+# Prints each program's median time in both files and the speedup of
+# the second over the first (above 1 means the new version is faster),
+# followed by the geometric mean of the speedups.
+#
+# Usage: bench/compare.sh old.tsv new.tsv
+#
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 old.tsv new.tsv" >&2
+    exit 1
+fi
+
+awk -F'\t' '
+FNR == 1 { next }
+NR == FNR { old[$1] = $2; next }
+$1 in old {
+    if (!header) {
+        printf "%-12s %10s %10s %8s\n", "program", "old_s", "new_s", "speedup"
+        header = 1
+    }
+    r = $2 > 0 ? old[$1] / $2 : 0
+    printf "%-12s %10.4f %10.4f %8.2f\n", $1, old[$1], $2, r
+    if (r > 0) {
+        logsum += log(r)
+        n++
+    }
+}
+END {
+    if (n > 0) {
+        printf "%-12s %10s %10s %8.2f\n", "geomean", "", "", exp(logsum / n)
+    }
+}' "$1" "$2"
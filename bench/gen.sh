@@ -0,0 +1,115 @@
+#!/bin/sh
+#
+# gen.sh - Generate a large synthetic BASIC program
+#
+# Writes to standard output a program of about LINES lines that runs
+# straight through a body of assignments over VARS variables, with a
+# share of GOTO and GOSUB statements and DATA lines spread through it,
+# then times REPS calls of a subroutine on the very last line.  It
+# prints what it measured:
+#
+#   body_us    microseconds per body line
+#   gosub_us   microseconds per GOSUB and RETURN to the last line
+#
+# READ is not implemented yet, so the DATA lines only add program text
+# to load and to step over.
+#
+# With -e the program ENDs on its second line, so running it times
+# little more than LOAD.  bench/scale.sh runs these over a range of
+# sizes.
+#
+# Line numbers are 16-bit, so LINES is at most 65000; programs beyond
+# 64K bytes need GWBASIC_MEM set (see bench/scale.sh).
+#
+# Usage: bench/gen.sh [-l lines] [-v vars] [-j goto%] [-s gosub%]
+#                     [-d datalines] [-r reps] [-e] > prog.bas
+#
+
+LINES=1000
+VARS=100
+JUMPS=5
+SUBS=5
+DATA=10
+REPS=1000
+EARLY=0
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -l) LINES=$2; shift ;;
+        -v) VARS=$2; shift ;;
+        -j) JUMPS=$2; shift ;;
+        -s) SUBS=$2; shift ;;
+        -d) DATA=$2; shift ;;
+        -r) REPS=$2; shift ;;
+        -e) EARLY=1 ;;
+        *)
+            echo "Usage: $0 [-l lines] [-v vars] [-j goto%] [-s gosub%]" \
+                "[-d datalines] [-r reps] [-e]" >&2
+            exit 1
+            ;;
+    esac
+    shift
+done
+
+if [ "$LINES" -lt 20 ] || [ "$LINES" -gt 65000 ] || [ "$VARS" -lt 1 ]; then
+    echo "$0: lines must be 20 to 65000, vars at least 1" >&2
+    exit 1
+fi
+
+awk -v lines=$LINES -v vars=$VARS -v jumps=$JUMPS -v subs=$SUBS \
+    -v data=$DATA -v reps=$REPS -v early=$EARLY '
+# Emit the next line
+function out(text) {
+    print n " " text
+    n += step
+}
+BEGIN {
+    srand(1)
+    step = int(65000 / lines)
+    if (step > 10) step = 10
+    n = step
+
+    # Subroutines, about one per ten GOSUBs, follow the body and the
+    # 8 timing lines; the last line is a bare RETURN
+    nsub = int(lines * subs / 1000) + 1
+    head = 2 + early
+    body = lines - head - 8 - nsub - 1
+    first = (head + body + 8 + 1) * step
+    last = (head + body + 8 + nsub + 1) * step
+    every = int(body / (data + 1))
+
+    out("REM lines=" lines " vars=" vars " goto=" jumps "% gosub=" \
+        subs "% data=" data)
+    if (early) out("END")
+    out("T0# = TIMER")
+
+    # Body: assignments, GOTO the next line, GOSUB and DATA
+    placed = 0
+    for (k = 1; k <= body; k++) {
+        if (placed < data && k % every == 0) {
+            out("DATA 1,2,3,4,5,6,7,8")
+            placed++
+        } else if ((r = rand() * 100) < jumps) {
+            out("GOTO " (n + step))
+        } else if (r < jumps + subs) {
+            out("GOSUB " (first + int(rand() * nsub) * step))
+        } else {
+            out("V" int(rand() * vars) " = V" int(rand() * vars) " + 1")
+        }
+    }
+
+    # Time calls to the last line, less an empty loop
+    out("T1# = TIMER")
+    out("FOR K = 1 TO " reps ": GOSUB " last ": NEXT K")
+    out("T2# = TIMER")
+    out("FOR K = 1 TO " reps ": NEXT K")
+    out("T3# = TIMER")
+    out("PRINT \"body_us \"; (T1# - T0#) / " body " * 1000000")
+    out("PRINT \"gosub_us \"; ((T2# - T1#) - (T3# - T2#)) / " reps \
+        " * 1000000")
+    out("END")
+    for (i = 0; i < nsub; i++) {
+        out("V" (i % vars) " = V" (i % vars) " - 1: RETURN")
+    }
+    out("RETURN")
+}'
@@ -0,0 +1,30 @@
+#!/bin/sh
+#
+# jit.sh - Compare the interpreter with and without the template JIT
+#
+# Runs each benchmark program with GWBASIC_JIT=0 and with the JIT on,
+# checks that both print the same result and reports the speedup.
+#
+# Usage: bench/jit.sh [program.bas ...]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+PROGS=${*:-"bench/jit_loop.bas bench/jit_sieve.bas bench/jit_mandel.bas"}
+
+run() {
+    start=`date +%s.%N`
+    GWBASIC_JIT=$1 $GWBASIC $2 > /tmp/jit_bench.$$.$1
+    end=`date +%s.%N`
+    awk "BEGIN { print $end - $start }"
+}
+
+echo "program              interp     jit  speedup"
+for prog in $PROGS; do
+    slow=`run 0 $prog`
+    fast=`run 50 $prog`
+    if ! cmp -s /tmp/jit_bench.$$.0 /tmp/jit_bench.$$.50; then
+        echo "$prog: output differs"
+    fi
+    rm -f /tmp/jit_bench.$$.*
+    awk "BEGIN { printf \"%-18s %8.3f %7.3f %8.1f\\n\", \"`basename $prog`\", $slow, $fast, $slow / $fast }"
+done
@@ -0,0 +1,6 @@
+10 REM Tight numeric loop: accumulate a polynomial
+20 S# = 0
+30 FOR I = 1 TO 2000000
+40 S# = S# + I * I - 3 * I
+50 NEXT I
+60 PRINT S#
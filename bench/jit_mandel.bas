@@ -0,0 +1,13 @@
+10 REM Mandelbrot iteration counts over a 120x60 grid
+20 T = 0
+30 FOR Y = 0 TO 59
+40 FOR X = 0 TO 119
+50 CR = X / 40 - 2: CI = Y / 30 - 1
+60 ZR = 0: ZI = 0: K% = 0
+70 Z2 = ZR * ZR - ZI * ZI + CR: ZI = 2 * ZR * ZI + CI: ZR = Z2
+80 K% = K% + 1
+90 IF K% < 200 AND ZR * ZR + ZI * ZI < 4 THEN 70
+100 T = T + K%
+110 NEXT X
+120 NEXT Y
+130 PRINT T
@@ -0,0 +1,13 @@
+10 REM Sieve of Eratosthenes, repeated
+20 N% = 8190
+30 DIM F%(16380)
+40 FOR R = 1 TO 20
+50 C% = 0
+60 FOR I = 2 TO N%: F%(I) = 1: NEXT I
+70 FOR I = 2 TO N%
+80 IF F%(I) = 0 THEN 120
+90 C% = C% + 1
+100 FOR K = I + I TO N% STEP I: F%(K) = 0: NEXT K
+120 NEXT I
+130 NEXT R
+140 PRINT C%
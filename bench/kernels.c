@@ -0,0 +1,46 @@
+/*
+ * kernels.c - Sample native kernels for USR benchmarks
+ *
+ * Build: make bench/libkernels.so
+ */
+
+/* Does nothing - measures the bare USR dispatch cost */
+double
+ident(x)
+double x;
+{
+    return x;
+}
+
+/* Sum the first n elements of a double (#) array */
+double
+sum_array(a, n)
+double *a;
+long n;
+{
+    double s;
+    long i;
+
+    s = 0.0;
+    for (i = 0; i < n; i++) {
+        s += a[i];
+    }
+    return s;
+}
+
+/* Adler-32 style checksum of a string */
+long
+checksum(s)
+const char *s;
+{
+    unsigned long a;
+    unsigned long b;
+
+    a = 1;
+    b = 0;
+    while (*s) {
+        a = (a + (unsigned char)*s++) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (long)((b << 16) | a);
+}
@@ -0,0 +1,451 @@
+/*
+ * micro.c - Microbenchmarks for the interpreter's primitives
+ *
+ * Links the interpreter objects (main.c built with GW_NO_MAIN) and
+ * times the routines whole programs spend their time in, one at a
+ * time: tokenizing and listing lines, evaluating expressions, variable
+ * and array lookup, string allocation and program line insertion.
+ *
+ * Each case runs in a loop long enough to take about 20 ms; the best
+ * of five such runs is reported in nanoseconds and in clock_cycles()
+ * ticks per operation.  Cases that allocate free what they allocate,
+ * so the cost of free() is included.
+ *
+ * Usage: bench/micro [case-prefix]    (make microbench)
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#define REPEATS 5           /* Runs per case, the best one counts */
+#define TARGET_SECS 0.02    /* Length of one run */
+
+/* Program lines (without line numbers) for the tokenizer */
+static const char *corpus[] = {
+    "PRINT \"HELLO, WORLD\"; X; Y$",
+    "FOR I = 1 TO 100 STEP 2: A(I) = I * I: NEXT I",
+    "IF X > 10 AND Y$ = \"YES\" THEN GOSUB 1000 ELSE 40",
+    "Z# = SQR(X * X + Y * Y) / 2.5E3 - INT(RND(1) * 6)",
+    "B$ = LEFT$(A$, 3) + MID$(A$, 5, 2) + CHR$(65 + I MOD 26)",
+    "REM A comment line that is only copied",
+    "DATA 1, 2, 3, \"FOUR\", 5.5",
+    "WHILE K% < 1000: K% = K% + 1: WEND",
+    NULL
+};
+
+/* Case names and expressions for eval_expr, variables set in main() */
+static const char *exprs[] = {
+    "eval const", "1 + 2 * 3 - 4 / 5",
+    "eval vars", "A * 2 + B / 3 - C",
+    "eval func", "SQR(A * A + B * B) + INT(C)",
+    "eval compare", "(A > B) AND (C <= 4) OR NOT (A = C)",
+    "eval integer", "I% * 3 + J% \\ 2 - I% MOD 7",
+    "eval string", "LEFT$(S$, 3) + T$",
+    NULL
+};
+
+/* Tokenized lines, for detokenize and insert */
+static unsigned char *tokens[16];
+static int toklens[16];
+static int ntokens;
+
+/* Operands of the current case */
+static unsigned char *expr;
+static char names[1000][8];
+static int nnames;
+static int indices[3];
+static string_t *str1;
+static string_t *str2;
+static int nlines;
+
+/* Keeps the compiler from optimizing work away */
+static volatile long sink;
+
+/*
+ * Tokenize one corpus line per operation
+ */
+static void
+op_tokenize(n)
+long n;
+{
+    unsigned char *t;
+    long i;
+    int len;
+
+    for (i = 0; i < n; i++) {
+        t = tokenize_line(corpus[i % ntokens], &len);
+        sink += len;
+        free(t);
+    }
+}
+
+/*
+ * List one tokenized corpus line per operation
+ */
+static void
+op_detokenize(n)
+long n;
+{
+    char *s;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        s = detokenize_line(tokens[i % ntokens]);
+        sink += s[0];
+        free(s);
+    }
+}
+
+/*
+ * Evaluate the current expression
+ */
+static void
+op_eval(n)
+long n;
+{
+    value_t v;
+    long i;
+    int type;
+
+    for (i = 0; i < n; i++) {
+        g_state->txtptr = expr;
+        v = eval_expr(&type);
+        if (type == TYPE_STR) {
+            sink += v.strval->len;
+            free_string(v.strval);
+        } else {
+            sink += type;
+        }
+    }
+}
+
+/*
+ * Look up the variables in turn, missing the lastvar cache
+ */
+static void
+op_find_variable(n)
+long n;
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        sink += find_variable(names[i % nnames], 0)->type;
+    }
+}
+
+/*
+ * Look up the same variable, hitting the lastvar cache
+ */
+static void
+op_find_cached(n)
+long n;
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        sink += find_variable(names[0], 0)->type;
+    }
+}
+
+/*
+ * Read an element of a 1-D array, stepping through the indices
+ */
+static void
+op_array1(n)
+long n;
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        indices[0] = (int)(i & 1023);
+        sink += (long)array_element("A", indices, 1)->sngval;
+    }
+}
+
+/*
+ * Read an element of a 3-D array
+ */
+static void
+op_array3(n)
+long n;
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        indices[0] = (int)(i & 15);
+        indices[1] = (int)((i >> 4) & 15);
+        indices[2] = (int)((i >> 8) & 15);
+        sink += (long)array_element("B", indices, 3)->sngval;
+    }
+}
+
+/*
+ * Allocate and free a 16-byte string
+ */
+static void
+op_alloc(n)
+long n;
+{
+    string_t *s;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        s = alloc_string(16);
+        sink += s->len;
+        free_string(s);
+    }
+}
+
+/*
+ * Concatenate two 16-byte strings
+ */
+static void
+op_concat(n)
+long n;
+{
+    string_t *s;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        s = concat_strings(str1, str2);
+        sink += s->len;
+        free_string(s);
+    }
+}
+
+/*
+ * Copy a 64-byte string
+ */
+static void
+op_copy(n)
+long n;
+{
+    string_t *s;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        s = copy_string(str1);
+        sink += s->len;
+        free_string(s);
+    }
+}
+
+/*
+ * Insert a line in the middle of the program and delete it again
+ */
+static void
+op_insert(n)
+long n;
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        insert_line(nlines * 5 + 1, tokens[1], toklens[1]);
+        delete_line(nlines * 5 + 1);
+    }
+}
+
+/*
+ * Time one case and print its line
+ */
+static void
+run_case(name, fn)
+const char *name;
+void (*fn)();
+{
+    unsigned long c0;
+    unsigned long c1;
+    double t0;
+    double t1;
+    double best;
+    double bestcyc;
+    long n;
+    int r;
+
+    /* Find a count that runs for about TARGET_SECS */
+    n = 16;
+    for (;;) {
+        t0 = clock_mono();
+        (*fn)(n);
+        t1 = clock_mono();
+        if (t1 - t0 >= TARGET_SECS / 4 || n >= 100000000L) {
+            break;
+        }
+        n *= 4;
+    }
+    if (t1 - t0 > 0.0) {
+        n = (long)(n * TARGET_SECS / (t1 - t0)) + 1;
+    }
+
+    best = 0.0;
+    bestcyc = 0.0;
+    for (r = 0; r < REPEATS; r++) {
+        c0 = clock_cycles();
+        t0 = clock_mono();
+        (*fn)(n);
+        t1 = clock_mono();
+        c1 = clock_cycles();
+        if (r == 0 || t1 - t0 < best) {
+            best = t1 - t0;
+            bestcyc = (double)(c1 - c0);
+        }
+    }
+
+    printf("%-24s %10ld %10.1f", name, n, best * 1.0e9 / n);
+    if (bestcyc > 0.0) {
+        printf(" %10.1f\n", bestcyc / n);
+    } else {
+        printf(" %10s\n", "-");
+    }
+    fflush(stdout);
+}
+
+/*
+ * Set a variable from BASIC source
+ */
+static void
+let(src)
+const char *src;
+{
+    execute_direct((char *)src);
+}
+
+/*
+ * Replace the program with count lines "10 X = 1", "20 X = 1", ...
+ */
+static void
+make_program(count)
+int count;
+{
+    unsigned char *t;
+    char buf[32];
+    int len;
+    int i;
+
+    new_program();
+    for (i = 1; i <= count; i++) {
+        sprintf(buf, "X = %d", i);
+        t = tokenize_line(buf, &len);
+        insert_line(i * 10, t, len);
+        free(t);
+    }
+    nlines = count;
+}
+
+int
+main(argc, argv)
+int argc;
+char **argv;
+{
+    static int varsizes[] = {1, 10, 100, 1000, 0};
+    static int progsizes[] = {100, 1000, 3000, 0};
+    const char *only;
+    unsigned char *t;
+    char name[32];
+    int dims[3];
+    int len;
+    int i;
+    int k;
+
+    only = argc > 1 ? argv[1] : "";
+    init_state();
+
+    /* Variables for the expressions, set before our error trap since
+     * execute_direct() installs its own */
+    let("A = 3.5");
+    let("B = -2");
+    let("C = 7");
+    let("I% = 1234");
+    let("J% = 56");
+    let("S$ = \"ABCDEFGH\"");
+    let("T$ = \"XYZ\"");
+    if (setjmp(g_state->errtrap)) {
+        fprintf(stderr, "micro: %s\n", error_message(g_state->errnum));
+        return 1;
+    }
+
+    for (ntokens = 0; corpus[ntokens]; ntokens++) {
+        t = tokenize_line(corpus[ntokens], &len);
+        tokens[ntokens] = t;
+        toklens[ntokens] = len;
+    }
+
+    printf("%-24s %10s %10s %10s\n", "case", "ops", "ns/op", "cycles/op");
+
+#define WANT(s) (strncmp((s), only, strlen(only)) == 0)
+
+    if (WANT("tokenize")) {
+        run_case("tokenize_line", op_tokenize);
+    }
+    if (WANT("detokenize")) {
+        run_case("detokenize_line", op_detokenize);
+    }
+
+    for (i = 0; exprs[i]; i += 2) {
+        if (WANT(exprs[i])) {
+            expr = tokenize_line(exprs[i + 1], &len);
+            run_case(exprs[i], op_eval);
+            free(expr);
+        }
+    }
+
+    for (k = 0; varsizes[k]; k++) {
+        clear_variables();
+        for (nnames = 0; nnames < varsizes[k]; nnames++) {
+            sprintf(names[nnames], "V%d", nnames);
+            find_variable(names[nnames], 1);
+        }
+        sprintf(name, "find_variable %d", varsizes[k]);
+        if (WANT(name)) {
+            run_case(name, nnames > 1 ? op_find_variable : op_find_cached);
+        }
+        if (varsizes[k] == 1000 && WANT("find_variable cached")) {
+            run_case("find_variable cached", op_find_cached);
+        }
+    }
+    clear_variables();
+
+    dims[0] = 1024;
+    dimension_array("A", dims, 1, TYPE_SNG);
+    dims[0] = dims[1] = dims[2] = 16;
+    dimension_array("B", dims, 3, TYPE_SNG);
+    if (WANT("array_element 1-D")) {
+        run_case("array_element 1-D", op_array1);
+    }
+    if (WANT("array_element 3-D")) {
+        run_case("array_element 3-D", op_array3);
+    }
+    clear_arrays();
+
+    str1 = string_from_cstr("ABCDEFGHIJKLMNOP");
+    str2 = string_from_cstr("QRSTUVWXYZ012345");
+    if (WANT("alloc_string")) {
+        run_case("alloc_string", op_alloc);
+    }
+    if (WANT("concat_strings")) {
+        run_case("concat_strings", op_concat);
+    }
+    free_string(str1);
+    str1 = string_from_cstr(
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyz!?");
+    if (WANT("copy_string")) {
+        run_case("copy_string", op_copy);
+    }
+    free_string(str1);
+    free_string(str2);
+
+    for (k = 0; progsizes[k]; k++) {
+        sprintf(name, "insert_line %d", progsizes[k]);
+        if (WANT(name)) {
+            make_program(progsizes[k]);
+            run_case(name, op_insert);
+        }
+    }
+
+    for (i = 0; i < ntokens; i++) {
+        free(tokens[i]);
+    }
+    cleanup();
+    return 0;
+}
@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+# parallel.sh - Measure PARALLEL FOR scaling from 1 to N threads
+#
+# Usage: bench/parallel.sh [max-threads]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+PROG=${PROG:-bench/parallel_for.bas}
+MAX=${1:-`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4`}
+
+echo "threads seconds speedup"
+base=""
+t=1
+while [ $t -le $MAX ]; do
+    start=`date +%s.%N`
+    GWBASIC_THREADS=$t $GWBASIC $PROG > /dev/null
+    end=`date +%s.%N`
+    secs=`awk "BEGIN { print $end - $start }"`
+    if [ -z "$base" ]; then
+        base=$secs
+    fi
+    awk "BEGIN { printf \"%7d %7.3f %7.2f\\n\", $t, $secs, $base / $secs }"
+    t=`expr $t \* 2`
+done
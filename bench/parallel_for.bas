@@ -0,0 +1,15 @@
+10 REM PARALLEL FOR scaling benchmark
+20 REM Each iteration does independent work and fills one element
+30 N = 4000
+40 DIM A(4000)
+50 S = 0
+60 FOR I = 0 TO N PARALLEL REDUCE S
+70 X = 0
+80 FOR K = 1 TO 100
+90 X = X + SIN(I * K) * COS(K)
+100 NEXT K
+110 A(I) = X
+120 S = S + X
+130 NEXT I
+140 PRINT "SUM"; S
+150 END
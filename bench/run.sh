@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# run.sh - Run the benchmark suite and record the results
+#
+# Runs each program in bench/suite RUNS times and reports the median
+# wall time.  When GWBASIC_STATS names a gwbasic built with STATS=1,
+# each program is run once more under it (with the JIT off) to count
+# the statements it executes; statements per second is that count over
+# the wall time of the same counting run, not the median above.
+#
+# The results are tab-separated, one line per program, and go to
+# standard output and to BENCH_OUT:
+#
+#   program  median_s  statements  stmts_per_s  runs
+#
+# bench/compare.sh compares two such files.
+#
+# Usage: bench/run.sh [program.bas ...]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+RUNS=${RUNS:-5}
+BENCH_OUT=${BENCH_OUT:-bench/results.tsv}
+PROGS=${*:-`ls bench/suite/*.bas`}
+TMP=/tmp/gw_bench.$$
+
+# Wall time of one run in seconds
+run() {
+    start=`date +%s.%N`
+    $GWBASIC $1 > /dev/null
+    end=`date +%s.%N`
+    awk "BEGIN { printf \"%.6f\\n\", $end - $start }"
+}
+
+# Statements executed, summed from the counters' JSON, and the wall
+# time of the run that counted them
+count() {
+    if [ -z "$GWBASIC_STATS" ]; then
+        echo 0 0
+        return
+    fi
+    start=`date +%s.%N`
+    GWBASIC_JIT=0 $GWBASIC_STATS --stats $TMP.json $1 > /dev/null
+    end=`date +%s.%N`
+    sed -n 's/.*"statements": {\(.*\)}}.*/\1/p' $TMP.json |
+        tr ',' '\n' | awk -F': ' -v t="$start $end" '{ n += $2 }
+        END { split(t, s, " "); printf "%d %.6f\n", n, s[2] - s[1] }'
+}
+
+printf "program\tmedian_s\tstatements\tstmts_per_s\truns\n" > $TMP.tsv
+for prog in $PROGS; do
+    i=0
+    : > $TMP.times
+    while [ $i -lt $RUNS ]; do
+        run $prog >> $TMP.times
+        i=`expr $i + 1`
+    done
+    median=`sort -n $TMP.times | awk '{ t[NR] = $1 }
+        END { print NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2 }'`
+    set -- `count $prog`
+    stmts=$1
+    counted=$2
+    name=`basename $prog .bas`
+    awk "BEGIN { printf \"%s\\t%.6f\\t%d\\t%.0f\\t%d\\n\", \"$name\",
+        $median, $stmts, ($counted > 0 ? $stmts / $counted : 0), $RUNS }" >> $TMP.tsv
+done
+
+cat $TMP.tsv
+cp $TMP.tsv $BENCH_OUT
+rm -f $TMP.*
@@ -0,0 +1,95 @@
+#!/bin/sh
+#
+# scale.sh - How the interpreter scales with program size
+#
+# Generates programs of growing size with bench/gen.sh and measures,
+# for each size:
+#
+#   load_s      wall time to start, LOAD the program and END (median)
+#   body_us     microseconds per line running straight through it
+#   gosub_us    microseconds per GOSUB/RETURN to the last line
+#   text_bytes  tokenized program text (MEMSTAT)
+#   data_bytes  variables, arrays and strings (MEMSTAT)
+#
+# The results go to standard output and SCALE_OUT as tab-separated
+# lines, followed by a text plot of each column against size, with the
+# growth exponent between neighbouring sizes: 1 is linear, 2 means
+# doubling the program quadruples the cost.
+#
+# SIZES lists the line counts, VARS the variables, GEN_OPTS further
+# bench/gen.sh options.
+#
+# Usage: bench/scale.sh
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+RUNS=${RUNS:-3}
+SIZES=${SIZES:-"1000 2000 4000 8000 16000 32000 64000"}
+VARS=${VARS:-100}
+SCALE_OUT=${SCALE_OUT:-bench/scale.tsv}
+TMP=/tmp/gw_scale.$$
+
+# Wall time of one run in seconds
+run() {
+    start=`date +%s.%N`
+    $GWBASIC $1 > /dev/null
+    end=`date +%s.%N`
+    awk "BEGIN { printf \"%.6f\\n\", $end - $start }"
+}
+
+printf "lines\tload_s\tbody_us\tgosub_us\ttext_bytes\tdata_bytes\n" > $TMP.tsv
+for n in $SIZES; do
+    sh bench/gen.sh -l $n -v $VARS $GEN_OPTS > $TMP.bas || exit 1
+    sh bench/gen.sh -l $n -v $VARS $GEN_OPTS -e > $TMP.end.bas
+    # Room for the program text, which the default 64K won't hold
+    GWBASIC_MEM=`expr $n \* 64 + 65536`
+    export GWBASIC_MEM
+
+    i=0
+    : > $TMP.times
+    while [ $i -lt $RUNS ]; do
+        run $TMP.end.bas >> $TMP.times
+        i=`expr $i + 1`
+    done
+    load=`sort -n $TMP.times | awk '{ t[NR] = $1 }
+        END { print NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2 }'`
+
+    $GWBASIC --memstat $TMP.bas > $TMP.out 2> $TMP.mem
+    awk -v n=$n -v load=$load '
+        FILENAME ~ /out$/ && $1 == "body_us" { body = $2 }
+        FILENAME ~ /out$/ && $1 == "gosub_us" { gosub = $2 }
+        FILENAME ~ /mem$/ && /^Program text:/ { text = $3 }
+        FILENAME ~ /mem$/ && /^(Variables|Arrays|Descriptors):/ { data += $2 }
+        END {
+            printf "%d\t%.6f\t%.3f\t%.3f\t%d\t%d\n", n, load, body, gosub,
+                text, data
+        }' $TMP.out $TMP.mem >> $TMP.tsv
+done
+
+cat $TMP.tsv
+cp $TMP.tsv $SCALE_OUT
+
+# One chart per column: bars relative to the largest value, and the
+# growth exponent from the previous size
+awk -F'\t' '
+NR == 1 { for (c = 2; c <= NF; c++) name[c] = $c; ncol = NF; next }
+{ n[NR] = $1; for (c = 2; c <= ncol; c++) v[NR, c] = $c; rows = NR }
+END {
+    for (c = 2; c <= ncol; c++) {
+        max = 0
+        for (r = 2; r <= rows; r++) if (v[r, c] > max) max = v[r, c]
+        printf "\n%s\n", name[c]
+        for (r = 2; r <= rows; r++) {
+            bar = ""
+            w = max > 0 ? int(v[r, c] / max * 50 + 0.5) : 0
+            for (k = 0; k < w; k++) bar = bar "#"
+            e = ""
+            if (r > 2 && v[r - 1, c] > 0 && v[r, c] > 0 && n[r] != n[r - 1]) {
+                g = log(v[r, c] / v[r - 1, c]) / log(n[r] / n[r - 1])
+                e = sprintf("x^%.2f", g)
+            }
+            printf "%7d %-50s %12s %s\n", n[r], bar, v[r, c], e
+        }
+    }
+}' $SCALE_OUT
+rm -f $TMP.*
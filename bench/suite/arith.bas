@@ -0,0 +1,8 @@
+100 REM Integer, single and double precision arithmetic
+110 I% = 0: S! = 0: D# = 0
+120 FOR N = 1 TO 50000
+130 I% = (I% + N MOD 7) \ 2
+140 S! = S! + N * 0.5 - I% / 3
+150 D# = D# + N * N / 7# - S! * 0.001
+160 NEXT N
+170 PRINT I%; S!; D#
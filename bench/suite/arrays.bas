@@ -0,0 +1,14 @@
+100 REM Array fill and bubble sort
+110 N = 300
+120 DIM A(300)
+130 X = 12345
+140 FOR I = 1 TO N
+150 X = X * 1103 + 12345: X = X - INT(X / 32768) * 32768
+160 A(I) = X
+170 NEXT I
+180 FOR I = 1 TO N - 1
+190 FOR J = 1 TO N - I
+200 IF A(J) > A(J + 1) THEN T = A(J): A(J) = A(J + 1): A(J + 1) = T
+210 NEXT J
+220 NEXT I
+230 PRINT A(1); A(N / 2); A(N)
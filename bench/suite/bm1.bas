@@ -0,0 +1,6 @@
+100 REM Rugg/Feldman BM1: empty FOR loop
+300 PRINT "S"
+400 FOR K = 1 TO 1000000
+500 NEXT K
+700 PRINT "E"
+800 END
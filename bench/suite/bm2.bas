@@ -0,0 +1,7 @@
+100 REM Rugg/Feldman BM2: IF/THEN loop
+300 PRINT "S"
+400 K = 0
+500 K = K + 1
+600 IF K < 100000 THEN 500
+700 PRINT "E"
+800 END
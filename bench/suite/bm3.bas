@@ -0,0 +1,8 @@
+100 REM Rugg/Feldman BM3: arithmetic on the loop variable
+300 PRINT "S"
+400 K = 0
+500 K = K + 1
+510 A = K / K * K + K - K
+600 IF K < 100000 THEN 500
+700 PRINT "E"
+800 END
@@ -0,0 +1,10 @@
+100 REM Rugg/Feldman BM5: BM4 plus a subroutine call
+300 PRINT "S"
+400 K = 0
+500 K = K + 1
+510 A = K / 2 * 3 + 4 - 5
+520 GOSUB 820
+600 IF K < 100000 THEN 500
+700 PRINT "E"
+800 END
+820 RETURN
@@ -0,0 +1,14 @@
+100 REM Rugg/Feldman BM7: BM6 plus array stores
+300 PRINT "S"
+400 K = 0
+430 DIM M(5)
+500 K = K + 1
+510 A = K / 2 * 3 + 4 - 5
+520 GOSUB 820
+530 FOR L = 1 TO 5
+535 M(L) = A
+540 NEXT L
+600 IF K < 20000 THEN 500
+700 PRINT "E"
+800 END
+820 RETURN
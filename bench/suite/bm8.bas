@@ -0,0 +1,10 @@
+100 REM Rugg/Feldman BM8: math functions
+300 PRINT "S"
+400 K = 0
+500 K = K + 1
+530 A = K ^ 2
+540 B = LOG(K)
+550 C = SIN(K)
+600 IF K < 50000 THEN 500
+700 PRINT "E"
+800 END
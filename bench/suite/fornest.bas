@@ -0,0 +1,10 @@
+100 REM Nested FOR/NEXT loops
+110 T = 0
+120 FOR I = 1 TO 80
+130 FOR J = 1 TO 80
+140 FOR K = 1 TO 80
+150 T = T + 1
+160 NEXT K
+170 NEXT J
+180 NEXT I
+190 PRINT T
@@ -0,0 +1,14 @@
+100 REM GOSUB-heavy code: nested subroutine calls
+110 T = 0
+120 FOR I = 1 TO 60000
+130 GOSUB 1000
+140 NEXT I
+150 PRINT T
+160 END
+1000 T = T + 1
+1010 GOSUB 2000
+1020 RETURN
+2000 IF T MOD 2 = 0 THEN GOSUB 3000
+2010 RETURN
+3000 T = T + 1
+3010 RETURN
@@ -0,0 +1,409 @@
+100 REM Deep GOTO table in a large program: 200 IF/GOTO dispatch lines
+110 REM and 200 targets, so every jump searches far through the text
+120 T = 0
+130 FOR I = 1 TO 5000
+140 K = I MOD 200
+150 GOTO 1000
+190 NEXT I
+195 PRINT T
+199 END
+1000 IF K = 0 THEN GOTO 5000
+1010 IF K = 1 THEN GOTO 5010
+1020 IF K = 2 THEN GOTO 5020
+1030 IF K = 3 THEN GOTO 5030
+1040 IF K = 4 THEN GOTO 5040
+1050 IF K = 5 THEN GOTO 5050
+1060 IF K = 6 THEN GOTO 5060
+1070 IF K = 7 THEN GOTO 5070
+1080 IF K = 8 THEN GOTO 5080
+1090 IF K = 9 THEN GOTO 5090
+1100 IF K = 10 THEN GOTO 5100
+1110 IF K = 11 THEN GOTO 5110
+1120 IF K = 12 THEN GOTO 5120
+1130 IF K = 13 THEN GOTO 5130
+1140 IF K = 14 THEN GOTO 5140
+1150 IF K = 15 THEN GOTO 5150
+1160 IF K = 16 THEN GOTO 5160
+1170 IF K = 17 THEN GOTO 5170
+1180 IF K = 18 THEN GOTO 5180
+1190 IF K = 19 THEN GOTO 5190
+1200 IF K = 20 THEN GOTO 5200
+1210 IF K = 21 THEN GOTO 5210
+1220 IF K = 22 THEN GOTO 5220
+1230 IF K = 23 THEN GOTO 5230
+1240 IF K = 24 THEN GOTO 5240
+1250 IF K = 25 THEN GOTO 5250
+1260 IF K = 26 THEN GOTO 5260
+1270 IF K = 27 THEN GOTO 5270
+1280 IF K = 28 THEN GOTO 5280
+1290 IF K = 29 THEN GOTO 5290
+1300 IF K = 30 THEN GOTO 5300
+1310 IF K = 31 THEN GOTO 5310
+1320 IF K = 32 THEN GOTO 5320
+1330 IF K = 33 THEN GOTO 5330
+1340 IF K = 34 THEN GOTO 5340
+1350 IF K = 35 THEN GOTO 5350
+1360 IF K = 36 THEN GOTO 5360
+1370 IF K = 37 THEN GOTO 5370
+1380 IF K = 38 THEN GOTO 5380
+1390 IF K = 39 THEN GOTO 5390
+1400 IF K = 40 THEN GOTO 5400
+1410 IF K = 41 THEN GOTO 5410
+1420 IF K = 42 THEN GOTO 5420
+1430 IF K = 43 THEN GOTO 5430
+1440 IF K = 44 THEN GOTO 5440
+1450 IF K = 45 THEN GOTO 5450
+1460 IF K = 46 THEN GOTO 5460
+1470 IF K = 47 THEN GOTO 5470
+1480 IF K = 48 THEN GOTO 5480
+1490 IF K = 49 THEN GOTO 5490
+1500 IF K = 50 THEN GOTO 5500
+1510 IF K = 51 THEN GOTO 5510
+1520 IF K = 52 THEN GOTO 5520
+1530 IF K = 53 THEN GOTO 5530
+1540 IF K = 54 THEN GOTO 5540
+1550 IF K = 55 THEN GOTO 5550
+1560 IF K = 56 THEN GOTO 5560
+1570 IF K = 57 THEN GOTO 5570
+1580 IF K = 58 THEN GOTO 5580
+1590 IF K = 59 THEN GOTO 5590
+1600 IF K = 60 THEN GOTO 5600
+1610 IF K = 61 THEN GOTO 5610
+1620 IF K = 62 THEN GOTO 5620
+1630 IF K = 63 THEN GOTO 5630
+1640 IF K = 64 THEN GOTO 5640
+1650 IF K = 65 THEN GOTO 5650
+1660 IF K = 66 THEN GOTO 5660
+1670 IF K = 67 THEN GOTO 5670
+1680 IF K = 68 THEN GOTO 5680
+1690 IF K = 69 THEN GOTO 5690
+1700 IF K = 70 THEN GOTO 5700
+1710 IF K = 71 THEN GOTO 5710
+1720 IF K = 72 THEN GOTO 5720
+1730 IF K = 73 THEN GOTO 5730
+1740 IF K = 74 THEN GOTO 5740
+1750 IF K = 75 THEN GOTO 5750
+1760 IF K = 76 THEN GOTO 5760
+1770 IF K = 77 THEN GOTO 5770
+1780 IF K = 78 THEN GOTO 5780
+1790 IF K = 79 THEN GOTO 5790
+1800 IF K = 80 THEN GOTO 5800
+1810 IF K = 81 THEN GOTO 5810
+1820 IF K = 82 THEN GOTO 5820
+1830 IF K = 83 THEN GOTO 5830
+1840 IF K = 84 THEN GOTO 5840
+1850 IF K = 85 THEN GOTO 5850
+1860 IF K = 86 THEN GOTO 5860
+1870 IF K = 87 THEN GOTO 5870
+1880 IF K = 88 THEN GOTO 5880
+1890 IF K = 89 THEN GOTO 5890
+1900 IF K = 90 THEN GOTO 5900
+1910 IF K = 91 THEN GOTO 5910
+1920 IF K = 92 THEN GOTO 5920
+1930 IF K = 93 THEN GOTO 5930
+1940 IF K = 94 THEN GOTO 5940
+1950 IF K = 95 THEN GOTO 5950
+1960 IF K = 96 THEN GOTO 5960
+1970 IF K = 97 THEN GOTO 5970
+1980 IF K = 98 THEN GOTO 5980
+1990 IF K = 99 THEN GOTO 5990
+2000 IF K = 100 THEN GOTO 6000
+2010 IF K = 101 THEN GOTO 6010
+2020 IF K = 102 THEN GOTO 6020
+2030 IF K = 103 THEN GOTO 6030
+2040 IF K = 104 THEN GOTO 6040
+2050 IF K = 105 THEN GOTO 6050
+2060 IF K = 106 THEN GOTO 6060
+2070 IF K = 107 THEN GOTO 6070
+2080 IF K = 108 THEN GOTO 6080
+2090 IF K = 109 THEN GOTO 6090
+2100 IF K = 110 THEN GOTO 6100
+2110 IF K = 111 THEN GOTO 6110
+2120 IF K = 112 THEN GOTO 6120
+2130 IF K = 113 THEN GOTO 6130
+2140 IF K = 114 THEN GOTO 6140
+2150 IF K = 115 THEN GOTO 6150
+2160 IF K = 116 THEN GOTO 6160
+2170 IF K = 117 THEN GOTO 6170
+2180 IF K = 118 THEN GOTO 6180
+2190 IF K = 119 THEN GOTO 6190
+2200 IF K = 120 THEN GOTO 6200
+2210 IF K = 121 THEN GOTO 6210
+2220 IF K = 122 THEN GOTO 6220
+2230 IF K = 123 THEN GOTO 6230
+2240 IF K = 124 THEN GOTO 6240
+2250 IF K = 125 THEN GOTO 6250
+2260 IF K = 126 THEN GOTO 6260
+2270 IF K = 127 THEN GOTO 6270
+2280 IF K = 128 THEN GOTO 6280
+2290 IF K = 129 THEN GOTO 6290
+2300 IF K = 130 THEN GOTO 6300
+2310 IF K = 131 THEN GOTO 6310
+2320 IF K = 132 THEN GOTO 6320
+2330 IF K = 133 THEN GOTO 6330
+2340 IF K = 134 THEN GOTO 6340
+2350 IF K = 135 THEN GOTO 6350
+2360 IF K = 136 THEN GOTO 6360
+2370 IF K = 137 THEN GOTO 6370
+2380 IF K = 138 THEN GOTO 6380
+2390 IF K = 139 THEN GOTO 6390
+2400 IF K = 140 THEN GOTO 6400
+2410 IF K = 141 THEN GOTO 6410
+2420 IF K = 142 THEN GOTO 6420
+2430 IF K = 143 THEN GOTO 6430
+2440 IF K = 144 THEN GOTO 6440
+2450 IF K = 145 THEN GOTO 6450
+2460 IF K = 146 THEN GOTO 6460
+2470 IF K = 147 THEN GOTO 6470
+2480 IF K = 148 THEN GOTO 6480
+2490 IF K = 149 THEN GOTO 6490
+2500 IF K = 150 THEN GOTO 6500
+2510 IF K = 151 THEN GOTO 6510
+2520 IF K = 152 THEN GOTO 6520
+2530 IF K = 153 THEN GOTO 6530
+2540 IF K = 154 THEN GOTO 6540
+2550 IF K = 155 THEN GOTO 6550
+2560 IF K = 156 THEN GOTO 6560
+2570 IF K = 157 THEN GOTO 6570
+2580 IF K = 158 THEN GOTO 6580
+2590 IF K = 159 THEN GOTO 6590
+2600 IF K = 160 THEN GOTO 6600
+2610 IF K = 161 THEN GOTO 6610
+2620 IF K = 162 THEN GOTO 6620
+2630 IF K = 163 THEN GOTO 6630
+2640 IF K = 164 THEN GOTO 6640
+2650 IF K = 165 THEN GOTO 6650
+2660 IF K = 166 THEN GOTO 6660
+2670 IF K = 167 THEN GOTO 6670
+2680 IF K = 168 THEN GOTO 6680
+2690 IF K = 169 THEN GOTO 6690
+2700 IF K = 170 THEN GOTO 6700
+2710 IF K = 171 THEN GOTO 6710
+2720 IF K = 172 THEN GOTO 6720
+2730 IF K = 173 THEN GOTO 6730
+2740 IF K = 174 THEN GOTO 6740
+2750 IF K = 175 THEN GOTO 6750
+2760 IF K = 176 THEN GOTO 6760
+2770 IF K = 177 THEN GOTO 6770
+2780 IF K = 178 THEN GOTO 6780
+2790 IF K = 179 THEN GOTO 6790
+2800 IF K = 180 THEN GOTO 6800
+2810 IF K = 181 THEN GOTO 6810
+2820 IF K = 182 THEN GOTO 6820
+2830 IF K = 183 THEN GOTO 6830
+2840 IF K = 184 THEN GOTO 6840
+2850 IF K = 185 THEN GOTO 6850
+2860 IF K = 186 THEN GOTO 6860
+2870 IF K = 187 THEN GOTO 6870
+2880 IF K = 188 THEN GOTO 6880
+2890 IF K = 189 THEN GOTO 6890
+2900 IF K = 190 THEN GOTO 6900
+2910 IF K = 191 THEN GOTO 6910
+2920 IF K = 192 THEN GOTO 6920
+2930 IF K = 193 THEN GOTO 6930
+2940 IF K = 194 THEN GOTO 6940
+2950 IF K = 195 THEN GOTO 6950
+2960 IF K = 196 THEN GOTO 6960
+2970 IF K = 197 THEN GOTO 6970
+2980 IF K = 198 THEN GOTO 6980
+2990 IF K = 199 THEN GOTO 6990
+5000 T = T + 0: GOTO 190
+5010 T = T + 1: GOTO 190
+5020 T = T + 2: GOTO 190
+5030 T = T + 3: GOTO 190
+5040 T = T + 4: GOTO 190
+5050 T = T + 5: GOTO 190
+5060 T = T + 6: GOTO 190
+5070 T = T + 7: GOTO 190
+5080 T = T + 8: GOTO 190
+5090 T = T + 9: GOTO 190
+5100 T = T + 10: GOTO 190
+5110 T = T + 11: GOTO 190
+5120 T = T + 12: GOTO 190
+5130 T = T + 13: GOTO 190
+5140 T = T + 14: GOTO 190
+5150 T = T + 15: GOTO 190
+5160 T = T + 16: GOTO 190
+5170 T = T + 17: GOTO 190
+5180 T = T + 18: GOTO 190
+5190 T = T + 19: GOTO 190
+5200 T = T + 20: GOTO 190
+5210 T = T + 21: GOTO 190
+5220 T = T + 22: GOTO 190
+5230 T = T + 23: GOTO 190
+5240 T = T + 24: GOTO 190
+5250 T = T + 25: GOTO 190
+5260 T = T + 26: GOTO 190
+5270 T = T + 27: GOTO 190
+5280 T = T + 28: GOTO 190
+5290 T = T + 29: GOTO 190
+5300 T = T + 30: GOTO 190
+5310 T = T + 31: GOTO 190
+5320 T = T + 32: GOTO 190
+5330 T = T + 33: GOTO 190
+5340 T = T + 34: GOTO 190
+5350 T = T + 35: GOTO 190
+5360 T = T + 36: GOTO 190
+5370 T = T + 37: GOTO 190
+5380 T = T + 38: GOTO 190
+5390 T = T + 39: GOTO 190
+5400 T = T + 40: GOTO 190
+5410 T = T + 41: GOTO 190
+5420 T = T + 42: GOTO 190
+5430 T = T + 43: GOTO 190
+5440 T = T + 44: GOTO 190
+5450 T = T + 45: GOTO 190
+5460 T = T + 46: GOTO 190
+5470 T = T + 47: GOTO 190
+5480 T = T + 48: GOTO 190
+5490 T = T + 49: GOTO 190
+5500 T = T + 50: GOTO 190
+5510 T = T + 51: GOTO 190
+5520 T = T + 52: GOTO 190
+5530 T = T + 53: GOTO 190
+5540 T = T + 54: GOTO 190
+5550 T = T + 55: GOTO 190
+5560 T = T + 56: GOTO 190
+5570 T = T + 57: GOTO 190
+5580 T = T + 58: GOTO 190
+5590 T = T + 59: GOTO 190
+5600 T = T + 60: GOTO 190
+5610 T = T + 61: GOTO 190
+5620 T = T + 62: GOTO 190
+5630 T = T + 63: GOTO 190
+5640 T = T + 64: GOTO 190
+5650 T = T + 65: GOTO 190
+5660 T = T + 66: GOTO 190
+5670 T = T + 67: GOTO 190
+5680 T = T + 68: GOTO 190
+5690 T = T + 69: GOTO 190
+5700 T = T + 70: GOTO 190
+5710 T = T + 71: GOTO 190
+5720 T = T + 72: GOTO 190
+5730 T = T + 73: GOTO 190
+5740 T = T + 74: GOTO 190
+5750 T = T + 75: GOTO 190
+5760 T = T + 76: GOTO 190
+5770 T = T + 77: GOTO 190
+5780 T = T + 78: GOTO 190
+5790 T = T + 79: GOTO 190
+5800 T = T + 80: GOTO 190
+5810 T = T + 81: GOTO 190
+5820 T = T + 82: GOTO 190
+5830 T = T + 83: GOTO 190
+5840 T = T + 84: GOTO 190
+5850 T = T + 85: GOTO 190
+5860 T = T + 86: GOTO 190
+5870 T = T + 87: GOTO 190
+5880 T = T + 88: GOTO 190
+5890 T = T + 89: GOTO 190
+5900 T = T + 90: GOTO 190
+5910 T = T + 91: GOTO 190
+5920 T = T + 92: GOTO 190
+5930 T = T + 93: GOTO 190
+5940 T = T + 94: GOTO 190
+5950 T = T + 95: GOTO 190
+5960 T = T + 96: GOTO 190
+5970 T = T + 97: GOTO 190
+5980 T = T + 98: GOTO 190
+5990 T = T + 99: GOTO 190
+6000 T = T + 100: GOTO 190
+6010 T = T + 101: GOTO 190
+6020 T = T + 102: GOTO 190
+6030 T = T + 103: GOTO 190
+6040 T = T + 104: GOTO 190
+6050 T = T + 105: GOTO 190
+6060 T = T + 106: GOTO 190
+6070 T = T + 107: GOTO 190
+6080 T = T + 108: GOTO 190
+6090 T = T + 109: GOTO 190
+6100 T = T + 110: GOTO 190
+6110 T = T + 111: GOTO 190
+6120 T = T + 112: GOTO 190
+6130 T = T + 113: GOTO 190
+6140 T = T + 114: GOTO 190
+6150 T = T + 115: GOTO 190
+6160 T = T + 116: GOTO 190
+6170 T = T + 117: GOTO 190
+6180 T = T + 118: GOTO 190
+6190 T = T + 119: GOTO 190
+6200 T = T + 120: GOTO 190
+6210 T = T + 121: GOTO 190
+6220 T = T + 122: GOTO 190
+6230 T = T + 123: GOTO 190
+6240 T = T + 124: GOTO 190
+6250 T = T + 125: GOTO 190
+6260 T = T + 126: GOTO 190
+6270 T = T + 127: GOTO 190
+6280 T = T + 128: GOTO 190
+6290 T = T + 129: GOTO 190
+6300 T = T + 130: GOTO 190
+6310 T = T + 131: GOTO 190
+6320 T = T + 132: GOTO 190
+6330 T = T + 133: GOTO 190
+6340 T = T + 134: GOTO 190
+6350 T = T + 135: GOTO 190
+6360 T = T + 136: GOTO 190
+6370 T = T + 137: GOTO 190
+6380 T = T + 138: GOTO 190
+6390 T = T + 139: GOTO 190
+6400 T = T + 140: GOTO 190
+6410 T = T + 141: GOTO 190
+6420 T = T + 142: GOTO 190
+6430 T = T + 143: GOTO 190
+6440 T = T + 144: GOTO 190
+6450 T = T + 145: GOTO 190
+6460 T = T + 146: GOTO 190
+6470 T = T + 147: GOTO 190
+6480 T = T + 148: GOTO 190
+6490 T = T + 149: GOTO 190
+6500 T = T + 150: GOTO 190
+6510 T = T + 151: GOTO 190
+6520 T = T + 152: GOTO 190
+6530 T = T + 153: GOTO 190
+6540 T = T + 154: GOTO 190
+6550 T = T + 155: GOTO 190
+6560 T = T + 156: GOTO 190
+6570 T = T + 157: GOTO 190
+6580 T = T + 158: GOTO 190
+6590 T = T + 159: GOTO 190
+6600 T = T + 160: GOTO 190
+6610 T = T + 161: GOTO 190
+6620 T = T + 162: GOTO 190
+6630 T = T + 163: GOTO 190
+6640 T = T + 164: GOTO 190
+6650 T = T + 165: GOTO 190
+6660 T = T + 166: GOTO 190
+6670 T = T + 167: GOTO 190
+6680 T = T + 168: GOTO 190
+6690 T = T + 169: GOTO 190
+6700 T = T + 170: GOTO 190
+6710 T = T + 171: GOTO 190
+6720 T = T + 172: GOTO 190
+6730 T = T + 173: GOTO 190
+6740 T = T + 174: GOTO 190
+6750 T = T + 175: GOTO 190
+6760 T = T + 176: GOTO 190
+6770 T = T + 177: GOTO 190
+6780 T = T + 178: GOTO 190
+6790 T = T + 179: GOTO 190
+6800 T = T + 180: GOTO 190
+6810 T = T + 181: GOTO 190
+6820 T = T + 182: GOTO 190
+6830 T = T + 183: GOTO 190
+6840 T = T + 184: GOTO 190
+6850 T = T + 185: GOTO 190
+6860 T = T + 186: GOTO 190
+6870 T = T + 187: GOTO 190
+6880 T = T + 188: GOTO 190
+6890 T = T + 189: GOTO 190
+6900 T = T + 190: GOTO 190
+6910 T = T + 191: GOTO 190
+6920 T = T + 192: GOTO 190
+6930 T = T + 193: GOTO 190
+6940 T = T + 194: GOTO 190
+6950 T = T + 195: GOTO 190
+6960 T = T + 196: GOTO 190
+6970 T = T + 197: GOTO 190
+6980 T = T + 198: GOTO 190
+6990 T = T + 199: GOTO 190
@@ -0,0 +1,16 @@
+100 REM BYTE sieve of Eratosthenes (1981), 10 passes over 8191 flags
+110 S = 8190
+120 DIM F%(8191)
+130 FOR N = 1 TO 10
+140 C = 0
+150 FOR I = 0 TO S: F%(I) = 1: NEXT I
+160 FOR I = 0 TO S
+170 IF F%(I) = 0 THEN 230
+180 P = I + I + 3
+190 C = C + 1: IF I + P > S THEN 230
+200 FOR K = I + P TO S STEP P
+210 F%(K) = 0
+220 NEXT K
+230 NEXT I
+240 NEXT N
+250 PRINT C; "PRIMES"
@@ -0,0 +1,14 @@
+100 REM String building and slicing
+110 FOR R = 1 TO 200
+120 A$ = ""
+130 FOR I = 1 TO 100
+140 A$ = A$ + CHR$(65 + I MOD 26)
+150 NEXT I
+160 C = 0
+170 FOR I = 1 TO LEN(A$) - 3
+180 B$ = MID$(A$, I, 3)
+190 IF LEFT$(B$, 1) = RIGHT$(B$, 1) THEN C = C + 1
+200 IF MID$(B$, 2, 1) = "A" THEN C = C + 1
+210 NEXT I
+220 NEXT R
+230 PRINT LEN(A$); C; STR$(R)
@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# usr.sh - Measure the cost of calling native code through USR
+#
+# Compares an empty loop, a builtin function call and a USR call to a
+# function that does nothing, and reports the per-call overhead.
+#
+# Usage: bench/usr.sh [iterations]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+N=${1:-200000}
+LIB=bench/libkernels.so
+
+if [ ! -f $LIB ]; then
+    make $LIB || exit 1
+fi
+
+run() {
+    tmp=/tmp/usr_bench.$$.bas
+    cat > $tmp <<END
+10 DEF USR0 = "$LIB", "ident", "d:d"
+20 FOR I = 1 TO $N: $1: NEXT I
+END
+    start=`date +%s.%N`
+    $GWBASIC $tmp > /dev/null
+    end=`date +%s.%N`
+    rm -f $tmp
+    awk "BEGIN { print $end - $start }"
+}
+
+base=`run "X = I"`
+echo "loop          seconds  ns/call"
+awk "BEGIN { printf \"empty      %10.3f\\n\", $base }"
+for stmt in "X = ABS(I)" "X = USR0(I)"; do
+    secs=`run "$stmt"`
+    awk "BEGIN { printf \"%-10s %10.3f %8.0f\\n\", \"$stmt\", $secs, ($secs - $base) * 1e9 / $N }"
+done
@@ -0,0 +1,17 @@
+10 REM USR dispatch benchmark - needs bench/libkernels.so
+20 DEF USR0 = "bench/libkernels.so", "ident", "d:d"
+30 DEF USR1 = "bench/libkernels.so", "sum_array", "d:pl"
+40 N = 20000
+50 DIM A#(1000)
+60 FOR I = 0 TO 1000: A#(I) = I: NEXT I
+70 REM Empty loop as a baseline
+80 T0 = USR0(0)
+90 FOR I = 1 TO N: X = I: NEXT I
+100 REM Builtin call
+110 FOR I = 1 TO N: X = ABS(I): NEXT I
+120 REM Native call with one double argument
+130 FOR I = 1 TO N: X = USR0(I): NEXT I
+140 REM Native call over array data, no copying
+150 FOR I = 1 TO N / 100: S = USR1(A#(), 1001): NEXT I
+160 PRINT "SUM"; S
+170 END
@@ -0,0 +1,499 @@
+/*
+ * calls.c - GOSUB call-graph profiler
+ *
+ * --calls FILE times every subroutine call.  do_gosub() and do_return()
+ * report each call and return here (one test of g_state->profiling
+ * each when this is off), and the subroutine - named by its first
+ * line - is charged:
+ *
+ *   - inclusive time, from the GOSUB to the RETURN, counted once for
+ *     recursive calls;
+ *   - exclusive time, the inclusive time less that of the subroutines
+ *     it called in turn.
+ *
+ * At exit the totals are listed on stderr, most expensive first, and
+ * FILE is written.  If its name ends in .json it gets Chrome trace
+ * events (a B event per GOSUB and an E event per RETURN, in
+ * microseconds), written as the program runs, for chrome://tracing or
+ * Perfetto; scheduled jobs appear as separate threads.  Otherwise it
+ * gets folded stacks of subroutines weighted by exclusive microseconds,
+ * the same format --sample writes:
+ *
+ *   100;2000 5120
+ *
+ * meaning 5120 microseconds in the subroutine at line 2000 when called
+ * from the one at line 100.  Time outside any subroutine is not listed.
+ *
+ * Calls still open when a program ends, or that are dropped by RUN or
+ * CLEAR, end at that point.  Lines run by PARALLEL FOR workers and
+ * compiled programs are not timed.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#define CALLS_DEPTH 16      /* Innermost subroutines kept per folded stack */
+
+/* A subroutine call in progress */
+typedef struct {
+    int line;               /* Subroutine */
+    double start;           /* When it was called */
+    double child;           /* Inclusive time of the calls it made */
+} call_frame_t;
+
+struct calls_s {
+    int id;                 /* Thread in the Chrome trace */
+    int depth;              /* Calls in progress */
+    call_frame_t frames[STACK_SIZE];
+};
+
+/* Totals of a subroutine */
+typedef struct {
+    int line;               /* First line, -1 if the slot is free */
+    int active;             /* Calls in progress (recursion) */
+    long calls;
+    double incl;            /* Seconds, inclusive */
+    double excl;            /* Seconds, exclusive */
+} call_sub_t;
+
+/* Distinct stack of subroutines and its exclusive time */
+typedef struct {
+    int depth;              /* 0 if the slot is free */
+    int lines[CALLS_DEPTH];
+    double time;
+} call_stack_t;
+
+/* --calls: 1 if on */
+int calls_on = 0;
+
+static char *outname;
+static FILE *events;        /* Chrome trace, NULL for folded stacks */
+static int nevents;
+static int nids;
+static double origin;       /* Time 0 of the Chrome trace */
+
+static call_sub_t *subs;    /* Open addressing hash tables */
+static int nsubs;
+static int capsubs;
+static call_stack_t *stacks;
+static int nstacks;
+static int capstacks;
+
+/*
+ * Totals of a subroutine, added if new
+ * Returns NULL if out of memory
+ */
+static call_sub_t *
+find_sub(line)
+int line;
+{
+    call_sub_t *old;
+    int oldcap;
+    int i;
+    int k;
+
+    if (nsubs * 2 >= capsubs) {
+        old = subs;
+        oldcap = capsubs;
+        capsubs = oldcap ? oldcap * 2 : 256;
+        subs = (call_sub_t *)malloc((size_t)capsubs * sizeof(call_sub_t));
+        if (!subs) {
+            subs = old;
+            capsubs = oldcap;
+            return NULL;
+        }
+        for (i = 0; i < capsubs; i++) {
+            subs[i].line = -1;
+        }
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].line >= 0) {
+                k = old[i].line & (capsubs - 1);
+                while (subs[k].line >= 0) {
+                    k = (k + 1) & (capsubs - 1);
+                }
+                subs[k] = old[i];
+            }
+        }
+        if (old) {
+            free(old);
+        }
+    }
+
+    i = line & (capsubs - 1);
+    while (subs[i].line >= 0) {
+        if (subs[i].line == line) {
+            return &subs[i];
+        }
+        i = (i + 1) & (capsubs - 1);
+    }
+    memset((char *)&subs[i], 0, sizeof(call_sub_t));
+    subs[i].line = line;
+    nsubs++;
+    return &subs[i];
+}
+
+/*
+ * Hash of a stack
+ */
+static unsigned long
+hash_stack(lines, depth)
+int *lines;
+int depth;
+{
+    unsigned long h;
+    int k;
+
+    h = 0;
+    for (k = 0; k < depth; k++) {
+        h = h * 31UL + (unsigned long)lines[k];
+    }
+    return h;
+}
+
+/*
+ * Add exclusive time to a stack of subroutines
+ */
+static void
+add_stack(lines, depth, time)
+int *lines;
+int depth;
+double time;
+{
+    call_stack_t *old;
+    call_stack_t *e;
+    int oldcap;
+    int i;
+    int k;
+
+    if (nstacks * 2 >= capstacks) {
+        old = stacks;
+        oldcap = capstacks;
+        capstacks = oldcap ? oldcap * 2 : 256;
+        stacks = (call_stack_t *)calloc((size_t)capstacks,
+                                        sizeof(call_stack_t));
+        if (!stacks) {
+            stacks = old;
+            capstacks = oldcap;
+            return;
+        }
+        nstacks = 0;
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].depth > 0) {
+                k = (int)(hash_stack(old[i].lines, old[i].depth) &
+                          (unsigned long)(capstacks - 1));
+                while (stacks[k].depth > 0) {
+                    k = (k + 1) & (capstacks - 1);
+                }
+                stacks[k] = old[i];
+                nstacks++;
+            }
+        }
+        if (old) {
+            free(old);
+        }
+    }
+
+    i = (int)(hash_stack(lines, depth) & (unsigned long)(capstacks - 1));
+    while ((e = &stacks[i])->depth > 0) {
+        if (e->depth == depth &&
+            memcmp(e->lines, lines, depth * sizeof(int)) == 0) {
+            break;
+        }
+        i = (i + 1) & (capstacks - 1);
+    }
+    if (e->depth == 0) {
+        e->depth = depth;
+        memcpy(e->lines, lines, depth * sizeof(int));
+        nstacks++;
+    }
+    e->time += time;
+}
+
+/*
+ * Write a Chrome trace event
+ */
+static void
+event(c, ph, line, now)
+struct calls_s *c;
+int ph;
+int line;
+double now;
+{
+    fprintf(events, "%s{\"name\":\"GOSUB %d\",\"ph\":\"%c\",\"ts\":%.3f,"
+            "\"pid\":1,\"tid\":%d}", nevents ? ",\n" : "", line, ph,
+            (now - origin) * 1e6, c->id);
+    nevents++;
+}
+
+/*
+ * End the innermost call in progress at time now
+ */
+static void
+end_call(c, now)
+struct calls_s *c;
+double now;
+{
+    call_frame_t *f;
+    call_sub_t *s;
+    double elapsed;
+    int lines[CALLS_DEPTH];
+    int first;
+    int k;
+
+    f = &c->frames[--c->depth];
+    elapsed = now - f->start;
+    s = find_sub(f->line);
+    if (s) {
+        s->excl += elapsed - f->child;
+        if (--s->active <= 0) {
+            s->active = 0;
+            s->incl += elapsed;
+        }
+    }
+    if (c->depth > 0) {
+        c->frames[c->depth - 1].child += elapsed;
+    }
+
+    if (events) {
+        event(c, 'E', f->line, now);
+    } else {
+        first = c->depth + 1 - CALLS_DEPTH;
+        if (first < 0) {
+            first = 0;
+        }
+        for (k = first; k <= c->depth; k++) {
+            lines[k - first] = c->frames[k].line;
+        }
+        add_stack(lines, c->depth + 1 - first, elapsed - f->child);
+    }
+}
+
+/*
+ * The calls in progress, allocated on first use
+ * Returns NULL if out of memory
+ */
+static struct calls_s *
+calls_get()
+{
+    struct calls_s *c;
+
+    c = g_state->calls;
+    if (!c) {
+        c = (struct calls_s *)calloc(1, sizeof(struct calls_s));
+        if (!c) {
+            return NULL;
+        }
+        c->id = ++nids;
+        g_state->calls = c;
+    }
+    return c;
+}
+
+/*
+ * GOSUB to line has pushed its return address
+ */
+void
+calls_enter(line)
+int line;
+{
+    struct calls_s *c;
+    call_frame_t *f;
+    call_sub_t *s;
+    double now;
+
+    c = calls_get();
+    if (!c) {
+        return;
+    }
+    now = clock_mono();
+
+    /* Calls whose return addresses were dropped without a RETURN */
+    while (c->depth >= g_state->gosubsp && c->depth > 0) {
+        end_call(c, now);
+    }
+    if (c->depth >= STACK_SIZE) {
+        return;
+    }
+
+    f = &c->frames[c->depth++];
+    f->line = line;
+    f->start = now;
+    f->child = 0.0;
+    s = find_sub(line);
+    if (s) {
+        s->calls++;
+        s->active++;
+    }
+    if (events) {
+        event(c, 'B', line, now);
+    }
+}
+
+/*
+ * RETURN has popped a return address
+ */
+void
+calls_leave()
+{
+    struct calls_s *c;
+    double now;
+
+    c = g_state->calls;
+    if (!c) {
+        return;
+    }
+    now = clock_mono();
+    while (c->depth > g_state->gosubsp) {
+        end_call(c, now);
+    }
+}
+
+/*
+ * The program ended - end the calls still in progress
+ */
+void
+calls_report()
+{
+    struct calls_s *c;
+    double now;
+
+    c = g_state->calls;
+    if (!c || c->depth == 0 || g_state->forstop > 0) {
+        return;
+    }
+    now = clock_mono();
+    while (c->depth > 0) {
+        end_call(c, now);
+    }
+    if (events) {
+        fflush(events);
+    }
+}
+
+/*
+ * Free the calls in progress
+ */
+void
+calls_release()
+{
+    if (g_state->calls) {
+        free(g_state->calls);
+        g_state->calls = NULL;
+    }
+}
+
+/*
+ * Order subroutines by inclusive time
+ */
+static int
+by_incl(a, b)
+const void *a;
+const void *b;
+{
+    const call_sub_t *x;
+    const call_sub_t *y;
+
+    x = *(const call_sub_t **)a;
+    y = *(const call_sub_t **)b;
+    if (x->incl != y->incl) {
+        return x->incl < y->incl ? 1 : -1;
+    }
+    return x->line - y->line;
+}
+
+/*
+ * List the totals and write the folded stacks or finish the Chrome
+ * trace (run by atexit)
+ */
+static void
+calls_finish()
+{
+    call_sub_t **order;
+    FILE *fp;
+    long total;
+    int n;
+    int i;
+    int k;
+
+    if (events) {
+        fprintf(events, "\n]\n");
+        fclose(events);
+        events = NULL;
+    } else {
+        fp = fopen(outname, "w");
+        if (!fp) {
+            fprintf(stderr, "Cannot write %s\n", outname);
+        }
+        for (i = 0; fp && i < capstacks; i++) {
+            if (stacks[i].depth == 0) {
+                continue;
+            }
+            for (k = 0; k < stacks[i].depth; k++) {
+                fprintf(fp, k ? ";%d" : "%d", stacks[i].lines[k]);
+            }
+            fprintf(fp, " %.0f\n", stacks[i].time * 1e6);
+        }
+        if (fp) {
+            fclose(fp);
+        }
+    }
+
+    order = (call_sub_t **)malloc((nsubs + 1) * sizeof(call_sub_t *));
+    if (!order || nsubs == 0) {
+        if (order) {
+            free(order);
+        }
+        return;
+    }
+    n = 0;
+    total = 0L;
+    for (i = 0; i < capsubs; i++) {
+        if (subs[i].line >= 0) {
+            order[n++] = &subs[i];
+            total += subs[i].calls;
+        }
+    }
+    qsort((void *)order, (size_t)n, sizeof(call_sub_t *), by_incl);
+    fflush(stdout);
+    fprintf(stderr, "\nSubroutines: %d, %ld calls\n", n, total);
+    fprintf(stderr, "   line       calls    inclusive    exclusive"
+            "   per call\n");
+    for (i = 0; i < n; i++) {
+        fprintf(stderr, "%7d %11ld %12.6f %12.6f %10.3fus\n",
+                order[i]->line, order[i]->calls, order[i]->incl,
+                order[i]->excl,
+                order[i]->calls ? order[i]->incl * 1e6 / order[i]->calls :
+                0.0);
+    }
+    free(order);
+}
+
+/*
+ * Time subroutine calls; the results go to name when the process exits
+ * Returns 0 on success, -1 if name can't be written
+ */
+int
+calls_start(name)
+const char *name;
+{
+    int n;
+
+    outname = (char *)malloc(strlen(name) + 1);
+    if (!outname) {
+        return -1;
+    }
+    strcpy(outname, name);
+    n = (int)strlen(name);
+    if (n > 5 && strcmp(name + n - 5, ".json") == 0) {
+        events = fopen(name, "w");
+        if (!events) {
+            return -1;
+        }
+        fprintf(events, "[\n");
+    }
+    origin = clock_mono();
+    atexit(calls_finish);
+    calls_on = 1;
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * clock.c - Time sources
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(__211BSD__) || defined(pdp11) || !defined(__STDC__)
+#include <sys/types.h>
+#include <sys/time.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+/*
+ * Monotonic clock in seconds
+ * Only differences between two readings are meaningful
+ */
+double
+clock_mono()
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+#else
+    /* No monotonic clock - fall back to time of day */
+    struct timeval tv;
+
+    gettimeofday(&tv, (struct timezone *)0);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6;
+#endif
+}
+
+/*
+ * Local time of day in seconds since midnight (TIMER)
+ */
+double
+clock_day()
+{
+    struct timeval tv;
+    struct tm *tm;
+    time_t t;
+
+    gettimeofday(&tv, (struct timezone *)0);
+    t = (time_t)tv.tv_sec;
+    tm = localtime(&t);
+    if (!tm) {
+        return (double)(tv.tv_sec % 86400L) + (double)tv.tv_usec / 1.0e6;
+    }
+    return (double)(tm->tm_hour * 3600L + tm->tm_min * 60L + tm->tm_sec) +
+           (double)tv.tv_usec / 1.0e6;
+}
+
+/*
+ * CPU cycle counter, 0 if the processor has none we can read
+ * On x86 this is the time stamp counter, which ticks at a fixed rate
+ * close to the nominal clock speed
+ */
+unsigned long
+clock_cycles()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    unsigned int lo;
+    unsigned int hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long)hi << 16 << 16) | (unsigned long)lo;
+#else
+    return 0UL;
+#endif
+}
@@ -0,0 +1,346 @@
+/*
+ * cover.c - Line coverage in lcov format
+ *
+ * --coverage FILE keeps a bitmap with one bit per line number for each
+ * program.  The bit is set the first time a line starts, from the same
+ * per-line hook the profiler uses (profile_line()), and by JIT compiled
+ * code with an inline test and set, so coverage can stay on for whole
+ * regression runs.
+ *
+ * When a program loaded from a file ends, its bits are merged into
+ * FILE as an lcov tracefile: one record per .bas file with a DA line
+ * for every program line, counting the runs that reached it.  Records
+ * of other files are kept, so one FILE collects a whole test suite and
+ * genhtml can render it.  The file is locked while it is rewritten, so
+ * concurrent runs can share it.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#define HAVE_LOCK 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+#define COVER_BYTES 8192    /* One bit per line number 0 - 65535 */
+
+struct cover_s {
+    unsigned char hits[COVER_BYTES];
+    char *source;           /* Program file, NULL if typed in */
+};
+
+/* --coverage: 1 if on, and the tracefile */
+int cover_on = 0;
+static char *infoname;
+
+/*
+ * The current program's bitmap, allocated on first use
+ */
+struct cover_s *
+cover_get()
+{
+    struct cover_s *cov;
+
+    cov = g_state->cover;
+    if (!cov) {
+        cov = (struct cover_s *)calloc(1, sizeof(struct cover_s));
+        if (!cov) {
+            g_state->profiling &= ~PROF_COVER;
+            return NULL;
+        }
+        g_state->cover = cov;
+    }
+    return cov;
+}
+
+/*
+ * Byte and bit of a line in the bitmap, which must exist
+ */
+unsigned char *
+cover_bit(linenum, bit)
+int linenum;
+int *bit;
+{
+    *bit = 1 << (linenum & 7);
+    return &g_state->cover->hits[(linenum >> 3) & (COVER_BYTES - 1)];
+}
+
+/*
+ * A line starts executing
+ */
+void
+cover_line(linenum)
+int linenum;
+{
+    unsigned char *p;
+    int bit;
+
+    if (!g_state->cover && !cover_get()) {
+        return;
+    }
+    p = cover_bit(linenum, &bit);
+    if (!(*p & bit)) {
+        /* PARALLEL FOR workers share the bitmap */
+#if defined(__GNUC__)
+        __sync_fetch_and_or(p, (unsigned char)bit);
+#else
+        *p |= (unsigned char)bit;
+#endif
+    }
+}
+
+/*
+ * A program was loaded from a file - it starts with a clean bitmap
+ */
+void
+cover_source(name)
+const char *name;
+{
+    struct cover_s *cov;
+#ifdef HAVE_LOCK
+    char path[PATH_MAX];
+#endif
+
+    if (!cover_on || !(cov = cover_get())) {
+        return;
+    }
+    if (cov->source) {
+        free(cov->source);
+    }
+#ifdef HAVE_LOCK
+    /* Absolute, so runs from other directories merge */
+    if (realpath(name, path)) {
+        name = path;
+    }
+#endif
+    cov->source = (char *)malloc(strlen(name) + 1);
+    if (cov->source) {
+        strcpy(cov->source, name);
+    }
+    memset((char *)cov->hits, 0, sizeof(cov->hits));
+}
+
+/*
+ * Read a whole file into a malloced, NUL terminated buffer
+ */
+static char *
+slurp(fp)
+FILE *fp;
+{
+    char *text;
+    char *p;
+    long size;
+    long n;
+    int k;
+
+    size = 4096L;
+    n = 0L;
+    text = (char *)malloc((size_t)size);
+    while (text) {
+        k = (int)fread(text + n, 1, (size_t)(size - n - 1), fp);
+        if (k <= 0) {
+            break;
+        }
+        n += k;
+        if (n == size - 1) {
+            p = (char *)realloc(text, (size_t)(size * 2));
+            if (!p) {
+                free(text);
+                return NULL;
+            }
+            text = p;
+            size *= 2;
+        }
+    }
+    if (text) {
+        text[n] = '\0';
+    }
+    return text;
+}
+
+/*
+ * Merge the current program's bits into the tracefile and clear them
+ */
+void
+cover_report()
+{
+    struct cover_s *cov;
+    unsigned char *p;
+    line_t *line;
+    long *counts;
+    int *lines;
+    char *text;
+    char *rec;
+    char *end;
+    char *s;
+    FILE *fp;
+    long hit;
+    int nlines;
+    int lo;
+    int hi;
+    int mid;
+    int n;
+    int k;
+    int i;
+#ifdef HAVE_LOCK
+    int fd;
+#endif
+
+    cov = g_state->cover;
+    if (!cover_on || !cov || !cov->source || g_state->forstop > 0) {
+        return;
+    }
+
+    /* Program lines in order, with this run's hits */
+    nlines = 0;
+    for (p = g_state->txttab; p[0] != 0 || p[1] != 0; p += line->len) {
+        line = (line_t *)p;
+        nlines++;
+    }
+    lines = (int *)malloc((nlines + 1) * sizeof(int));
+    counts = (long *)malloc((nlines + 1) * sizeof(long));
+    if (!lines || !counts) {
+        goto done;
+    }
+    n = 0;
+    hit = 0L;
+    for (p = g_state->txttab; p[0] != 0 || p[1] != 0; p += line->len) {
+        line = (line_t *)p;
+        lines[n] = line->linenum;
+        counts[n] = (cov->hits[(line->linenum >> 3) & (COVER_BYTES - 1)] >>
+                     (line->linenum & 7)) & 1;
+        hit += counts[n];
+        n++;
+    }
+    if (hit == 0) {
+        goto done;
+    }
+
+    /* Read the tracefile and start it afresh, holding a lock */
+    text = NULL;
+#ifdef HAVE_LOCK
+    fd = open(infoname, O_RDWR | O_CREAT, 0644);
+    fp = fd >= 0 ? fdopen(fd, "r+") : NULL;
+    if (fp) {
+        lockf(fd, F_LOCK, 0L);
+        text = slurp(fp);
+        rewind(fp);
+    }
+#else
+    fp = fopen(infoname, "r");
+    text = fp ? slurp(fp) : (char *)calloc(1, 1);
+    if (fp) {
+        fclose(fp);
+    }
+    fp = fopen(infoname, "w");
+#endif
+    if (!fp || !text) {
+        fprintf(stderr, "Cannot write %s\n", infoname);
+        if (fp) {
+            fclose(fp);
+        }
+        if (text) {
+            free(text);
+        }
+        goto done;
+    }
+
+    /* Copy the records of other files, add up the counts of ours */
+    rec = text;
+    while (*rec) {
+        end = strstr(rec, "end_of_record\n");
+        end = end ? end + 14 : rec + strlen(rec);
+        s = strstr(rec, "SF:");
+        k = (int)strlen(cov->source);
+        if (s && s < end && strncmp(s + 3, cov->source, k) == 0 &&
+            s[3 + k] == '\n') {
+            for (s = rec; s && s < end; s = strchr(s, '\n')) {
+                if (*s == '\n') {
+                    s++;
+                }
+                if (strncmp(s, "DA:", 3) != 0) {
+                    continue;
+                }
+                k = atoi(s + 3);
+                lo = 0;
+                hi = nlines - 1;
+                while (lo <= hi) {
+                    mid = (lo + hi) / 2;
+                    if (lines[mid] == k) {
+                        counts[mid] += atol(strchr(s, ',') ?
+                                            strchr(s, ',') + 1 : "0");
+                        break;
+                    }
+                    if (lines[mid] < k) {
+                        lo = mid + 1;
+                    } else {
+                        hi = mid - 1;
+                    }
+                }
+            }
+        } else {
+            fwrite(rec, 1, (size_t)(end - rec), fp);
+        }
+        rec = end;
+    }
+    free(text);
+
+    fprintf(fp, "TN:\nSF:%s\n", cov->source);
+    hit = 0L;
+    for (i = 0; i < nlines; i++) {
+        fprintf(fp, "DA:%d,%ld\n", lines[i], counts[i]);
+        if (counts[i] > 0) {
+            hit++;
+        }
+    }
+    fprintf(fp, "LF:%d\nLH:%ld\nend_of_record\n", nlines, hit);
+    fflush(fp);
+#ifdef HAVE_LOCK
+    if (ftruncate(fd, (off_t)ftell(fp)) != 0) {
+        fprintf(stderr, "Cannot write %s\n", infoname);
+    }
+#endif
+    fclose(fp);
+
+done:
+    memset((char *)cov->hits, 0, sizeof(cov->hits));
+    if (lines) {
+        free(lines);
+    }
+    if (counts) {
+        free(counts);
+    }
+}
+
+/*
+ * Free the current program's bitmap
+ */
+void
+cover_release()
+{
+    if (g_state->cover) {
+        if (g_state->cover->source) {
+            free(g_state->cover->source);
+        }
+        free(g_state->cover);
+        g_state->cover = NULL;
+    }
+}
+
+/*
+ * Record coverage into the lcov tracefile name
+ */
+void
+cover_start(name)
+const char *name;
+{
+    infoname = (char *)malloc(strlen(name) + 1);
+    if (infoname) {
+        strcpy(infoname, name);
+        cover_on = 1;
+    }
+}
@@ -0,0 +1,2062 @@
+/*
+ * emitc.c - Translate a BASIC program to C (gwbasic --emit-c)
+ *
+ * The program is loaded and tokenized as usual, then every line is
+ * walked with the evaluator's scanning primitives and turned into C:
+ *
+ *   - line numbers become labels (only lines that are jumped to)
+ *   - scalar variables become typed C locals: int for %, float for
+ *     plain and ! names, double for #, string_t * for $
+ *   - expressions follow the precedence and typing rules of eval.c
+ *   - GOSUB and FOR push a numbered continuation point that RETURN and
+ *     NEXT jump back to through a switch (see runtime.c)
+ *   - WHILE/WEND pairs are matched when translating
+ *
+ * The output defines basic_program() and is linked with runtime.c,
+ * strings.c, functions.c, arrays.c and error.c.  Statements that only
+ * make sense in the interpreter (LIST, LOAD, RUN, ...), computed line
+ * numbers, USR and the memory segment functions are rejected.
+ *
+ * The program is translated twice: the first pass only collects jump
+ * targets and variables, the second writes the file.
+ *
+ * --compile goes on to build an executable with the C compiler gwbasic
+ * was built with, linking libgwrt.a (runtime.o plus the interpreter's
+ * strings.o, functions.o, arrays.o and error.o).  make install puts
+ * gwbasic.h and libgwrt.a in GWRT_DIR; until then those in the build
+ * tree are used, and GWBASIC_RT names another directory holding them.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <errno.h>
+#ifndef PLATFORM_211BSD
+#include <unistd.h>
+#endif
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#define HAVE_MKDTEMP
+#endif
+
+/* K&R C compatible character tests - ctype macros may fail on old systems */
+#define IS_ALPHA(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_ALNUM(c) (IS_ALPHA(c) || IS_DIGIT(c))
+
+
+/* Toolchain for --compile, normally set by the Makefile */
+#ifndef GWRT_DIR
+#define GWRT_DIR "."
+#endif
+#ifndef GWRT_SRCDIR
+#define GWRT_SRCDIR GWRT_DIR
+#endif
+#ifndef GWRT_CC
+#define GWRT_CC "cc"
+#endif
+#ifndef GWRT_CFLAGS
+#define GWRT_CFLAGS "-O"
+#endif
+#ifndef GWRT_LIBS
+#define GWRT_LIBS "-lm"
+#endif
+
+/* Built-in function table */
+typedef struct {
+    int token;          /* Token, or 0 if only written as a name */
+    const char *name;   /* Name as parse_variable() sees it */
+    const char *cfunc;  /* Implementation in functions.c */
+    int args;           /* Argument kind, see c_function() */
+} func_t;
+
+static func_t functions[] = {
+    {TOK_SQR, "SQR", "fn_sqr", 'n'},
+    {TOK_SIN, "SIN", "fn_sin", 'n'},
+    {TOK_COS, "COS", "fn_cos", 'n'},
+    {TOK_TAN, "TAN", "fn_tan", 'n'},
+    {TOK_ATN, "ATN", "fn_atn", 'n'},
+    {TOK_LOG, "LOG", "fn_log", 'n'},
+    {TOK_EXP, "EXP", "fn_exp", 'n'},
+    {TOK_ABS, "ABS", "fn_abs", 'n'},
+    {TOK_SGN, "SGN", "fn_sgn", 'n'},
+    {TOK_INT, "INT", "fn_int", 'n'},
+    {TOK_RND, "RND", "fn_rnd", 'n'},
+    {TOK_FRE, "FRE", "fn_fre", 'n'},
+    {TOK_LEN, "LEN", "fn_len", 'i'},
+    {TOK_ASC, "ASC", "fn_asc", 'i'},
+    {TOK_VAL, "VAL", "fn_val", 'v'},
+    {TOK_CHR, "CHR$", "fn_chr", 'c'},
+    {TOK_STR, "STR$", "fn_str", 's'},
+    {TOK_LEFT, "LEFT$", "fn_left", 'l'},
+    {TOK_RIGHT, "RIGHT$", "fn_right", 'l'},
+    {TOK_MID, "MID$", "fn_mid", 'm'},
+    {0, "SPACE$", "fn_space", 'c'},
+    {0, "STRING$", "fn_string", 'g'},
+    {TOK_TIMER, "TIMER", "fn_timer", '0'},
+    {0, NULL, NULL, 0}
+};
+
+static FILE *out;               /* Output, NULL during the first pass */
+static unsigned char *targets;  /* Bitmap of line numbers jumped to */
+static int nresume;             /* Continuation points so far */
+static int maxresume;           /* Continuation points in the program */
+static int nwhile;              /* WHILE loops so far */
+static int whilestack[STACK_SIZE];  /* Open WHILE loops */
+static int whileline[STACK_SIZE];   /* Line of each open WHILE */
+static int whilesp;
+static int temps;               /* Statement created temporary strings */
+static int usedcond;            /* rt_cond is needed */
+static int usedend;             /* Something jumps to rt_end */
+static int ixrows;              /* Rows of rt_ix taken by the statement */
+static int indent;              /* Block nesting of the output */
+
+/* Forward declarations */
+static char *c_or(int *type);
+static char *c_and(int *type);
+static char *c_compare(int *type);
+static char *c_add(int *type);
+static char *c_mult(int *type);
+static char *c_power(int *type);
+static char *c_unary(int *type);
+static char *c_primary(int *type);
+static void c_statement();
+
+/*
+ * Copy a string into new memory
+ */
+static char *
+newstr(s)
+const char *s;
+{
+    char *p;
+
+    p = (char *)malloc(strlen(s) + 1);
+    if (!p) {
+        error(ERR_OUT_OF_MEM);
+        return NULL;
+    }
+    strcpy(p, s);
+    return p;
+}
+
+/*
+ * Substitute up to two strings into a format, freeing them
+ */
+static char *
+build(fmt, a, b)
+const char *fmt;
+char *a;
+char *b;
+{
+    char *p;
+    size_t len;
+
+    len = strlen(fmt) + 1;
+    if (a) {
+        len += strlen(a);
+    }
+    if (b) {
+        len += strlen(b);
+    }
+    p = (char *)malloc(len);
+    if (!p) {
+        error(ERR_OUT_OF_MEM);
+        return NULL;
+    }
+    sprintf(p, fmt, a ? a : "", b ? b : "");
+    if (a) {
+        free(a);
+    }
+    if (b) {
+        free(b);
+    }
+    return p;
+}
+
+/*
+ * Write one line of output at the current indentation
+ */
+static void
+emit(s)
+const char *s;
+{
+    int i;
+
+    if (!out) {
+        return;
+    }
+    for (i = 0; i <= indent; i++) {
+        fputs("    ", out);
+    }
+    fputs(s, out);
+    fputc('\n', out);
+}
+
+/*
+ * Write a line built from a format and up to two owned strings
+ */
+static void
+emitf(fmt, a, b)
+const char *fmt;
+char *a;
+char *b;
+{
+    char *s;
+
+    s = build(fmt, a, b);
+    emit(s);
+    free(s);
+}
+
+/*
+ * Write a line with one number in it
+ */
+static void
+emitn(fmt, n)
+const char *fmt;
+int n;
+{
+    char buf[80];
+
+    sprintf(buf, fmt, n);
+    emit(buf);
+}
+
+/*
+ * Write a label - labels are not indented
+ */
+static void
+label(fmt, n)
+const char *fmt;
+int n;
+{
+    if (out) {
+        fprintf(out, fmt, n);
+        fputc('\n', out);
+    }
+}
+
+/*
+ * Reject a statement the translator cannot handle
+ */
+static void
+unsupported()
+{
+    fprintf(stderr, "Cannot translate statement in %d\n", g_state->curlin);
+    g_state->errnum = ERR_NONE;
+    longjmp(g_state->errtrap, 1);
+}
+
+/*
+ * Type constant as C source
+ */
+static char *
+type_name(type)
+int type;
+{
+    switch (type) {
+        case TYPE_INT: return "TYPE_INT";
+        case TYPE_DBL: return "TYPE_DBL";
+        case TYPE_STR: return "TYPE_STR";
+    }
+    return "TYPE_SNG";
+}
+
+/*
+ * value_t member for a type
+ */
+static char *
+field_name(type)
+int type;
+{
+    switch (type) {
+        case TYPE_INT: return "intval";
+        case TYPE_DBL: return "dblval";
+        case TYPE_STR: return "strval";
+    }
+    return "sngval";
+}
+
+/*
+ * Type implied by a name's suffix
+ */
+static int
+suffix_type(name)
+const char *name;
+{
+    while (*name) {
+        switch (*name++) {
+            case '$': return TYPE_STR;
+            case '%': return TYPE_INT;
+            case '#': return TYPE_DBL;
+        }
+    }
+    return TYPE_SNG;
+}
+
+/*
+ * C identifier for a variable: type prefix and the BASIC name
+ */
+static char *
+var_name(var)
+var_t *var;
+{
+    char buf[NAMLEN * 3 + 3];
+    char *p;
+    char *s;
+
+    p = buf;
+    switch (var->type) {
+        case TYPE_INT: *p++ = 'i'; break;
+        case TYPE_DBL: *p++ = 'd'; break;
+        case TYPE_STR: *p++ = 's'; break;
+        default: *p++ = 'f'; break;
+    }
+    *p++ = '_';
+    for (s = var->name; *s; s++) {
+        if (IS_ALNUM(*s)) {
+            *p++ = *s;
+        } else {
+            sprintf(p, "_%02X", *s & 0xFF);
+            p += 3;
+        }
+    }
+    *p = '\0';
+    return newstr(buf);
+}
+
+/*
+ * Convert an expression between numeric types
+ */
+static char *
+convert(e, from, to)
+char *e;
+int from;
+int to;
+{
+    if (from == to) {
+        return e;
+    }
+    if (from == TYPE_STR || to == TYPE_STR) {
+        free(e);
+        error(ERR_TYPE_MISM);
+        return NULL;
+    }
+    switch (to) {
+        case TYPE_INT: return build("(int)(%s)", e, NULL);
+        case TYPE_SNG: return build("(float)(%s)", e, NULL);
+    }
+    return build("(double)(%s)", e, NULL);
+}
+
+/*
+ * Translate an expression of any type
+ */
+static char *
+c_expr(type)
+int *type;
+{
+    return c_or(type);
+}
+
+/*
+ * Translate a numeric expression and convert it to type
+ */
+static char *
+c_numeric(type)
+int type;
+{
+    char *e;
+    int etype;
+
+    e = c_expr(&etype);
+    return convert(e, etype, type);
+}
+
+/*
+ * Translate a string expression
+ */
+static char *
+c_string()
+{
+    char *e;
+    int etype;
+
+    e = c_expr(&etype);
+    if (etype != TYPE_STR) {
+        free(e);
+        syntax_error();
+        return NULL;
+    }
+    return e;
+}
+
+/*
+ * Read a line number for a jump and mark it as a target
+ * Only constant line numbers can be translated
+ */
+static int
+c_linenum()
+{
+    long n;
+
+    skip_spaces();
+    if (!IS_DIGIT(peek_char())) {
+        unsupported();
+    }
+    n = 0L;
+    while (IS_DIGIT(peek_char())) {
+        n = n * 10L + (get_next_char() - '0');
+        if (n > (long)MAXLIN) {
+            error(ERR_UNDEF_LINE);
+        }
+    }
+    if (!find_line((int)n)) {
+        error(ERR_UNDEF_LINE);
+    }
+    targets[n >> 3] |= 1 << (n & 7);
+    return (int)n;
+}
+
+/*
+ * Number literal - same rules as parse_number()
+ */
+static char *
+c_number(type)
+int *type;
+{
+    char numbuf[80];
+    char buf[80];
+    char *p;
+    int c;
+    int has_dot;
+    int has_exp;
+
+    p = numbuf;
+    has_dot = 0;
+    has_exp = 0;
+    *type = TYPE_INT;
+
+    while (1) {
+        c = peek_char();
+        if (IS_DIGIT(c)) {
+            *p++ = get_next_char();
+        } else if (c == '.' && !has_dot && !has_exp) {
+            *p++ = get_next_char();
+            has_dot = 1;
+            *type = TYPE_SNG;
+        } else if ((c == 'E' || c == 'e' || c == 'D' || c == 'd') && !has_exp) {
+            *p++ = 'E';
+            get_next_char();
+            has_exp = 1;
+            *type = (c == 'D' || c == 'd') ? TYPE_DBL : TYPE_SNG;
+            c = peek_char();
+            if (c == '+' || c == '-') {
+                *p++ = get_next_char();
+            }
+        } else {
+            break;
+        }
+        if (p - numbuf >= 79) {
+            break;
+        }
+    }
+    *p = '\0';
+
+    c = peek_char();
+    if (c == '%') {
+        get_next_char();
+        *type = TYPE_INT;
+    } else if (c == '!') {
+        get_next_char();
+        *type = TYPE_SNG;
+    } else if (c == '#') {
+        get_next_char();
+        *type = TYPE_DBL;
+    }
+
+    /* Print the value the interpreter would have computed */
+    switch (*type) {
+        case TYPE_INT:
+            sprintf(buf, "%d", atoi(numbuf));
+            break;
+        case TYPE_SNG:
+            sprintf(buf, "((float)%.9g)", (double)(float)atof(numbuf));
+            break;
+        default:
+            sprintf(buf, "((double)%.17g)", atof(numbuf));
+            break;
+    }
+    return newstr(buf);
+}
+
+/*
+ * String literal as a temporary string
+ */
+static char *
+c_literal()
+{
+    char buf[256 * 4 + 16];
+    char *p;
+    int c;
+    int n;
+
+    get_next_char();  /* Opening quote */
+
+    p = buf;
+    strcpy(p, "rt_lit(\"");
+    p += strlen(p);
+    n = 0;
+    while (1) {
+        c = peek_char();
+        if (c == '"' || c == '\0' || c == '\n' || n >= 255) {
+            break;
+        }
+        get_next_char();
+        n++;
+        if (c == '"' || c == '\\' || c == '?') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c < ' ' || c > '~') {
+            sprintf(p, "\\%03o", c & 0xFF);
+            p += 4;
+        } else {
+            *p++ = c;
+        }
+    }
+    strcpy(p, "\")");
+
+    if (peek_char() == '"') {
+        get_next_char();
+    }
+    temps = 1;
+    return newstr(buf);
+}
+
+/*
+ * Row of rt_ix for one array reference.  Every reference in a
+ * statement gets its own, so neither a reference nested in a subscript
+ * nor one beside it in the expression (A(J) - A(J+1)) writes to a row
+ * that another is still using.
+ */
+static int
+ix_row()
+{
+    if (ixrows >= RT_ROWS) {
+        error(ERR_STRING_COMP);
+    }
+    return ixrows++;
+}
+
+/*
+ * Array element reference - returns a value_t * expression
+ * Subscripts go through a row of rt_ix of their own (see ix_row())
+ */
+static char *
+c_element(name, statement)
+const char *name;
+int statement;
+{
+    char buf[NAMLEN + 64];
+    char *e;
+    char *sub;
+    int row;
+    int n;
+
+    row = ix_row();
+    get_next_char();  /* Skip '(' */
+    e = newstr("");
+    n = 0;
+    while (n < 8) {
+        sub = c_numeric(TYPE_INT);
+        sprintf(buf, "rt_ix[%d][%d] = ", row, n);
+        sub = build("%s%s", newstr(buf), sub);
+        if (statement) {
+            /* Subscripts as separate statements before the access */
+            emitf("%s;", sub, NULL);
+        } else {
+            e = build("%s%s, ", e, sub);
+        }
+        n++;
+        skip_spaces();
+        if (peek_char() == ',') {
+            get_next_char();
+        } else {
+            break;
+        }
+    }
+    skip_spaces();
+    if (peek_char() == ')') {
+        get_next_char();
+    } else {
+        syntax_error();
+    }
+
+    sprintf(buf, "array_element(\"%s\", rt_ix[%d], %d)", name, row, n);
+    if (statement) {
+        free(e);
+        return newstr(buf);
+    }
+    return build("(%s%s)", e, newstr(buf));
+}
+
+/*
+ * Built-in function call; the name or token has been read
+ */
+static char *
+c_function(f, type)
+func_t *f;
+int *type;
+{
+    char *a;
+    char *b;
+    char *call;
+    int btype;
+
+    /* TIMER: no argument list */
+    if (f->args == '0') {
+        *type = TYPE_DBL;
+        return build("%s()", newstr(f->cfunc), NULL);
+    }
+
+    skip_spaces();
+    if (peek_char() != '(') {
+        syntax_error();
+    }
+    get_next_char();
+
+    call = build("%s(", newstr(f->cfunc), NULL);
+    switch (f->args) {
+        case 'n':
+            /* Numeric argument and result */
+            a = c_numeric(TYPE_DBL);
+            *type = TYPE_DBL;
+            call = build("%s%s)", call, a);
+            break;
+
+        case 'i':
+        case 'v':
+            /* String argument, numeric result */
+            a = c_string();
+            *type = TYPE_DBL;
+            call = build(f->args == 'i' ? "(double)%s%s)" : "%s%s)", call, a);
+            break;
+
+        case 'c':
+        case 's':
+            /* CHR$ and STR$ */
+            a = c_numeric(f->args == 'c' ? TYPE_INT : TYPE_DBL);
+            *type = TYPE_STR;
+            call = build("rt_tmp(%s%s))", call, a);
+            break;
+
+        case 'g':
+            /* STRING$: a count, then a character code or a string */
+            a = c_numeric(TYPE_INT);
+            skip_spaces();
+            if (peek_char() == ',') {
+                get_next_char();
+            }
+            b = c_expr(&btype);
+            if (btype == TYPE_STR) {
+                b = build("fn_asc(%s)", b, NULL);
+            } else {
+                b = convert(b, btype, TYPE_INT);
+            }
+            *type = TYPE_STR;
+            call = build("rt_tmp(%s%s))", call, build("%s, %s", a, b));
+            break;
+
+        default:
+            /* LEFT$, RIGHT$, MID$ */
+            a = c_string();
+            skip_spaces();
+            if (peek_char() == ',') {
+                get_next_char();
+            }
+            a = build("%s, %s", a, c_numeric(TYPE_INT));
+            if (f->args == 'm') {
+                b = newstr("255");
+                skip_spaces();
+                if (peek_char() == ',') {
+                    get_next_char();
+                    free(b);
+                    b = c_numeric(TYPE_INT);
+                }
+                a = build("%s, %s", a, b);
+            }
+            *type = TYPE_STR;
+            call = build("rt_tmp(%s%s))", call, a);
+            break;
+    }
+    if (*type == TYPE_STR) {
+        temps = 1;
+    }
+
+    skip_spaces();
+    if (peek_char() == ')') {
+        get_next_char();
+    }
+    return call;
+}
+
+/*
+ * Variable, array element or named function
+ */
+static char *
+c_variable(type)
+int *type;
+{
+    char varname[NAMLEN+1];
+    char *p;
+    char *e;
+    int c;
+    int i;
+    var_t *var;
+
+    p = varname;
+    while (1) {
+        c = peek_char();
+        if (IS_ALNUM(c) || c == '.') {
+            c = get_next_char();
+            if (p - varname < NAMLEN) {
+                *p++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+            }
+        } else if (c == '$' || c == '%' || c == '!' || c == '#') {
+            if (p - varname < NAMLEN) {
+                *p++ = get_next_char();
+            } else {
+                get_next_char();
+            }
+            break;
+        } else {
+            break;
+        }
+    }
+    *p = '\0';
+
+    for (i = 0; functions[i].name != NULL; i++) {
+        if (strcmp(varname, functions[i].name) == 0) {
+            return c_function(&functions[i], type);
+        }
+    }
+    if (usr_index(varname) >= 0) {
+        unsupported();
+    }
+
+    skip_spaces();
+    if (peek_char() == '(') {
+        *type = suffix_type(varname);
+        e = c_element(varname, 0);
+        return build("%s->%s", e, newstr(field_name(*type)));
+    }
+
+    var = find_variable(varname, 1);
+    *type = var->type;
+    return var_name(var);
+}
+
+/*
+ * Primary expression: number, string, variable, function, (expr)
+ */
+static char *
+c_primary(type)
+int *type;
+{
+    char *e;
+    int c;
+    int token;
+    int i;
+
+    skip_spaces();
+    c = peek_char();
+
+    if (IS_DIGIT(c) || (c == '.' && IS_DIGIT(g_state->txtptr[1] & 0xFF))) {
+        return c_number(type);
+    }
+
+    if (c == '"') {
+        *type = TYPE_STR;
+        return c_literal();
+    }
+
+    if (c == '(') {
+        get_next_char();
+        e = c_expr(type);
+        skip_spaces();
+        if (peek_char() == ')') {
+            get_next_char();
+        } else {
+            syntax_error();
+        }
+        return e;
+    }
+
+    if (IS_ALPHA(c)) {
+        return c_variable(type);
+    }
+
+    if ((c & 0xFF) == 0xFF) {
+        get_next_char();
+        token = (0xFF << 8) | get_next_char();
+        for (i = 0; functions[i].name != NULL; i++) {
+            if (functions[i].token == token) {
+                return c_function(&functions[i], type);
+            }
+        }
+        unsupported();
+    }
+
+    /* Nothing there - zero, as in expr_primary() */
+    *type = TYPE_SNG;
+    return newstr("((float)0)");
+}
+
+/*
+ * Unary operators: +, -, NOT
+ */
+static char *
+c_unary(type)
+int *type;
+{
+    char *e;
+
+    skip_spaces();
+
+    if (match_token(TOK_PLUS) || peek_char() == '+') {
+        if (peek_char() == '+') {
+            get_next_char();
+        }
+        return c_unary(type);
+    }
+
+    if (match_token(TOK_MINUS) || peek_char() == '-') {
+        if (peek_char() == '-') {
+            get_next_char();
+        }
+        e = c_unary(type);
+        if (*type == TYPE_STR) {
+            free(e);
+            syntax_error();
+        }
+        return build("(-(%s))", e, NULL);
+    }
+
+    if (match_token(TOK_NOT)) {
+        e = c_unary(type);
+        e = convert(e, *type, TYPE_INT);
+        *type = TYPE_INT;
+        return build("(~%s)", e, NULL);
+    }
+
+    return c_primary(type);
+}
+
+/*
+ * Power operator: ^
+ */
+static char *
+c_power(type)
+int *type;
+{
+    char *left;
+    char *right;
+    int rtype;
+
+    left = c_unary(type);
+
+    while (match_token(TOK_POWER) || peek_char() == '^') {
+        if (peek_char() == '^') {
+            get_next_char();
+        }
+        right = c_unary(&rtype);
+        left = convert(left, *type, TYPE_DBL);
+        right = convert(right, rtype, TYPE_DBL);
+        left = build("pow(%s, %s)", left, right);
+        *type = TYPE_DBL;
+    }
+
+    return left;
+}
+
+/*
+ * Multiplicative operators: *, /, \, MOD
+ */
+static char *
+c_mult(type)
+int *type;
+{
+    char *left;
+    char *right;
+    int rtype;
+    int op;
+
+    left = c_power(type);
+
+    while (1) {
+        skip_spaces();
+
+        if (match_token(TOK_MULT) || peek_char() == '*') {
+            op = '*';
+            if (peek_char() == '*') {
+                get_next_char();
+            }
+        } else if (match_token(TOK_DIV) || peek_char() == '/') {
+            op = '/';
+            if (peek_char() == '/') {
+                get_next_char();
+            }
+        } else if (match_token(TOK_IDIV) || peek_char() == '\\') {
+            op = '\\';
+            if (peek_char() == '\\') {
+                get_next_char();
+            }
+        } else if (match_token(TOK_MOD)) {
+            op = '%';
+        } else {
+            break;
+        }
+
+        right = c_power(&rtype);
+
+        if (op == '*' && *type == TYPE_INT && rtype == TYPE_INT) {
+            left = build("(%s * %s)", left, right);
+        } else if (op == '*' || op == '/') {
+            left = convert(left, *type, TYPE_DBL);
+            right = convert(right, rtype, TYPE_DBL);
+            left = build(op == '*' ? "(%s * %s)" : "rt_div(%s, %s)",
+                         left, right);
+            *type = TYPE_DBL;
+        } else {
+            left = convert(left, *type, TYPE_INT);
+            right = convert(right, rtype, TYPE_INT);
+            left = build(op == '%' ? "rt_mod(%s, %s)" : "rt_idiv(%s, %s)",
+                         left, right);
+            *type = TYPE_INT;
+        }
+    }
+
+    return left;
+}
+
+/*
+ * Additive operators: +, -
+ */
+static char *
+c_add(type)
+int *type;
+{
+    char *left;
+    char *right;
+    int rtype;
+    int op;
+
+    left = c_mult(type);
+
+    while (1) {
+        skip_spaces();
+
+        if (match_token(TOK_PLUS) || peek_char() == '+') {
+            op = '+';
+            if (peek_char() == '+') {
+                get_next_char();
+            }
+        } else if (match_token(TOK_MINUS) || peek_char() == '-') {
+            op = '-';
+            if (peek_char() == '-') {
+                get_next_char();
+            }
+        } else {
+            break;
+        }
+
+        right = c_mult(&rtype);
+
+        if (*type == TYPE_STR && rtype == TYPE_STR && op == '+') {
+            left = build("rt_tmp(concat_strings(%s, %s))", left, right);
+            temps = 1;
+        } else if (*type == TYPE_INT && rtype == TYPE_INT) {
+            left = build(op == '+' ? "(%s + %s)" : "(%s - %s)", left, right);
+        } else {
+            left = convert(left, *type, TYPE_DBL);
+            right = convert(right, rtype, TYPE_DBL);
+            left = build(op == '+' ? "(%s + %s)" : "(%s - %s)", left, right);
+            *type = TYPE_DBL;
+        }
+    }
+
+    return left;
+}
+
+/*
+ * Comparison operators: =, <>, <, >, <=, >= (one per expression)
+ */
+static char *
+c_compare(type)
+int *type;
+{
+    char *left;
+    char *right;
+    const char *op;
+    char fmt[64];
+    int rtype;
+
+    left = c_add(type);
+
+    skip_spaces();
+    if (match_token(TOK_EQ) || peek_char() == '=') {
+        if (peek_char() == '=') {
+            get_next_char();
+        }
+        op = "==";
+    } else if (match_token(TOK_NE)) {
+        op = "!=";
+    } else if (match_token(TOK_LT) || peek_char() == '<') {
+        if (peek_char() == '<') {
+            get_next_char();
+        }
+        op = "<";
+    } else if (match_token(TOK_GT) || peek_char() == '>') {
+        if (peek_char() == '>') {
+            get_next_char();
+        }
+        op = ">";
+    } else if (match_token(TOK_LE)) {
+        op = "<=";
+    } else if (match_token(TOK_GE)) {
+        op = ">=";
+    } else {
+        return left;
+    }
+
+    right = c_add(&rtype);
+
+    if (*type == TYPE_STR && rtype == TYPE_STR) {
+        sprintf(fmt, "(compare_strings(%%s, %%s) %s 0 ? -1 : 0)", op);
+    } else {
+        left = convert(left, *type, TYPE_DBL);
+        right = convert(right, rtype, TYPE_DBL);
+        sprintf(fmt, "(%%s %s %%s ? -1 : 0)", op);
+    }
+    *type = TYPE_INT;
+    return build(fmt, left, right);
+}
+
+/*
+ * AND operator
+ */
+static char *
+c_and(type)
+int *type;
+{
+    char *left;
+    char *right;
+    int rtype;
+
+    left = c_compare(type);
+
+    while (match_token(TOK_AND)) {
+        right = c_compare(&rtype);
+        left = convert(left, *type, TYPE_INT);
+        right = convert(right, rtype, TYPE_INT);
+        left = build("(%s & %s)", left, right);
+        *type = TYPE_INT;
+    }
+
+    return left;
+}
+
+/*
+ * OR, XOR operators
+ */
+static char *
+c_or(type)
+int *type;
+{
+    char *left;
+    char *right;
+    int rtype;
+    int op;
+
+    left = c_and(type);
+
+    while (1) {
+        if (match_token(TOK_OR)) {
+            op = '|';
+        } else if (match_token(TOK_XOR)) {
+            op = '^';
+        } else {
+            break;
+        }
+
+        right = c_and(&rtype);
+        left = convert(left, *type, TYPE_INT);
+        right = convert(right, rtype, TYPE_INT);
+        left = build(op == '|' ? "(%s | %s)" : "(%s ^ %s)", left, right);
+        *type = TYPE_INT;
+    }
+
+    return left;
+}
+
+/*
+ * Release the temporary strings of a finished statement
+ */
+static void
+c_release()
+{
+    if (temps) {
+        emit("rt_release();");
+        temps = 0;
+    }
+}
+
+/*
+ * Condition of IF or WHILE as a C expression
+ * Temporaries are released before the branch is taken
+ */
+static char *
+c_condition()
+{
+    char *e;
+    int etype;
+
+    temps = 0;
+    e = c_expr(&etype);
+    if (etype == TYPE_STR) {
+        free(e);
+        error(ERR_TYPE_MISM);
+    }
+    e = build("%s != 0", e, NULL);
+    if (temps) {
+        emitf("rt_cond = %s;", e, NULL);
+        c_release();
+        usedcond = 1;
+        return newstr("rt_cond");
+    }
+    return e;
+}
+
+/*
+ * Read a variable name as do_let() does
+ */
+static void
+read_name(name, suffix)
+char *name;
+int suffix;
+{
+    char *p;
+    int c;
+
+    skip_spaces();
+    p = name;
+    while (1) {
+        c = peek_char();
+        if (!(IS_ALNUM(c) || c == '.' ||
+              (suffix && (c == '$' || c == '%' || c == '!' || c == '#')))) {
+            break;
+        }
+        if (p - name < NAMLEN) {
+            *p++ = get_next_char();
+        } else {
+            get_next_char();
+        }
+    }
+    *p = '\0';
+    if (name[0] == '\0') {
+        syntax_error();
+    }
+}
+
+/*
+ * Skip the '=' of an assignment
+ */
+static void
+c_equals()
+{
+    skip_spaces();
+    if (peek_char() == '=' || match_token(TOK_EQ)) {
+        if (peek_char() == '=') {
+            get_next_char();
+        }
+    } else {
+        syntax_error();
+    }
+}
+
+/*
+ * Assignment: [LET] var = expr or [LET] array(subscripts) = expr
+ */
+static void
+c_let()
+{
+    char name[NAMLEN+1];
+    char *dest;
+    char *e;
+    int type;
+    int etype;
+    var_t *var;
+
+    read_name(name, 1);
+
+    skip_spaces();
+    if (peek_char() == '(') {
+        type = suffix_type(name);
+        dest = c_element(name, 1);
+        c_equals();
+        e = c_expr(&etype);
+        dest = build("%s->%s", dest, newstr(field_name(type)));
+    } else {
+        c_equals();
+        e = c_expr(&etype);
+        var = find_variable(name, 1);
+        type = var->type;
+        dest = var_name(var);
+    }
+
+    if (type == TYPE_STR || etype == TYPE_STR) {
+        if (type != etype) {
+            error(ERR_TYPE_MISM);
+        }
+        emitf("rt_let(&%s, %s);", dest, e);
+    } else {
+        emitf("%s = %s;", dest, convert(e, etype, type));
+    }
+    c_release();
+}
+
+/*
+ * PRINT statement
+ */
+static void
+c_print()
+{
+    char buf[32];
+    char *e;
+    int type;
+    int newline;
+
+    emit("rt_print_begin();");
+    newline = 1;
+
+    while (1) {
+        skip_spaces();
+        if (peek_char() == '\0' || peek_char() == ':' ||
+            peek_char() == TOK_ELSE) {
+            break;
+        }
+
+        if (peek_char() == ';') {
+            get_next_char();
+            newline = 0;
+            continue;
+        }
+
+        if (peek_char() == ',') {
+            get_next_char();
+            emit("rt_print_comma();");
+            newline = 0;
+            continue;
+        }
+
+        if (match_token(TOK_TAB)) {
+            if (peek_char() == '(') {
+                get_next_char();
+                e = c_numeric(TYPE_INT);
+                if (peek_char() == ')') {
+                    get_next_char();
+                }
+            } else {
+                e = c_numeric(TYPE_INT);
+            }
+            emitf("rt_print_tab(%s);", e, NULL);
+            newline = 0;
+            continue;
+        }
+
+        e = c_expr(&type);
+        switch (type) {
+            case TYPE_INT:
+                emitf("rt_print_int(%s);", e, NULL);
+                break;
+            case TYPE_STR:
+                emitf("rt_print_str(%s);", e, NULL);
+                break;
+            default:
+                sprintf(buf, "rt_print_num(%%s, %d);",
+                        type == TYPE_SNG ? 10 : 16);
+                emitf(buf, e, NULL);
+                break;
+        }
+        newline = 1;
+    }
+
+    if (newline) {
+        emit("putchar('\\n');");
+    }
+    c_release();
+}
+
+/*
+ * INPUT statement
+ */
+static void
+c_input()
+{
+    char name[NAMLEN+1];
+    char prompt[256 * 4 + 4];
+    char *p;
+    char *e;
+    int c;
+    int n;
+    var_t *var;
+
+    skip_spaces();
+    strcpy(prompt, "NULL");
+    if (peek_char() == '"') {
+        get_next_char();
+        p = prompt;
+        *p++ = '"';
+        n = 0;
+        while ((c = peek_char()) != '"' && c != '\0' && n < 255) {
+            get_next_char();
+            n++;
+            if (c == '\\' || c == '?' || c == '%') {
+                /* The prompt is printed with "%s", so % is safe */
+                if (c != '%') {
+                    *p++ = '\\';
+                }
+                *p++ = c;
+            } else if (c < ' ' || c > '~') {
+                sprintf(p, "\\%03o", c & 0xFF);
+                p += 4;
+            } else {
+                *p++ = c;
+            }
+        }
+        *p++ = '"';
+        *p = '\0';
+        if (peek_char() == '"') {
+            get_next_char();
+        }
+        skip_spaces();
+        if (peek_char() == ';') {
+            get_next_char();
+        }
+    }
+
+    emitf("if (rt_input(%s)) {", newstr(prompt), NULL);
+    indent++;
+    while (1) {
+        read_name(name, 1);
+        var = find_variable(name, 1);
+        if (var->type == TYPE_STR) {
+            emitf("if (rt_input_more()) rt_let(&%s, rt_input_str());",
+                  var_name(var), NULL);
+            temps = 1;
+        } else {
+            e = convert(newstr("rt_input_num()"), TYPE_DBL, var->type);
+            emitf("if (rt_input_more()) %s = %s;", var_name(var), e);
+        }
+        skip_spaces();
+        if (peek_char() != ',') {
+            break;
+        }
+        get_next_char();
+    }
+    c_release();
+    indent--;
+    emit("}");
+}
+
+/*
+ * Statements of an IF branch, up to ELSE or the end of the line
+ */
+static void
+c_branch()
+{
+    skip_spaces();
+    if (IS_DIGIT(peek_char())) {
+        emitn("goto L%d;", c_linenum());
+        return;
+    }
+    while (peek_char() != '\0' && peek_char() != TOK_ELSE) {
+        c_statement();
+        skip_spaces();
+        if (peek_char() != ':') {
+            break;
+        }
+        get_next_char();
+    }
+    /* Anything else left before ELSE is ignored, as by the interpreter */
+    while (peek_char() != '\0' && peek_char() != TOK_ELSE) {
+        get_next_char();
+    }
+}
+
+/*
+ * IF statement
+ */
+static void
+c_if()
+{
+    emitf("if (%s) {", c_condition(), NULL);
+
+    skip_spaces();
+    match_token(TOK_THEN);
+
+    indent++;
+    c_branch();
+    indent--;
+
+    if (peek_char() == TOK_ELSE) {
+        get_next_char();
+        emit("} else {");
+        indent++;
+        c_branch();
+        indent--;
+    }
+    emit("}");
+}
+
+/*
+ * FOR statement
+ */
+static void
+c_for()
+{
+    char name[NAMLEN+1];
+    char buf[80];
+    char *limit;
+    char *step;
+    var_t *var;
+
+    read_name(name, 0);
+    c_equals();
+
+    var = find_variable(name, 1);
+    if (var->type == TYPE_STR) {
+        error(ERR_TYPE_MISM);
+    }
+    emitf("%s = %s;", var_name(var),
+          convert(c_numeric(TYPE_DBL), TYPE_DBL, var->type));
+
+    skip_spaces();
+    if (!match_token(TOK_TO)) {
+        syntax_error();
+    }
+    limit = c_numeric(TYPE_DBL);
+
+    step = NULL;
+    skip_spaces();
+    if (match_token(TOK_STEP)) {
+        step = c_numeric(TYPE_DBL);
+    }
+
+    /* Compiled loops run serially - skip PARALLEL [REDUCE v, ...] */
+    if (match_token(TOK_PARALLEL)) {
+        if (match_token(TOK_REDUCE)) {
+            skip_to_eol();
+        }
+    }
+
+    nresume++;
+    sprintf(buf, "rt_for(&%%s, %s, %%s, %d);", type_name(var->type),
+            nresume);
+    emitf(buf, var_name(var), build("%s, %s", limit,
+                                     step ? step : newstr("1.0")));
+    c_release();
+    label("R%d: ;", nresume);
+}
+
+/*
+ * NEXT statement
+ */
+static void
+c_next()
+{
+    char name[NAMLEN+1];
+    char buf[80];
+    var_t *var;
+
+    skip_spaces();
+    if (IS_ALPHA(peek_char())) {
+        read_name(name, 0);
+        var = find_variable(name, 1);
+        sprintf(buf, "if ((rt_target = rt_next(&%%s, %s)) != 0) "
+                "goto rt_dispatch;", type_name(var->type));
+        emitf(buf, var_name(var), NULL);
+    } else {
+        emit("if ((rt_target = rt_next(NULL, 0)) != 0) goto rt_dispatch;");
+    }
+}
+
+/*
+ * WHILE statement
+ */
+static void
+c_while()
+{
+    if (whilesp >= STACK_SIZE) {
+        error(ERR_OUT_OF_MEM);
+    }
+    nwhile++;
+    whilestack[whilesp] = nwhile;
+    whileline[whilesp] = g_state->curlin;
+    whilesp++;
+
+    label("W%d: ;", nwhile);
+    emitf("if (!(%s)) {", c_condition(), NULL);
+    indent++;
+    emitn("goto WE%d;", nwhile);
+    indent--;
+    emit("}");
+}
+
+/*
+ * WEND statement
+ */
+static void
+c_wend()
+{
+    if (whilesp == 0) {
+        syntax_error();
+    }
+    whilesp--;
+    emitn("goto W%d;", whilestack[whilesp]);
+    label("WE%d: ;", whilestack[whilesp]);
+}
+
+/*
+ * Jump to the end of the program (END, STOP, SYSTEM)
+ */
+static void
+c_end()
+{
+    usedend = 1;
+    emit("goto rt_end;");
+}
+
+/*
+ * DIM statement
+ */
+static void
+c_dim()
+{
+    char name[NAMLEN+1];
+    char buf[NAMLEN + 64];
+    char *dim;
+    int row;
+    int n;
+
+    while (1) {
+        read_name(name, 1);
+        skip_spaces();
+        if (peek_char() != '(') {
+            syntax_error();
+        }
+        get_next_char();
+
+        row = ix_row();
+        n = 0;
+        while (n < 8) {
+            dim = c_numeric(TYPE_INT);
+            sprintf(buf, "rt_ix[%d][%d] = %%s + 1;", row, n);
+            emitf(buf, dim, NULL);
+            n++;
+            skip_spaces();
+            if (peek_char() == ',') {
+                get_next_char();
+            } else {
+                break;
+            }
+        }
+        skip_spaces();
+        if (peek_char() != ')') {
+            syntax_error();
+        }
+        get_next_char();
+
+        sprintf(buf, "dimension_array(\"%s\", rt_ix[%d], %d, %s);",
+                name, row, n, type_name(suffix_type(name)));
+        emit(buf);
+        c_release();
+
+        skip_spaces();
+        if (peek_char() != ',') {
+            break;
+        }
+        get_next_char();
+    }
+}
+
+/*
+ * Translate one statement - mirrors execute_statement()
+ */
+static void
+c_statement()
+{
+    int token;
+    int c;
+
+    temps = 0;
+    ixrows = 0;
+    skip_spaces();
+    c = peek_char();
+    if (c == ':') {
+        get_next_char();
+        skip_spaces();
+        c = peek_char();
+    }
+    if (c == '\0') {
+        return;
+    }
+
+    if (IS_ALPHA(c)) {
+        c_let();
+        return;
+    }
+    if (!(c & 0x80)) {
+        syntax_error();
+    }
+
+    token = get_next_char();
+    if ((token & 0xFF) == 0xFF) {
+        token = (token << 8) | get_next_char();
+    }
+
+    switch (token) {
+        case TOK_PRINT:
+            c_print();
+            break;
+
+        case TOK_INPUT:
+            c_input();
+            break;
+
+        case TOK_LET:
+            c_let();
+            break;
+
+        case TOK_IF:
+            c_if();
+            break;
+
+        case TOK_GOTO:
+            emitn("goto L%d;", c_linenum());
+            break;
+
+        case TOK_GOSUB:
+            nresume++;
+            emitn("rt_gosub(%d);", nresume);
+            emitn("goto L%d;", c_linenum());
+            label("R%d: ;", nresume);
+            break;
+
+        case TOK_RETURN:
+            emit("rt_target = rt_return();");
+            emit("goto rt_dispatch;");
+            break;
+
+        case TOK_FOR:
+            c_for();
+            break;
+
+        case TOK_NEXT:
+            c_next();
+            break;
+
+        case TOK_WHILE:
+            c_while();
+            break;
+
+        case TOK_WEND:
+            c_wend();
+            break;
+
+        case TOK_DIM:
+            c_dim();
+            break;
+
+        case TOK_READ:
+            /* There is no DATA support - READ always runs out */
+            emit("error(ERR_OUT_OF_DATA);");
+            skip_to_eol();
+            break;
+
+        case TOK_DATA:
+        case TOK_REM:
+        case TOK_ELSE:
+            skip_to_eol();
+            break;
+
+        case TOK_RESTORE:
+            break;
+
+        case TOK_END:
+            emit("putchar('\\n');");
+            c_end();
+            break;
+
+        case TOK_STOP:
+            emitn("printf(\"Break in %%d\\n\", %d);", g_state->curlin);
+            c_end();
+            break;
+
+        case TOK_SYSTEM:
+            c_end();
+            break;
+
+        default:
+            unsupported();
+            break;
+    }
+}
+
+/*
+ * Translate the whole program
+ */
+static void
+translate(source)
+const char *source;
+{
+    unsigned char *p;
+    line_t *line;
+    var_t *var;
+    int i;
+
+    nresume = 0;
+    nwhile = 0;
+    whilesp = 0;
+    ixrows = 0;
+    indent = 0;
+
+    if (out) {
+        fprintf(out, "/*\n * Generated by gwbasic --emit-c from %s\n", source);
+        fprintf(out, " * Link with runtime.c, strings.c, functions.c, ");
+        fprintf(out, "arrays.c and error.c\n */\n\n");
+        fprintf(out, "#include \"gwbasic.h\"\n\n");
+        fprintf(out, "void\nbasic_program()\n{\n");
+        for (var = g_state->varlist; var != NULL; var = var->next) {
+            switch (var->type) {
+                case TYPE_INT:
+                    emitf("int %s = 0;", var_name(var), NULL);
+                    break;
+                case TYPE_DBL:
+                    emitf("double %s = 0.0;", var_name(var), NULL);
+                    break;
+                case TYPE_STR:
+                    emitf("string_t *%s;", var_name(var), NULL);
+                    break;
+                default:
+                    emitf("float %s = 0.0;", var_name(var), NULL);
+                    break;
+            }
+        }
+        if (maxresume > 0) {
+            emit("int rt_target;");
+        }
+        if (usedcond) {
+            emit("int rt_cond;");
+        }
+        /* A variable the program only assigns is still a BASIC variable */
+        for (var = g_state->varlist; var != NULL; var = var->next) {
+            if (var->type != TYPE_STR) {
+                emitf("(void)%s;", var_name(var), NULL);
+            }
+        }
+        fputc('\n', out);
+        for (var = g_state->varlist; var != NULL; var = var->next) {
+            if (var->type == TYPE_STR) {
+                emitf("%s = alloc_string(0);", var_name(var), NULL);
+            }
+        }
+    }
+
+    p = g_state->txttab;
+    while (p[0] != 0 || p[1] != 0) {
+        line = (line_t *)p;
+        g_state->curlin = line->linenum;
+        g_state->txtptr = line->text;
+        g_state->curline_ptr = line;
+
+        if (targets[line->linenum >> 3] & (1 << (line->linenum & 7))) {
+            label("L%d:", line->linenum);
+        }
+        emitn("g_state->curlin = %d;", line->linenum);
+
+        /* Statements up to the end of the line */
+        while (1) {
+            c_statement();
+            skip_spaces();
+            if (peek_char() != ':') {
+                break;
+            }
+            get_next_char();
+        }
+
+        p += line->len;
+    }
+
+    if (whilesp > 0) {
+        g_state->curlin = whileline[whilesp - 1];
+        syntax_error();
+    }
+
+    /* GOSUB and FOR continuation points */
+    if (nresume > 0) {
+        c_end();
+        label("rt_dispatch:", 0);
+        emit("switch (rt_target) {");
+        for (i = 1; i <= nresume; i++) {
+            if (out) {
+                fprintf(out, "        case %d: goto R%d;\n", i, i);
+            }
+        }
+        emit("}");
+    }
+    maxresume = nresume;
+
+    if (usedend) {
+        label("rt_end:", 0);
+    }
+    emit("rt_release();");
+    if (out) {
+        fprintf(out, "}\n");
+    }
+}
+
+/*
+ * Translate a program file to C
+ * Writes to outname, or standard output if it is NULL
+ * Returns 0 on success
+ */
+int
+emit_c(filename, outname)
+const char *filename;
+const char *outname;
+{
+    if (load_file(filename) != 0) {
+        fprintf(stderr, "Cannot load %s\n", filename);
+        return 1;
+    }
+
+    targets = (unsigned char *)calloc((size_t)(MAXLIN / 8 + 1), 1);
+    if (!targets) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    out = NULL;
+    usedcond = 0;
+    usedend = 0;
+    maxresume = 0;
+    if (setjmp(g_state->errtrap) != 0) {
+        if (g_state->errnum != ERR_NONE) {
+            fprintf(stderr, "%s in %d\n", error_message(g_state->errnum),
+                    g_state->errlin);
+        }
+        if (out && out != stdout) {
+            fclose(out);
+            remove(outname);
+        }
+        free(targets);
+        return 1;
+    }
+
+    /* First pass finds jump targets and variables */
+    translate(filename);
+
+    if (outname) {
+        out = fopen(outname, "w");
+        if (!out) {
+            fprintf(stderr, "Cannot create %s\n", outname);
+            free(targets);
+            return 1;
+        }
+    } else {
+        out = stdout;
+    }
+    translate(filename);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(targets);
+    return 0;
+}
+
+/*
+ * Directory holding gwbasic.h and libgwrt.a: GWBASIC_RT, else where
+ * make install put them, else the tree gwbasic was built in
+ */
+static const char *
+runtime_dir()
+{
+    const char *dir;
+    char *lib;
+    FILE *fp;
+
+    dir = getenv("GWBASIC_RT");
+    if (dir && *dir) {
+        return dir;
+    }
+    lib = build("%s/libgwrt.a", newstr(GWRT_DIR), NULL);
+    fp = fopen(lib, "r");
+    free(lib);
+    if (fp) {
+        fclose(fp);
+        return GWRT_DIR;
+    }
+    return GWRT_SRCDIR;
+}
+
+/*
+ * Split a blank-separated list of options from the Makefile into
+ * argv, which has room for them; returns the new argument count
+ */
+static int
+split_args(argv, argc, list)
+char **argv;
+int argc;
+char *list;
+{
+    char *p;
+
+    for (p = strtok(list, " \t"); p; p = strtok(NULL, " \t")) {
+        argv[argc++] = p;
+    }
+    return argc;
+}
+
+/*
+ * Run the C compiler without a shell, so that file names are passed
+ * as they are; returns its exit status, or -1 if it could not run
+ */
+static int
+run_cc(argv)
+char **argv;
+{
+    int pid;
+    int w;
+    int status;
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    while ((w = wait(&status)) != pid) {
+        if (w < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/*
+ * Translate a program file and compile it to an executable
+ * Writes to outname, or the file name without .bas if it is NULL
+ * The C source goes to a private temporary directory, so no file
+ * next to the program is touched
+ * Returns 0 on success
+ */
+int
+compile_program(filename, outname)
+const char *filename;
+const char *outname;
+{
+    char *exe;
+    char *tmpdir;
+    char *csrc;
+    char *rtinc;
+    char *rtlib;
+    char *opts;
+    char *libs;
+    char **argv;
+    const char *dir;
+    char *p;
+    int argc;
+    int result;
+
+    /* Default output: prog.bas -> prog */
+    exe = newstr(outname ? outname : filename);
+    p = strrchr(exe, '.');
+    if (!outname && p && strcmp(p, ".bas") == 0) {
+        *p = '\0';
+    } else if (!outname) {
+        free(exe);
+        exe = build("%s.out", newstr(filename), NULL);
+    }
+
+    /* The translation needs a .c name that no one else can take */
+    p = getenv("TMPDIR");
+    tmpdir = build("%s/gwbasicXXXXXX", newstr(p && *p ? p : "/tmp"), NULL);
+#ifdef HAVE_MKDTEMP
+    if (!mkdtemp(tmpdir)) {
+#else
+    if (!mktemp(tmpdir) || mkdir(tmpdir, 0700) != 0) {
+#endif
+        perror(tmpdir);
+        free(tmpdir);
+        free(exe);
+        return 1;
+    }
+    csrc = build("%s/prog.c", newstr(tmpdir), NULL);
+    result = emit_c(filename, csrc);
+    if (result != 0) {
+        remove(csrc);
+        rmdir(tmpdir);
+        free(csrc);
+        free(tmpdir);
+        free(exe);
+        return result;
+    }
+
+    /* cc CFLAGS -Idir -o exe prog.c dir/libgwrt.a LIBS */
+    dir = runtime_dir();
+    rtinc = build("-I%s", newstr(dir), NULL);
+    rtlib = build("%s/libgwrt.a", newstr(dir), NULL);
+    opts = build("%s %s", newstr(GWRT_CC), newstr(GWRT_CFLAGS));
+    libs = newstr(GWRT_LIBS);
+    argv = (char **)malloc((strlen(opts) + strlen(libs) + 12) *
+                           sizeof(char *));
+    if (!argv) {
+        fprintf(stderr, "Out of memory\n");
+        result = 1;
+    } else {
+        argc = split_args(argv, 0, opts);
+        argv[argc++] = rtinc;
+        argv[argc++] = "-o";
+        argv[argc++] = exe;
+        argv[argc++] = csrc;
+        argv[argc++] = rtlib;
+        argc = split_args(argv, argc, libs);
+        argv[argc] = NULL;
+        result = run_cc(argv) != 0;
+        if (result) {
+            fprintf(stderr, "Cannot compile %s\n", filename);
+        }
+        free(argv);
+    }
+    remove(csrc);
+    rmdir(tmpdir);
+    free(libs);
+    free(opts);
+    free(rtlib);
+    free(rtinc);
+    free(csrc);
+    free(tmpdir);
+    free(exe);
+    return result;
+}
@@ -214,7 +214,7 @@ parse_string_literal()
         get_next_char();
     }
 
-    return string_from_cstr(strbuf);
+    return temp_from_cstr(strbuf);
 }
 
 /*
@@ -253,6 +253,8 @@ char *name;
     if (strcmp(name, "LEFT$") == 0) return 1;
     if (strcmp(name, "RIGHT$") == 0) return 1;
     if (strcmp(name, "MID$") == 0) return 1;
+    if (strcmp(name, "SPACE$") == 0) return 1;
+    if (strcmp(name, "STRING$") == 0) return 1;
     return 0;
 }
 
@@ -341,11 +343,14 @@ char *name;
 int *type;
 {
     value_t result;
+    value_t val;
     string_t *sarg;
     double narg;
+    int argtype;
     int n;
     int start;
     int len;
+    int c;
 
     *type = TYPE_STR;
     result.strval = NULL;
@@ -400,6 +405,29 @@ int *type;
         if (peek_char() == ')') get_next_char();
         result.strval = fn_mid(sarg, start, len);
         if (sarg) free_string(sarg);
+    } else if (strcmp(name, "SPACE$") == 0) {
+        n = eval_integer();
+        skip_spaces();
+        if (peek_char() == ')') get_next_char();
+        result.strval = fn_space(n);
+    } else if (strcmp(name, "STRING$") == 0) {
+        n = eval_integer();
+        skip_spaces();
+        if (peek_char() == ',') get_next_char();
+        val = eval_expr(&argtype);
+        skip_spaces();
+        if (peek_char() == ')') get_next_char();
+        switch (argtype) {
+            case TYPE_STR:
+                /* The first character of a string */
+                c = fn_asc(val.strval);
+                if (val.strval) free_string(val.strval);
+                break;
+            case TYPE_INT: c = val.intval; break;
+            case TYPE_SNG: c = (int)val.sngval; break;
+            default: c = (int)val.dblval; break;
+        }
+        result.strval = fn_string(n, c);
     }
 
     return result;
@@ -456,6 +484,9 @@ int *type;
     if (is_string_function(varname)) {
         return call_string_function(varname, type);
     }
+    if (usr_index(varname) >= 0) {
+        return usr_call(usr_index(varname), type);
+    }
 
     /* Check for array subscript */
     skip_spaces();
@@ -490,22 +521,20 @@ int *type;
             return result;
         }
 
-        /* Determine type from variable name */
-        if (strchr(varname, '$')) {
-            *type = TYPE_STR;
-            /* Return a copy so caller owns it */
+        /* Elements are stored in the array's own type */
+        *type = find_array(varname, 0)->type;
+        if (*type == TYPE_STR) {
+            /* Return a reference so caller owns one (shared, see strings.c) */
             result.strval = elem->strval ? copy_string(elem->strval) : NULL;
             return result;
-        } else {
-            *type = TYPE_SNG;
-            return *elem;
         }
+        return *elem;
 
     } else {
         /* Simple variable */
         result = get_variable(varname, type);
 
-        /* For string variables, return a copy so caller owns it */
+        /* For string variables, return a reference the caller owns */
         if (*type == TYPE_STR && result.strval) {
             result.strval = copy_string(result.strval);
         }
@@ -523,8 +552,10 @@ int token;
 int *type;
 {
     value_t result;
+    value_t val;
     double arg;
     string_t *sarg;
+    int argtype;
 
     *type = TYPE_DBL;
     result.dblval = 0.0;
@@ -552,6 +583,19 @@ int *type;
         return result;
     }
 
+    /* FRE("") compacts the string heap first */
+    if (token == TOK_FRE) {
+        val = eval_expr(&argtype);
+        if (argtype == TYPE_STR) {
+            if (val.strval) free_string(val.strval);
+            string_collect();
+        }
+        skip_spaces();
+        if (peek_char() == ')') get_next_char();
+        result.dblval = fn_fre(0.0);
+        return result;
+    }
+
     /* Functions that take numeric arguments */
     arg = eval_numeric();
     skip_spaces();
@@ -569,7 +613,6 @@ int *type;
         case TOK_SGN: result.dblval = fn_sgn(arg); break;
         case TOK_INT: result.dblval = fn_int(arg); break;
         case TOK_RND: result.dblval = fn_rnd(arg); break;
-        case TOK_FRE: result.dblval = fn_fre(arg); break;
         default:
             result.dblval = 0.0;
             break;
@@ -664,6 +707,76 @@ int *type;
     return result;
 }
 
+/*
+ * Handle memory segment functions: PEEK, PEEK$, ATOMADD, ATOMCAS
+ */
+static value_t
+call_memory_function(token, type)
+int token;
+int *type;
+{
+    value_t result;
+    long addr;
+    long arg1;
+    long arg2;
+    int is_string;
+
+    /* PEEK$ tokenizes as PEEK followed by '$' */
+    is_string = 0;
+    if (token == TOK_PEEK && peek_char() == '$') {
+        get_next_char();
+        is_string = 1;
+    }
+
+    skip_spaces();
+    if (peek_char() != '(') {
+        syntax_error();
+    }
+    get_next_char(); /* Skip '(' */
+
+    addr = (long)eval_numeric();
+    arg1 = 0L;
+    arg2 = 0L;
+    if (is_string || token != TOK_PEEK) {
+        skip_spaces();
+        if (peek_char() != ',') {
+            syntax_error();
+        }
+        get_next_char();
+        arg1 = (long)eval_numeric();
+    }
+    if (token == TOK_ATOMCAS) {
+        skip_spaces();
+        if (peek_char() != ',') {
+            syntax_error();
+        }
+        get_next_char();
+        arg2 = (long)eval_numeric();
+    }
+    skip_spaces();
+    if (peek_char() == ')') get_next_char();
+
+    if (is_string) {
+        *type = TYPE_STR;
+        result.strval = mem_peek_string(addr, (int)arg1);
+        return result;
+    }
+
+    *type = TYPE_DBL;
+    switch (token) {
+        case TOK_PEEK:
+            result.dblval = (double)mem_peek(addr);
+            break;
+        case TOK_ATOMADD:
+            result.dblval = (double)mem_atomic_add(addr, arg1);
+            break;
+        default:
+            result.dblval = (double)mem_atomic_cas(addr, arg1, arg2);
+            break;
+    }
+    return result;
+}
+
 /*
  * Primary expression: number, string, variable, function, (expr)
  */
@@ -718,6 +831,19 @@ int *type;
         get_next_char(); /* Consume 0xFF */
         token = (0xFF << 8) | get_next_char();
 
+        /* TIMER takes no argument */
+        if (token == TOK_TIMER) {
+            *type = TYPE_DBL;
+            result.dblval = fn_timer();
+            return result;
+        }
+
+        /* Memory segment functions */
+        if (token == TOK_PEEK || token == TOK_ATOMADD ||
+            token == TOK_ATOMCAS) {
+            return call_memory_function(token, type);
+        }
+
         /* Check if it's a numeric function */
         if (token == TOK_SQR || token == TOK_SIN || token == TOK_COS ||
             token == TOK_TAN || token == TOK_ATN || token == TOK_LOG ||
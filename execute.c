@@ -78,6 +78,11 @@ execute_statement()
         return;
     }
 
+    /* Record it in the trace ring (see trace.c) */
+    if (g_state->profiling & PROF_TRACE) {
+        trace_statement();
+    }
+
     /* Check for token (high bit set) */
     if (c & 0x80) {
         token = get_next_char();
@@ -86,6 +91,9 @@ execute_statement()
         /* Note: use & 0xFF for K&R C where char may be signed */
         if ((token & 0xFF) == 0xFF) {
             token = (token << 8) | get_next_char();
+            STAT_INC(statements[256 + (token & 0xFF)]);
+        } else {
+            STAT_INC(statements[token & 0xFF]);
         }
 
         /* Dispatch based on token */
@@ -203,6 +211,35 @@ execute_statement()
                 do_sleep();
                 break;
 
+            case TOK_DEF:
+                do_def();
+                break;
+
+            case TOK_POKE:
+                do_poke();
+                break;
+
+            case TOK_CALL:
+                do_call();
+                break;
+
+            case TOK_PROFILE:
+                do_profile();
+                break;
+
+            case TOK_STATS:
+                do_stats();
+                break;
+
+            case TOK_MEMSTAT:
+                do_memstat();
+                break;
+
+            case TOK_ELSE:
+                /* Reached the end of a THEN branch - skip the ELSE part */
+                skip_to_eol();
+                break;
+
             default:
                 /* Unknown token */
                 printf("Unknown statement token: %02X\n", token);
@@ -212,6 +249,7 @@ execute_statement()
 
     } else if (IS_ALPHA(c)) {
         /* Might be variable assignment without LET */
+        STAT_INC(statements[0]);
         do_let();
 
     } else {
@@ -220,17 +258,15 @@ execute_statement()
 }
 
 /*
- * Run a program from specified line
+ * Prepare to run a program from specified line
+ * Returns 1 if there is something to execute, 0 otherwise
  */
-void
-run_program(startline)
+int
+start_program(startline)
 int startline;
 {
     unsigned char *p;
-    line_t *line;
     line_t *startline_ptr;
-    line_t *next_line;
-    int prev_line;
 
     /* Mark as running */
     g_state->running = 1;
@@ -243,7 +279,7 @@ int startline;
         if (p[0] == 0 && p[1] == 0) {
             /* Empty program */
             g_state->running = 0;
-            return;
+            return 0;
         }
         startline_ptr = (line_t *)p;
     } else {
@@ -251,7 +287,7 @@ int startline;
         if (!startline_ptr) {
             error(ERR_UNDEF_LINE);
             g_state->running = 0;
-            return;
+            return 0;
         }
     }
 
@@ -259,6 +295,66 @@ int startline;
     g_state->curlin = startline_ptr->linenum;
     g_state->txtptr = startline_ptr->text;
     g_state->curline_ptr = startline_ptr;  /* Track line pointer for fast advance */
+    return 1;
+}
+
+/*
+ * Execute the statements of the current line
+ * Returns 1 if control reached the end of the line, 0 after a jump
+ * (GOTO, GOSUB, etc.) or when a scheduled job has to yield
+ */
+static int
+run_statements()
+{
+    int prev_line;
+
+    while (peek_char() != '\0' && g_state->running) {
+        /* Save position before each statement */
+        prev_line = g_state->curlin;
+
+        execute_statement();
+
+        /* The statement's string temporaries are dead (see strings.c) */
+        g_state->tmpused = 0;
+
+        /* Give up the CPU if running as a scheduled job */
+        if (g_state->sched) {
+            if (--g_state->slice <= 0) {
+                g_state->yield = 1;
+            }
+            if (g_state->yield) {
+                return 0;
+            }
+        }
+
+        /* If a jump occurred, break and restart */
+        if (g_state->curlin != prev_line) {
+            return 0;
+        }
+
+        /* Check for statement separator */
+        skip_spaces();
+        if (peek_char() == ':') {
+            get_next_char();
+        } else {
+            break;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Execute from the current position until the program stops
+ * Under the scheduler this also returns when the job yields;
+ * calling it again resumes at the next statement
+ */
+void
+continue_program()
+{
+    unsigned char *p;
+    line_t *line;
+    line_t *next_line;
+    int stay;
 
     /* Set up error handler */
     if (setjmp(g_state->errtrap) != 0) {
@@ -270,8 +366,13 @@ int startline;
                 printf("%s\n", error_message(g_state->errnum));
             }
             g_state->errnum = ERR_NONE;
+            fflush(stdout);
+            trace_tail(stderr, 10);
         }
         g_state->running = 0;
+        profile_report();
+        cover_report();
+        calls_report();
         return;
     }
 
@@ -282,32 +383,32 @@ int startline;
             printf("[%d]\n", g_state->curlin);
         }
 
-        /* Save current line to detect jumps */
-        prev_line = g_state->curlin;
-
-        /* Execute statements on current line */
-        while (peek_char() != '\0' && g_state->running) {
-            /* Save position before each statement */
-            prev_line = g_state->curlin;
+        /* Count the line and charge the time since the last one */
+        if (g_state->profiling && g_state->curline_ptr) {
+            profile_line(g_state->curline_ptr);
+        }
 
-            execute_statement();
+        /* Run the line as machine code if it is hot (see jit.c) */
+        if (g_state->curline_ptr &&
+            g_state->txtptr == g_state->curline_ptr->text && jit_run()) {
+            continue;
+        }
 
-            /* If a jump occurred (GOTO, GOSUB, etc.), break and restart */
-            if (g_state->curlin != prev_line) {
-                break;
-            }
+        /* Execute statements on current line, under perf through the
+         * line's trampoline (see perf.c) */
+        if (perf_on && g_state->forstop == 0) {
+            stay = perf_line(run_statements);
+        } else {
+            stay = run_statements();
+        }
 
-            /* Check for statement separator */
-            skip_spaces();
-            if (peek_char() == ':') {
-                get_next_char();
-            } else {
-                break;
-            }
+        /* Give up the CPU if running as a scheduled job */
+        if (g_state->sched && g_state->yield) {
+            return;
         }
 
         /* Move to next line ONLY if no jump occurred */
-        if (g_state->running && g_state->curlin == prev_line) {
+        if (g_state->running && stay) {
             /* Use cached line pointer for O(1) advance instead of O(n) search */
             line = g_state->curline_ptr;
             p = ((unsigned char *)line) + line->len;
@@ -323,4 +424,21 @@ int startline;
             }
         }
     }
+
+    /* The program has ended (a yielding job returns above) */
+    profile_report();
+    cover_report();
+    calls_report();
+}
+
+/*
+ * Run a program from specified line
+ */
+void
+run_program(startline)
+int startline;
+{
+    if (start_program(startline)) {
+        continue_program();
+    }
 }
@@ -185,7 +185,7 @@ int n;
         return alloc_string(0);
     }
 
-    result = alloc_string(1);
+    result = temp_string(1);
     if (!result) {
         return NULL;
     }
@@ -197,6 +197,40 @@ int n;
     return result;
 }
 
+/*
+ * SPACE$ function - n spaces
+ */
+string_t *
+fn_space(n)
+int n;
+{
+    return fn_string(n, ' ');
+}
+
+/*
+ * STRING$ function - n copies of character c
+ */
+string_t *
+fn_string(n, c)
+int n;
+int c;
+{
+    string_t *result;
+
+    if (n < 0 || n > 255 || c < 0 || c > 255) {
+        error(ERR_ILLEGAL_FUNC);
+        return alloc_string(0);
+    }
+
+    result = temp_string(n);
+    if (!result) {
+        return NULL;
+    }
+    memset(result->ptr, c, n);
+
+    return result;
+}
+
 /*
  * STR$ function - convert number to string
  */
@@ -221,7 +255,7 @@ double x;
         buf[0] = ' ';
     }
 
-    return string_from_cstr(buf);
+    return temp_from_cstr(buf);
 }
 
 /*
@@ -267,7 +301,7 @@ int n;
         n = s->len;
     }
 
-    result = alloc_string(n);
+    result = temp_string(n);
     if (!result) {
         return NULL;
     }
@@ -301,7 +335,7 @@ int n;
 
     start = s->len - n;
 
-    result = alloc_string(n);
+    result = temp_string(n);
     if (!result) {
         return NULL;
     }
@@ -347,7 +381,7 @@ int len;
         return alloc_string(0);
     }
 
-    result = alloc_string(actual_len);
+    result = temp_string(actual_len);
     if (!result) {
         return NULL;
     }
@@ -363,7 +397,7 @@ int len;
 /*
  * FRE function - free memory
  * FRE(0) returns bytes free for program/variables
- * FRE("") returns bytes free for strings (same in this implementation)
+ * FRE("") returns the same, after compacting the string space (see eval.c)
  */
 double
 fn_fre(x)
@@ -377,6 +411,15 @@ double x;
     return (double)freemem;
 }
 
+/*
+ * TIMER function - seconds since midnight, to the microsecond
+ */
+double
+fn_timer()
+{
+    return clock_day();
+}
+
 /*
  * INSTR function - find substring
  */
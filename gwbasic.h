@@ -49,6 +49,13 @@
 #define IS_16BIT 0
 #endif
 
+/* Thread-local storage for per-thread interpreter state */
+#if defined(GW_THREADS)
+#define GW_TLS __thread
+#else
+#define GW_TLS
+#endif
+
 /* Basic constants */
 #define LINLEN 80       /* Terminal line length */
 
@@ -71,6 +78,7 @@
 #define PROGRAM_SIZE 65536L /* Program memory size */
 #define STACK_SIZE 50   /* FOR/GOSUB/WHILE stack size */
 #endif
+#define MAXREDUCE 8     /* Variables in a PARALLEL FOR REDUCE list */
 
 /* Data type indicators */
 #define TYPE_INT    2   /* Integer (%) */
@@ -138,6 +146,10 @@
 #define TOK_SYSTEM  0xBD
 #define TOK_CHAIN   0xBE
 #define TOK_COMMON  0xBF
+#define TOK_CALL    0xC0
+#define TOK_PROFILE 0xC1
+#define TOK_STATS   0xC2
+#define TOK_MEMSTAT 0xC3
 
 /* Function tokens */
 #define TOK_TAB     0xFF84
@@ -190,6 +202,17 @@
 #define TOK_MID     0xFFB4
 #define TOK_INSTR   0xFFB5
 
+/* Statement clauses */
+#define TOK_PARALLEL 0xFFB6
+#define TOK_REDUCE  0xFFB7
+
+/* Memory segment functions */
+#define TOK_ATOMADD 0xFFB8
+#define TOK_ATOMCAS 0xFFB9
+
+/* Timing */
+#define TOK_TIMER   0xFFBA
+
 /* Error codes */
 #define ERR_NONE         0
 #define ERR_NEXT_NO_FOR  1
@@ -231,11 +254,32 @@ union value_u {
 };
 
 /* String descriptor */
+#if IS_16BIT
+#define STR_INLINE 8    /* Strings shorter than this are kept in buf */
+#else
+#define STR_INLINE 24   /* buf runs up to ptr: 48 bytes on LP64 */
+#endif
+
 struct string_s {
     int len;            /* String length */
-    char *ptr;          /* Pointer to string data */
+    int flags;          /* STR_HEAP, STR_STATIC, STR_TEMP */
+    int refs;           /* Holders sharing it (see copy_string) */
+    int cap;            /* Characters ptr has room for */
+    char buf[STR_INLINE]; /* Data of a short string */
+    char *ptr;          /* Pointer to string data, buf if short */
 };
 
+#define STR_HEAP 1      /* Data in the string heap (see strings.c) */
+#define STR_STATIC 2    /* The shared empty string, never freed */
+#define STR_TEMP 4      /* Expression temporary in tmparena */
+
+/* Expression temporaries of the statement running (see strings.c) */
+#if IS_16BIT
+#define TMP_ARENA 1024
+#else
+#define TMP_ARENA 4096
+#endif
+
 /* Variable entry */
 struct var_s {
     char name[NAMLEN+1]; /* Variable name */
@@ -283,6 +327,68 @@ typedef struct {
     unsigned char *text; /* WHILE position */
 } whilestack_t;
 
+/* Hot-path counters (see stats.c) - make STATS=1 compiles them in */
+#define STAT_TOKENS 512     /* Statement slots: 1-byte tokens, then 0xFFxx */
+
+#ifdef GW_STATS
+typedef struct {
+    long find_line;           /* find_line() calls */
+    long find_line_scanned;   /* Lines it looked at */
+    long find_variable;       /* find_variable() calls */
+    long lastvar_hits;        /* Answered by the lastvar cache */
+    long alloc_string;        /* alloc_string() calls */
+    long alloc_string_bytes;  /* Bytes they allocated */
+    long free_string;         /* free_string() calls */
+    long free_string_bytes;   /* Bytes they released */
+    long string_collect;      /* String space compactions */
+    long temp_string;         /* Temporaries taken from tmparena */
+    long array_element;       /* array_element() calls */
+    long tokenize_line;       /* tokenize_line() calls */
+    long tokenize_bytes;      /* Source bytes they read */
+    long statements[STAT_TOKENS]; /* execute_statement() by token */
+} stats_t;
+
+extern stats_t gw_stats;
+
+/* PARALLEL FOR workers share the counters */
+#if defined(GW_THREADS) && defined(__GNUC__)
+#define STAT_INC(field) ((void)__sync_fetch_and_add(&gw_stats.field, 1L))
+#define STAT_ADD(field, n) \
+    ((void)__sync_fetch_and_add(&gw_stats.field, (long)(n)))
+#else
+#define STAT_INC(field) (gw_stats.field++)
+#define STAT_ADD(field, n) (gw_stats.field += (n))
+#endif
+#else
+#define STAT_INC(field)
+#define STAT_ADD(field, n)
+#endif
+
+/* Work wanted at each line or statement start (state_t profiling) */
+#define PROF_LINES 1    /* PROFILE ON or --profile (see profile.c) */
+#define PROF_DRAIN 2    /* SIGPROF sample ring needs draining (sample.c) */
+#define PROF_TRACE 4    /* Each statement goes to the trace ring (trace.c) */
+#define PROF_COVER 8    /* Lines are marked in the coverage bitmap (cover.c) */
+#define PROF_CALLS 16   /* GOSUB and RETURN are timed (calls.c) */
+
+/* Trace ring file (see trace.c and gwtrace.c): a header, then nrecs
+ * records of recsize bytes; record n is at slot n % nrecs */
+#define TRACE_MAGIC "GWTRACE"
+
+typedef struct {
+    char magic[8];          /* TRACE_MAGIC */
+    int recsize;            /* 8, or 16 with timestamps */
+    int nrecs;              /* Slots in the ring */
+    unsigned long count;    /* Records written so far */
+} trace_hdr_t;
+
+typedef struct {
+    int line;               /* Line number */
+    unsigned short token;   /* Statement token, 0 for an implied LET */
+    unsigned short pad;
+    double time;            /* Seconds since the start (recsize 16) */
+} trace_rec_t;
+
 /* Global interpreter state */
 typedef struct {
     unsigned char *txttab;  /* Start of program text */
@@ -291,6 +397,9 @@ typedef struct {
     unsigned char *strend;  /* End of arrays */
     unsigned char *fretop;  /* Top of free memory */
     unsigned char *memsiz;  /* End of memory */
+    int strheap;            /* 1 if strings may use fretop..memsiz */
+    string_t *strfree;      /* Free string descriptors */
+    struct strslab_s *strslabs; /* Blocks the descriptors came from */
 
     int curlin;             /* Current line number */
     unsigned char *txtptr;  /* Current text pointer */
@@ -302,6 +411,7 @@ typedef struct {
 
     forstack_t forstack[STACK_SIZE];  /* FOR loop stack */
     int forsp;                         /* FOR stack pointer */
+    int forstop;                       /* Stop when a NEXT pops below this */
 
     gosubstack_t gosubstack[STACK_SIZE]; /* GOSUB stack */
     int gosubsp;                          /* GOSUB stack pointer */
@@ -317,18 +427,45 @@ typedef struct {
 
     int running;           /* 1 if program running */
     int tracing;           /* 1 if TRON active */
+    int profiling;         /* PROF_LINES, PROF_DRAIN bits, 0 if neither */
+    struct prof_s *prof;   /* Per-line totals (see profile.c) */
+    struct region_s *regions; /* PROFILE START regions (see profile.c) */
+    struct cover_s *cover; /* Lines reached (see cover.c) */
+    struct calls_s *calls; /* Subroutine calls in progress (see calls.c) */
+
+    /* Cooperative scheduler state (see sched.c) */
+    int sched;             /* 1 if run as a job under the scheduler */
+    int yield;             /* 1 if the job should give up the CPU */
+    int slice;             /* Statements left in current time slice */
+    double wakeup;         /* SLEEP wake time (monotonic seconds) */
+    int waitfd;            /* Descriptor INPUT is waiting on, or -1 */
+    unsigned char *inwait; /* INPUT whose prompt is already shown */
 
     jmp_buf errtrap;       /* Error recovery */
 
     char inputbuf[BUFLEN+1]; /* Input buffer */
 
+    /* PEEK/POKE segment (see shmem.c) */
+    unsigned char *segbase; /* Current segment, NULL until first use */
+    int segshared;          /* 1 if segbase is a shared memory mapping */
+
+    /* DEF USR native functions (see native.c) */
+    struct usr_s *usrtab;   /* USR0-USR9, NULL until the first DEF USR */
+
+    /* Compiled hot lines (see jit.c) */
+    struct jit_s *jit;      /* NULL until the first line start */
+
     /* Random number state */
     unsigned long rndseed;
 
+    /* String temporaries, dropped after every statement */
+    int tmpused;            /* Bytes of tmparena in use */
+    long tmparena[TMP_ARENA / sizeof(long)];
+
 } state_t;
 
 /* Global state pointer */
-extern state_t *g_state;
+extern GW_TLS state_t *g_state;
 
 /* Function prototypes */
 
@@ -347,10 +484,11 @@ int save_file(const char *filename);
 unsigned char *tokenize_line(const char *line, int *len);
 char *detokenize_line(unsigned char *tokens);
 int is_keyword(const char *word);
+const char *token_name(int token);
 
 /* parse.c */
 void parse_line(int linenum, const char *text);
-void insert_line(int linenum, unsigned char *tokens, int len);
+int insert_line(int linenum, unsigned char *tokens, int len);
 void delete_line(int linenum);
 line_t *find_line(int linenum);
 void list_program(int start, int end);
@@ -358,6 +496,8 @@ void new_program();
 
 /* execute.c */
 void run_program(int startline);
+int start_program(int startline);
+void continue_program();
 void execute_statement();
 int get_linenum();
 void skip_to_eol();
@@ -388,10 +528,17 @@ void clear_arrays();
 /* strings.c */
 string_t *alloc_string(int len);
 void free_string(string_t *str);
+void string_collect();
+int string_room(long n);
+void string_release();
+void string_give(state_t *st);
 string_t *concat_strings(string_t *s1, string_t *s2);
 string_t *copy_string(string_t *src);
+string_t *append_string(string_t *dest, string_t *src);
 int compare_strings(string_t *s1, string_t *s2);
 string_t *string_from_cstr(const char *cstr);
+string_t *temp_string(int len);
+string_t *temp_from_cstr(const char *cstr);
 char *string_to_cstr(string_t *str);
 
 /* statements.c */
@@ -420,6 +567,12 @@ void do_load();
 void do_save();
 void do_system();
 void do_sleep();
+void do_def();
+void do_poke();
+void do_call();
+void do_profile();
+void do_stats();
+void do_memstat();
 
 /* functions.c */
 double fn_sgn(double x);
@@ -434,10 +587,13 @@ double fn_atn(double x);
 double fn_log(double x);
 double fn_exp(double x);
 double fn_fre(double x);
+double fn_timer();
 
 int fn_len(string_t *s);
 int fn_asc(string_t *s);
 string_t *fn_chr(int n);
+string_t *fn_space(int n);
+string_t *fn_string(int n, int c);
 string_t *fn_str(double x);
 double fn_val(string_t *s);
 string_t *fn_left(string_t *s, int n);
@@ -445,9 +601,139 @@ string_t *fn_right(string_t *s, int n);
 string_t *fn_mid(string_t *s, int start, int len);
 int fn_instr(int start, string_t *s1, string_t *s2);
 
+/* sched.c */
+int sched_run(char **files, int nfiles);
+int sched_readable(int fd);
+
+/* shmem.c */
+void mem_select(const char *name);
+void mem_release();
+int mem_peek(long addr);
+void mem_poke(long addr, int value);
+string_t *mem_peek_string(long addr, int count);
+void mem_poke_string(long addr, string_t *str);
+long mem_atomic_add(long addr, long delta);
+long mem_atomic_cas(long addr, long oldval, long newval);
+
+/* native.c */
+int usr_index(const char *name);
+int usr_define(int n, const char *lib, const char *sym, const char *sig);
+value_t usr_call(int n, int *type);
+void usr_release();
+
+/* emitc.c */
+int emit_c(const char *filename, const char *outname);
+int compile_program(const char *filename, const char *outname);
+
+/* runtime.c - linked into translated programs only */
+#define RT_ROWS 16      /* Array references in one statement */
+extern int rt_ix[RT_ROWS][8];
+void basic_program();
+string_t *rt_tmp(string_t *str);
+string_t *rt_lit(const char *s);
+void rt_release();
+void rt_let(string_t **dest, string_t *src);
+double rt_div(double a, double b);
+int rt_idiv(int a, int b);
+int rt_mod(int a, int b);
+void rt_print_begin();
+void rt_print_int(int n);
+void rt_print_num(double x, int width);
+void rt_print_str(string_t *s);
+void rt_print_comma();
+void rt_print_tab(int n);
+void rt_gosub(int resume);
+int rt_return();
+void rt_for(void *var, int type, double limit, double step, int resume);
+int rt_next(void *var, int type);
+int rt_input(const char *prompt);
+int rt_input_more();
+double rt_input_num();
+string_t *rt_input_str();
+
+/* profile.c */
+extern int profile_all;
+void profile_line(line_t *line);
+void profile_start();
+void profile_stop();
+int profile_region(const char *name, int start);
+void profile_report();
+
+/* sample.c */
+extern int sample_on;
+int sample_start(const char *name);
+void sample_drain();
+
+/* cover.c */
+extern int cover_on;
+void cover_start(const char *name);
+struct cover_s *cover_get();
+unsigned char *cover_bit(int linenum, int *bit);
+void cover_line(int linenum);
+void cover_source(const char *name);
+void cover_report();
+void cover_release();
+
+/* calls.c */
+extern int calls_on;
+int calls_start(const char *name);
+void calls_enter(int line);
+void calls_leave();
+void calls_report();
+void calls_release();
+
+/* perf.c */
+extern int perf_on;
+int perf_start();
+void perf_code(unsigned char *addr, unsigned long size, const char *name);
+int perf_line(int (*fn)());
+
+/* trace.c */
+extern int trace_on;
+int trace_start(const char *name, int timed);
+void trace_statement();
+void trace_tail(FILE *fp, int n);
+
+/* memstat.c */
+extern int memstat_on;
+void memstat_report(FILE *fp);
+
+/* stats.c */
+void stats_dump(FILE *fp);
+void stats_start(const char *name);
+
+/* jit.c */
+int jit_run();
+void jit_release();
+
+/* parallel.c */
+int parallel_for(const char *varname, double start, double limit,
+                 double step, char reduce[][NAMLEN+1], int nreduce);
+
+/* clock.c */
+double clock_mono();
+double clock_day();
+unsigned long clock_cycles();
+
 /* error.c */
 void error(int errnum);
 void syntax_error();
 const char *error_message(int errnum);
 
+/* Allocation profiler (see alloc.c) - make ALLOCPROF=1 compiles it in */
+#ifdef GW_ALLOCPROF
+void *alloc_malloc(unsigned long size, const char *file, int line);
+void *alloc_calloc(unsigned long n, unsigned long size, const char *file,
+                   int line);
+void *alloc_realloc(void *p, unsigned long size, const char *file, int line);
+void alloc_free(void *p);
+
+#define malloc(n) alloc_malloc((unsigned long)(n), __FILE__, __LINE__)
+#define calloc(n, m) alloc_calloc((unsigned long)(n), (unsigned long)(m), \
+                                  __FILE__, __LINE__)
+#define realloc(p, n) alloc_realloc((p), (unsigned long)(n), __FILE__, \
+                                    __LINE__)
+#define free(p) alloc_free(p)
+#endif
+
 #endif /* GWBASIC_H */
@@ -0,0 +1,96 @@
+/*
+ * gwtrace.c - Decode a trace ring file written by gwbasic --trace
+ *
+ * Lists the records still in the ring, oldest first, one statement per
+ * line: its sequence number, line number, keyword and, if the trace
+ * was made with --trace-time, the time in seconds since the start.
+ *
+ *   gwtrace [-n count] FILE
+ *
+ * -n lists only the last count statements.  The file may be read while
+ * the program is still running.  Links only tokenize.o, for the
+ * keyword names.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#ifdef GW_STATS
+/* Counters of tokenize.c, never shown */
+stats_t gw_stats;
+#endif
+
+#ifdef GW_ALLOCPROF
+/* Read by alloc.c, never set */
+GW_TLS state_t *g_state;
+#endif
+
+int
+main(argc, argv)
+int argc;
+char **argv;
+{
+    trace_hdr_t hdr;
+    trace_rec_t r;
+    const char *name;
+    unsigned long first;
+    unsigned long i;
+    long tail;
+    FILE *fp;
+
+    tail = -1L;
+    if (argc == 4 && strcmp(argv[1], "-n") == 0) {
+        tail = atol(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s [-n count] FILE\n", argv[0]);
+        return 2;
+    }
+
+    fp = fopen(argv[1], "rb");
+    if (!fp) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    if (fread((char *)&hdr, sizeof(hdr), 1, fp) != 1 ||
+        memcmp(hdr.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        hdr.nrecs <= 0 || hdr.recsize < 8 ||
+        hdr.recsize > (int)sizeof(trace_rec_t)) {
+        fprintf(stderr, "%s is not a trace file\n", argv[1]);
+        fclose(fp);
+        return 1;
+    }
+
+    /* The oldest record still in the ring */
+    first = hdr.count > (unsigned long)hdr.nrecs ?
+            hdr.count - hdr.nrecs : 0UL;
+    if (tail >= 0 && hdr.count - first > (unsigned long)tail) {
+        first = hdr.count - tail;
+    }
+    printf("# %lu statements traced, %lu listed\n", hdr.count,
+           hdr.count - first);
+
+    for (i = first; i < hdr.count; i++) {
+        if (fseek(fp, (long)sizeof(hdr) +
+                  (long)(i % (unsigned long)hdr.nrecs) * hdr.recsize,
+                  SEEK_SET) != 0) {
+            break;
+        }
+        memset((char *)&r, 0, sizeof(r));
+        if (fread((char *)&r, (size_t)hdr.recsize, 1, fp) != 1) {
+            break;
+        }
+        name = r.token ? token_name(r.token) : "LET";
+        printf("%10lu %7d  %-10s", i, r.line, name ? name : "?");
+        if (hdr.recsize == (int)sizeof(trace_rec_t)) {
+            printf(" %12.6f", r.time);
+        }
+        printf("\n");
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,2225 @@
+/*
+ * jit.c - Template JIT for hot numeric loops (x86-64)
+ *
+ * The interpreter counts every line start it reaches.  Once a line has
+ * started JIT_HOT times, the longest run of consecutive lines around it
+ * that stay within the numeric subset is compiled to x86-64 machine
+ * code in mmap'd pages:
+ *
+ *   - assignments to numeric variables and array elements
+ *   - + - * / \ MOD ^, comparisons, AND OR XOR NOT and the numeric
+ *     built-in functions
+ *   - IF ... THEN ... ELSE, GOTO, FOR/NEXT and REM
+ *
+ * Each line of a region is an entry point.  Control stays in machine
+ * code while the program jumps between lines of the region and returns
+ * to the interpreter when it leaves.  A line using anything else
+ * (PRINT, strings, GOSUB, ...) is never compiled; it ends the region and
+ * keeps running interpreted.  FOR and NEXT use the interpreter's own FOR
+ * stack, so a loop can be started in one mode and finished in the other.
+ *
+ * Every statement is a fixed template.  Expression values live in eax
+ * (integers) or xmm0 (single and double precision, held as doubles),
+ * with the right operand in ecx or xmm1 and intermediate results on the
+ * machine stack.  Typing follows eval.c exactly, and stores convert
+ * through double like set_variable().  Errors (division by zero, bad
+ * subscripts, ...) call error() with curlin kept up to date.
+ *
+ * Compiled code holds the addresses of variables and array data, so
+ * it is discarded whenever variables or arrays are cleared (RUN, NEW,
+ * CLEAR, editing the program).  It never runs under the scheduler, in
+ * PARALLEL FOR workers, with TRON on or while profiling or sampling.
+ *
+ * Build with make JIT=0 to leave it out; GWBASIC_JIT=0 disables it at
+ * run time and GWBASIC_JIT=n compiles lines after n starts instead.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(GW_JIT) && defined(__x86_64__)
+
+#include <sys/mman.h>
+
+/* K&R C compatible character tests - ctype macros may fail on old systems */
+#define IS_ALPHA(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_ALNUM(c) (IS_ALPHA(c) || IS_DIGIT(c))
+
+#define JIT_HOT 50      /* Line starts before a line is compiled */
+#define MAXNODES 256    /* Expression nodes per statement */
+#define MAXFIX 1024     /* Forward jumps to lines per region */
+#define MAXREGION 1000  /* Lines per region */
+
+/* Line states */
+#define LINE_COUNTING 0
+#define LINE_COMPILED 1
+#define LINE_FAILED   2
+
+/* Hash table entry for a program line */
+typedef struct {
+    line_t *line;           /* Line, NULL if the slot is free */
+    int count;              /* Times the interpreter started it */
+    int state;              /* LINE_COUNTING, LINE_COMPILED, LINE_FAILED */
+    unsigned char *code;    /* Region holding the line */
+    unsigned char *entry;   /* Start of the line's code */
+} jit_line_t;
+
+/* Compiled region */
+typedef struct region_s {
+    unsigned char *code;    /* Executable mapping */
+    size_t size;            /* Its length */
+    struct region_s *next;
+} region_t;
+
+struct jit_s {
+    int enabled;            /* 0 if GWBASIC_JIT=0 */
+    int hot;                /* Line starts before compiling */
+    jit_line_t *lines;      /* Open addressing hash table */
+    int nlines;             /* Slots in use */
+    int cap;                /* Slots (a power of two) */
+    region_t *regions;      /* Compiled code */
+};
+
+/* Expression node kinds */
+#define N_CONST 1
+#define N_VAR   2
+#define N_ELEM  3
+#define N_FUNC  4
+#define N_NEG   5
+#define N_NOT   6
+#define N_BINOP 7
+
+/* Expression tree */
+typedef struct node_s {
+    int kind;               /* N_CONST ... N_BINOP */
+    int op;                 /* Operator of N_BINOP */
+    int type;               /* Result type, as eval.c gives it */
+    int ival;               /* Integer constant */
+    double dval;            /* Floating point constant */
+    var_t *var;             /* Variable of N_VAR */
+    array_t *arr;           /* Array of N_ELEM */
+    double (*fn)();         /* Function of N_FUNC */
+    int nkids;
+    struct node_s *kid[8];  /* Operands or subscripts */
+} node_t;
+
+/* Numeric built-in functions */
+typedef struct {
+    int token;
+    const char *name;
+    double (*fn)();
+} jit_func_t;
+
+static jit_func_t functions[] = {
+    {TOK_SQR, "SQR", fn_sqr},
+    {TOK_SIN, "SIN", fn_sin},
+    {TOK_COS, "COS", fn_cos},
+    {TOK_TAN, "TAN", fn_tan},
+    {TOK_ATN, "ATN", fn_atn},
+    {TOK_LOG, "LOG", fn_log},
+    {TOK_EXP, "EXP", fn_exp},
+    {TOK_ABS, "ABS", fn_abs},
+    {TOK_SGN, "SGN", fn_sgn},
+    {TOK_INT, "INT", fn_int},
+    {TOK_RND, "RND", fn_rnd},
+    {TOK_FRE, NULL, fn_fre},
+    {0, NULL, NULL}
+};
+
+/* Forward jump to a line of the region */
+typedef struct {
+    int at;                 /* Offset of the rel32 to patch */
+    line_t *line;           /* Target line */
+} fixup_t;
+
+/* FOR whose NEXT may jump straight back */
+typedef struct {
+    unsigned char *text;    /* Text after the FOR clause */
+    int offset;             /* Code for the rest of the line */
+} jit_for_t;
+
+/* Compiler state */
+static unsigned char *buf;      /* Code being generated */
+static int len;                 /* Bytes generated */
+static int bufsize;             /* Bytes allocated */
+static int fail;                /* Statement can't be compiled */
+static int depth;               /* 8-byte words pushed on the stack */
+static node_t nodes[MAXNODES];
+static int nnodes;
+static fixup_t fixups[MAXFIX];
+static int nfixups;
+static jit_for_t forloops[STACK_SIZE];
+static int nforloops;
+static line_t *first;           /* Region being compiled, NULL if none */
+static line_t *last;
+
+/* Fixed code at the start of every region */
+#define OFF_EPILOGUE 6          /* Return to the interpreter */
+#define OFF_SUBSCRIPT 11        /* Raise "Subscript out of range" */
+
+/* Forward declarations */
+static node_t *p_or();
+static node_t *p_unary();
+static void gen();
+static int compile_statements();
+
+/*
+ * Runtime helpers called from compiled code
+ */
+
+/*
+ * Leave compiled code at the start of a line (NULL: end of program)
+ */
+static void
+jit_exit(line)
+line_t *line;
+{
+    if (!line) {
+        g_state->running = 0;
+        return;
+    }
+    g_state->curlin = line->linenum;
+    g_state->txtptr = line->text;
+    g_state->curline_ptr = line;
+}
+
+/*
+ * Push a FOR loop, as do_for() does
+ */
+static void
+jit_for(limit, step, var, linenum, text)
+double limit;
+double step;
+var_t *var;
+int linenum;
+unsigned char *text;
+{
+    forstack_t *fs;
+
+    if (g_state->forsp >= STACK_SIZE) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    fs = &g_state->forstack[g_state->forsp++];
+    fs->linenum = linenum;
+    fs->text = text;
+    strcpy(fs->varname, var->name);
+    fs->limit = limit;
+    fs->step = step;
+}
+
+/*
+ * Step a FOR loop, as do_next() does
+ * Returns 0 when the loop is finished, 1 to jump back to the FOR whose
+ * clause ends at text, or 2 if the loop continues elsewhere (the
+ * interpreter's position has been set)
+ */
+static int
+jit_next(var, text)
+var_t *var;
+unsigned char *text;
+{
+    forstack_t *fs;
+    double current;
+    line_t *line;
+
+    if (g_state->forsp == 0) {
+        error(ERR_NEXT_NO_FOR);
+        return 0;
+    }
+    fs = &g_state->forstack[g_state->forsp - 1];
+    if (!var) {
+        var = find_variable(fs->varname, 1);
+    }
+
+    switch (var->type) {
+        case TYPE_INT: current = (double)var->value.intval; break;
+        case TYPE_DBL: current = var->value.dblval; break;
+        default: current = (double)var->value.sngval; break;
+    }
+    current += fs->step;
+
+    if (fs->step >= 0 ? current > fs->limit : current < fs->limit) {
+        g_state->forsp--;
+        return 0;
+    }
+
+    switch (var->type) {
+        case TYPE_INT: var->value.intval = (int)current; break;
+        case TYPE_DBL: var->value.dblval = current; break;
+        default: var->value.sngval = (float)current; break;
+    }
+
+    if (fs->text == text) {
+        return 1;
+    }
+    g_state->curlin = fs->linenum;
+    g_state->txtptr = fs->text;
+    line = find_line(g_state->curlin);
+    if (line) {
+        g_state->curline_ptr = line;
+    }
+    return 2;
+}
+
+/*
+ * Division operators, with the interpreter's checks
+ */
+static double
+jit_div(a, b)
+double a;
+double b;
+{
+    if (b == 0.0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a / b;
+}
+
+static int
+jit_idiv(a, b)
+int a;
+int b;
+{
+    if (b == 0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a / b;
+}
+
+static int
+jit_mod(a, b)
+int a;
+int b;
+{
+    if (b == 0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a % b;
+}
+
+/*
+ * Code buffer
+ */
+
+/*
+ * Append a byte
+ */
+static void
+emit(c)
+int c;
+{
+    unsigned char *p;
+
+    if (len == bufsize) {
+        p = (unsigned char *)realloc(buf, bufsize ? bufsize * 2 : 4096);
+        if (!p) {
+            fail = 1;
+            len = 0;
+            return;
+        }
+        buf = p;
+        bufsize = bufsize ? bufsize * 2 : 4096;
+    }
+    buf[len++] = (unsigned char)c;
+}
+
+static void
+emit2(a, b)
+int a;
+int b;
+{
+    emit(a);
+    emit(b);
+}
+
+static void
+emit3(a, b, c)
+int a;
+int b;
+int c;
+{
+    emit(a);
+    emit(b);
+    emit(c);
+}
+
+static void
+emit4(a, b, c, d)
+int a;
+int b;
+int c;
+int d;
+{
+    emit(a);
+    emit(b);
+    emit(c);
+    emit(d);
+}
+
+static void
+emit5(a, b, c, d, e)
+int a;
+int b;
+int c;
+int d;
+int e;
+{
+    emit4(a, b, c, d);
+    emit(e);
+}
+
+/*
+ * Little-endian immediates
+ */
+static void
+imm32(v)
+long v;
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        emit((int)((v >> (8 * i)) & 0xFF));
+    }
+}
+
+static void
+imm64(v)
+unsigned long v;
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        emit((int)((v >> (8 * i)) & 0xFF));
+    }
+}
+
+/*
+ * mov reg, imm64 (reg 0 rax, 1 rcx, 2 rdx, 6 rsi, 7 rdi)
+ */
+static void
+mov_imm64(reg, v)
+int reg;
+unsigned long v;
+{
+    emit2(0x48, 0xB8 + reg);
+    imm64(v);
+}
+
+/*
+ * Patch a rel32 at offset at to reach target
+ */
+static void
+patch(at, target)
+int at;
+int target;
+{
+    long rel;
+    int i;
+
+    if (fail) {
+        return;
+    }
+    rel = (long)(target - (at + 4));
+    for (i = 0; i < 4; i++) {
+        buf[at + i] = (unsigned char)((rel >> (8 * i)) & 0xFF);
+    }
+}
+
+/*
+ * jmp rel32 to a known offset
+ */
+static void
+jmp_to(target)
+int target;
+{
+    emit(0xE9);
+    imm32((long)(target - (len + 4)));
+}
+
+/*
+ * jcc rel32 to a known offset (cc: 4 e, 5 ne, 3 ae, ...)
+ */
+static void
+jcc_to(cc, target)
+int cc;
+int target;
+{
+    emit2(0x0F, 0x80 + cc);
+    imm32((long)(target - (len + 4)));
+}
+
+/*
+ * jcc rel32 to be patched later, returns the offset to patch
+ */
+static int
+jcc_forward(cc)
+int cc;
+{
+    emit2(0x0F, 0x80 + cc);
+    imm32(0L);
+    return len - 4;
+}
+
+static int
+jmp_forward()
+{
+    emit(0xE9);
+    imm32(0L);
+    return len - 4;
+}
+
+/*
+ * Call a C function, keeping the stack 16-byte aligned
+ */
+static void
+call_helper(fn)
+unsigned long fn;
+{
+    if (depth & 1) {
+        emit4(0x48, 0x83, 0xEC, 0x08);      /* sub rsp, 8 */
+    }
+    mov_imm64(0, fn);                       /* mov rax, fn */
+    emit2(0xFF, 0xD0);                      /* call rax */
+    if (depth & 1) {
+        emit4(0x48, 0x83, 0xC4, 0x08);      /* add rsp, 8 */
+    }
+}
+
+/*
+ * Next line in the program, NULL at the end
+ */
+static line_t *
+next_line(line)
+line_t *line;
+{
+    unsigned char *p;
+
+    p = ((unsigned char *)line) + line->len;
+    if (p[0] == 0 && p[1] == 0) {
+        return NULL;
+    }
+    return (line_t *)p;
+}
+
+/*
+ * Leave the region for the start of a line (NULL: end of program)
+ */
+static void
+exit_to(line)
+line_t *line;
+{
+    mov_imm64(7, (unsigned long)line);      /* mov rdi, line */
+    call_helper((unsigned long)jit_exit);
+    jmp_to(OFF_EPILOGUE);
+}
+
+/*
+ * Continue at the start of a line: a jump within the region, or an exit
+ */
+static void
+goto_line(line)
+line_t *line;
+{
+    if (line && first && line >= first && line <= last) {
+        if (nfixups >= MAXFIX) {
+            fail = 1;
+            return;
+        }
+        fixups[nfixups].at = jmp_forward();
+        fixups[nfixups].line = line;
+        nfixups++;
+    } else {
+        exit_to(line);
+    }
+}
+
+/*
+ * Expression parser - mirrors eval.c, building a tree
+ */
+
+/*
+ * New expression node
+ */
+static node_t *
+new_node(kind, type)
+int kind;
+int type;
+{
+    node_t *n;
+
+    if (nnodes >= MAXNODES) {
+        fail = 1;
+        return NULL;
+    }
+    n = &nodes[nnodes++];
+    n->kind = kind;
+    n->type = type;
+    n->op = 0;
+    n->nkids = 0;
+    return n;
+}
+
+/*
+ * Binary operator node with eval.c's result type
+ */
+static node_t *
+binop(op, left, right)
+int op;
+node_t *left;
+node_t *right;
+{
+    node_t *n;
+    int type;
+
+    if (!left || !right) {
+        return NULL;
+    }
+    switch (op) {
+        case '+':
+        case '-':
+        case '*':
+            type = (left->type == TYPE_INT && right->type == TYPE_INT) ?
+                   TYPE_INT : TYPE_DBL;
+            break;
+        case '/':
+        case '^':
+            type = TYPE_DBL;
+            break;
+        case '\\':
+        case '%':
+        case '&':
+        case '|':
+        case 'x':
+            /* The interpreter reads doubles here as singles - not copied */
+            if (left->type == TYPE_DBL || right->type == TYPE_DBL) {
+                fail = 1;
+                return NULL;
+            }
+            type = TYPE_INT;
+            break;
+        default:
+            type = TYPE_INT;        /* Comparisons */
+            break;
+    }
+    n = new_node(N_BINOP, type);
+    if (!n) {
+        return NULL;
+    }
+    n->op = op;
+    n->nkids = 2;
+    n->kid[0] = left;
+    n->kid[1] = right;
+    return n;
+}
+
+/*
+ * Number literal - same rules as parse_number()
+ */
+static node_t *
+p_number()
+{
+    char numbuf[80];
+    char *p;
+    int c;
+    int has_dot;
+    int has_exp;
+    int type;
+    node_t *n;
+
+    p = numbuf;
+    has_dot = 0;
+    has_exp = 0;
+    type = TYPE_INT;
+
+    while (1) {
+        c = peek_char();
+        if (IS_DIGIT(c)) {
+            *p++ = get_next_char();
+        } else if (c == '.' && !has_dot && !has_exp) {
+            *p++ = get_next_char();
+            has_dot = 1;
+            type = TYPE_SNG;
+        } else if ((c == 'E' || c == 'e' || c == 'D' || c == 'd') && !has_exp) {
+            *p++ = 'E';
+            get_next_char();
+            has_exp = 1;
+            type = (c == 'D' || c == 'd') ? TYPE_DBL : TYPE_SNG;
+            c = peek_char();
+            if (c == '+' || c == '-') {
+                *p++ = get_next_char();
+            }
+        } else {
+            break;
+        }
+        if (p - numbuf >= 79) {
+            break;
+        }
+    }
+    *p = '\0';
+
+    c = peek_char();
+    if (c == '%') {
+        get_next_char();
+        type = TYPE_INT;
+    } else if (c == '!') {
+        get_next_char();
+        type = TYPE_SNG;
+    } else if (c == '#') {
+        get_next_char();
+        type = TYPE_DBL;
+    }
+
+    n = new_node(N_CONST, type);
+    if (!n) {
+        return NULL;
+    }
+    switch (type) {
+        case TYPE_INT:
+            n->ival = atoi(numbuf);
+            break;
+        case TYPE_SNG:
+            n->dval = (double)(float)atof(numbuf);
+            break;
+        default:
+            n->dval = atof(numbuf);
+            break;
+    }
+    return n;
+}
+
+/*
+ * Function call; the name or token has been read
+ */
+static node_t *
+p_function(f)
+jit_func_t *f;
+{
+    node_t *n;
+    node_t *arg;
+
+    skip_spaces();
+    if (peek_char() != '(') {
+        fail = 1;
+        return NULL;
+    }
+    get_next_char();
+    arg = p_or();
+    if (!arg) {
+        return NULL;
+    }
+    skip_spaces();
+    if (peek_char() == ')') {
+        get_next_char();
+    }
+
+    n = new_node(N_FUNC, TYPE_DBL);
+    if (!n) {
+        return NULL;
+    }
+    n->fn = f->fn;
+    n->nkids = 1;
+    n->kid[0] = arg;
+    return n;
+}
+
+/*
+ * Subscripts of an array reference, after the '('
+ */
+static node_t *
+p_subscripts(name)
+const char *name;
+{
+    node_t *n;
+    array_t *arr;
+
+    /* Only arrays that already exist - no auto-DIM or type changes */
+    arr = find_array(name, 0);
+    if (!arr || arr->ndims == 0 || arr->type == TYPE_STR ||
+        sizeof(value_t) != 8) {
+        fail = 1;
+        return NULL;
+    }
+
+    n = new_node(N_ELEM, arr->type);
+    if (!n) {
+        return NULL;
+    }
+    n->arr = arr;
+    while (n->nkids < 8) {
+        n->kid[n->nkids] = p_or();
+        if (!n->kid[n->nkids]) {
+            return NULL;
+        }
+        n->nkids++;
+        skip_spaces();
+        if (peek_char() == ',') {
+            get_next_char();
+        } else {
+            break;
+        }
+    }
+    skip_spaces();
+    if (peek_char() != ')' || n->nkids != arr->ndims) {
+        fail = 1;
+        return NULL;
+    }
+    get_next_char();
+    return n;
+}
+
+/*
+ * Variable, array element or named function
+ */
+static node_t *
+p_variable()
+{
+    char varname[NAMLEN+1];
+    char *p;
+    int c;
+    int i;
+    node_t *n;
+    var_t *var;
+
+    p = varname;
+    while (1) {
+        c = peek_char();
+        if (IS_ALNUM(c) || c == '.') {
+            c = get_next_char();
+            if (p - varname < NAMLEN) {
+                *p++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+            }
+        } else if (c == '$' || c == '%' || c == '!' || c == '#') {
+            if (p - varname < NAMLEN) {
+                *p++ = get_next_char();
+            } else {
+                get_next_char();
+            }
+            break;
+        } else {
+            break;
+        }
+    }
+    *p = '\0';
+
+    for (i = 0; functions[i].fn != NULL; i++) {
+        if (functions[i].name && strcmp(varname, functions[i].name) == 0) {
+            return p_function(&functions[i]);
+        }
+    }
+    if (strchr(varname, '$') || usr_index(varname) >= 0 ||
+        strcmp(varname, "LEN") == 0 || strcmp(varname, "ASC") == 0 ||
+        strcmp(varname, "VAL") == 0) {
+        fail = 1;
+        return NULL;
+    }
+
+    skip_spaces();
+    if (peek_char() == '(') {
+        get_next_char();
+        return p_subscripts(varname);
+    }
+
+    var = find_variable(varname, 1);
+    n = new_node(N_VAR, var->type);
+    if (n) {
+        n->var = var;
+    }
+    return n;
+}
+
+/*
+ * Primary expression: number, variable, function, (expr)
+ */
+static node_t *
+p_primary()
+{
+    node_t *n;
+    int c;
+    int token;
+    int i;
+
+    skip_spaces();
+    c = peek_char();
+
+    if (IS_DIGIT(c) || (c == '.' && IS_DIGIT(g_state->txtptr[1] & 0xFF))) {
+        return p_number();
+    }
+
+    if (c == '(') {
+        get_next_char();
+        n = p_or();
+        skip_spaces();
+        if (peek_char() != ')') {
+            fail = 1;
+            return NULL;
+        }
+        get_next_char();
+        return n;
+    }
+
+    if (IS_ALPHA(c)) {
+        return p_variable();
+    }
+
+    if ((c & 0xFF) == 0xFF) {
+        get_next_char();
+        token = (0xFF << 8) | get_next_char();
+        for (i = 0; functions[i].fn != NULL; i++) {
+            if (functions[i].token == token) {
+                return p_function(&functions[i]);
+            }
+        }
+        fail = 1;
+        return NULL;
+    }
+
+    if (c == '"' || c == '\0') {
+        fail = 1;
+        return NULL;
+    }
+
+    /* Anything else evaluates to zero, as in expr_primary() */
+    n = new_node(N_CONST, TYPE_SNG);
+    if (n) {
+        n->dval = 0.0;
+    }
+    return n;
+}
+
+/*
+ * Unary operators: +, -, NOT
+ */
+static node_t *
+p_unary()
+{
+    node_t *n;
+    node_t *kid;
+
+    skip_spaces();
+
+    if (match_token(TOK_PLUS) || peek_char() == '+') {
+        if (peek_char() == '+') {
+            get_next_char();
+        }
+        return p_unary();
+    }
+
+    if (match_token(TOK_MINUS) || peek_char() == '-') {
+        if (peek_char() == '-') {
+            get_next_char();
+        }
+        kid = p_unary();
+        if (!kid) {
+            return NULL;
+        }
+        n = new_node(N_NEG, kid->type);
+    } else if (match_token(TOK_NOT)) {
+        kid = p_unary();
+        if (!kid) {
+            return NULL;
+        }
+        if (kid->type == TYPE_DBL) {
+            fail = 1;
+            return NULL;
+        }
+        n = new_node(N_NOT, TYPE_INT);
+    } else {
+        return p_primary();
+    }
+
+    if (n) {
+        n->nkids = 1;
+        n->kid[0] = kid;
+    }
+    return n;
+}
+
+/*
+ * Power operator: ^
+ */
+static node_t *
+p_power()
+{
+    node_t *left;
+
+    left = p_unary();
+    while (left && (match_token(TOK_POWER) || peek_char() == '^')) {
+        if (peek_char() == '^') {
+            get_next_char();
+        }
+        left = binop('^', left, p_unary());
+    }
+    return left;
+}
+
+/*
+ * Multiplicative operators: *, /, \, MOD
+ */
+static node_t *
+p_mult()
+{
+    node_t *left;
+    int op;
+
+    left = p_power();
+    while (left) {
+        skip_spaces();
+        if (match_token(TOK_MULT) || peek_char() == '*') {
+            op = '*';
+        } else if (match_token(TOK_DIV) || peek_char() == '/') {
+            op = '/';
+        } else if (match_token(TOK_IDIV) || peek_char() == '\\') {
+            op = '\\';
+        } else if (match_token(TOK_MOD)) {
+            op = '%';
+        } else {
+            break;
+        }
+        if (peek_char() == op) {
+            get_next_char();
+        }
+        left = binop(op, left, p_power());
+    }
+    return left;
+}
+
+/*
+ * Additive operators: +, -
+ */
+static node_t *
+p_add()
+{
+    node_t *left;
+    int op;
+
+    left = p_mult();
+    while (left) {
+        skip_spaces();
+        if (match_token(TOK_PLUS) || peek_char() == '+') {
+            op = '+';
+        } else if (match_token(TOK_MINUS) || peek_char() == '-') {
+            op = '-';
+        } else {
+            break;
+        }
+        if (peek_char() == op) {
+            get_next_char();
+        }
+        left = binop(op, left, p_mult());
+    }
+    return left;
+}
+
+/*
+ * Comparison operators (one per expression, as in expr_compare())
+ * Encoded as = e, <> n, < <, > >, <= l, >= g
+ */
+static node_t *
+p_compare()
+{
+    node_t *left;
+    int op;
+
+    left = p_add();
+    if (!left) {
+        return NULL;
+    }
+
+    skip_spaces();
+    if (match_token(TOK_EQ) || peek_char() == '=') {
+        op = 'e';
+        if (peek_char() == '=') {
+            get_next_char();
+        }
+    } else if (match_token(TOK_NE)) {
+        op = 'n';
+    } else if (match_token(TOK_LT) || peek_char() == '<') {
+        op = '<';
+        if (peek_char() == '<') {
+            get_next_char();
+        }
+    } else if (match_token(TOK_GT) || peek_char() == '>') {
+        op = '>';
+        if (peek_char() == '>') {
+            get_next_char();
+        }
+    } else if (match_token(TOK_LE)) {
+        op = 'l';
+    } else if (match_token(TOK_GE)) {
+        op = 'g';
+    } else {
+        return left;
+    }
+    return binop(op, left, p_add());
+}
+
+/*
+ * AND operator
+ */
+static node_t *
+p_and()
+{
+    node_t *left;
+
+    left = p_compare();
+    while (left && match_token(TOK_AND)) {
+        left = binop('&', left, p_compare());
+    }
+    return left;
+}
+
+/*
+ * OR, XOR operators
+ */
+static node_t *
+p_or()
+{
+    node_t *left;
+
+    left = p_and();
+    while (left) {
+        if (match_token(TOK_OR)) {
+            left = binop('|', left, p_and());
+        } else if (match_token(TOK_XOR)) {
+            left = binop('x', left, p_and());
+        } else {
+            break;
+        }
+    }
+    return left;
+}
+
+/*
+ * Code generation
+ *
+ * Slot 0 is eax or xmm0, slot 1 is ecx or xmm1.  Integers are in the
+ * general register, single and double precision values in the xmm
+ * register as doubles.
+ */
+
+/*
+ * Convert a slot between integer and floating point
+ */
+static void
+convert(slot, from, to)
+int slot;
+int from;
+int to;
+{
+    if ((from == TYPE_INT) == (to == TYPE_INT)) {
+        return;
+    }
+    if (to == TYPE_INT) {
+        emit4(0xF2, 0x0F, 0x2C, slot ? 0xC9 : 0xC0);    /* cvttsd2si */
+    } else {
+        emit4(0xF2, 0x0F, 0x2A, slot ? 0xC9 : 0xC0);    /* cvtsi2sd */
+    }
+}
+
+/*
+ * Load a value of the given type from [rdx] (reg 2) or [rax] (reg 0)
+ */
+static void
+load(slot, type, reg)
+int slot;
+int type;
+int reg;
+{
+    int modrm;
+
+    modrm = (slot << 3) | reg;
+    switch (type) {
+        case TYPE_INT:
+            emit2(0x8B, modrm);                         /* mov r32, [] */
+            break;
+        case TYPE_SNG:
+            emit4(0xF3, 0x0F, 0x10, modrm);             /* movss */
+            emit4(0xF3, 0x0F, 0x5A, slot ? 0xC9 : 0xC0); /* cvtss2sd */
+            break;
+        default:
+            emit4(0xF2, 0x0F, 0x10, modrm);             /* movsd */
+            break;
+    }
+}
+
+/*
+ * Store slot 0 converted to type at [rdx], as set_variable() converts
+ */
+static void
+store(vtype, etype)
+int vtype;
+int etype;
+{
+    convert(0, etype, vtype == TYPE_INT ? TYPE_INT : TYPE_DBL);
+    switch (vtype) {
+        case TYPE_INT:
+            emit2(0x89, 0x02);                          /* mov [rdx], eax */
+            break;
+        case TYPE_SNG:
+            emit4(0xF2, 0x0F, 0x5A, 0xC0);              /* cvtsd2ss */
+            emit4(0xF3, 0x0F, 0x11, 0x02);              /* movss [rdx] */
+            break;
+        default:
+            emit4(0xF2, 0x0F, 0x11, 0x02);              /* movsd [rdx] */
+            break;
+    }
+}
+
+/*
+ * Load a double constant into a slot
+ */
+static void
+load_double(slot, d)
+int slot;
+double d;
+{
+    unsigned long bits;
+
+    memcpy(&bits, &d, sizeof(bits));
+    mov_imm64(2, bits);
+    emit5(0x66, 0x48, 0x0F, 0x6E, slot ? 0xCA : 0xC2);  /* movq xmm, rdx */
+}
+
+/*
+ * Move slot 0 to the stack and back
+ */
+static void
+push0(type)
+int type;
+{
+    if (type != TYPE_INT) {
+        emit5(0x66, 0x48, 0x0F, 0x7E, 0xC0);            /* movq rax, xmm0 */
+    }
+    emit(0x50);                                         /* push rax */
+    depth++;
+}
+
+static void
+pop0(type)
+int type;
+{
+    emit(0x58);                                         /* pop rax */
+    depth--;
+    if (type != TYPE_INT) {
+        emit5(0x66, 0x48, 0x0F, 0x6E, 0xC0);            /* movq xmm0, rax */
+    }
+}
+
+/*
+ * Constants and scalar variables can load straight into either slot
+ */
+static int
+is_leaf(n)
+node_t *n;
+{
+    return n->kind == N_CONST || n->kind == N_VAR;
+}
+
+static void
+gen_leaf(n, slot)
+node_t *n;
+int slot;
+{
+    if (n->kind == N_CONST) {
+        if (n->type == TYPE_INT) {
+            emit(slot ? 0xB9 : 0xB8);                   /* mov r32, imm */
+            imm32((long)n->ival);
+        } else {
+            load_double(slot, n->dval);
+        }
+    } else {
+        mov_imm64(2, (unsigned long)&n->var->value);    /* mov rdx, var */
+        load(slot, n->type, 2);
+    }
+}
+
+/*
+ * Address of an array element in rax, checking the subscripts
+ */
+static void
+gen_element(n)
+node_t *n;
+{
+    int k;
+
+    for (k = 0; k < n->nkids; k++) {
+        gen(n->kid[k]);
+        convert(0, n->kid[k]->type, TYPE_INT);
+        emit(0x3D);                                     /* cmp eax, dim */
+        imm32((long)n->arr->dims[k]);
+        jcc_to(0x3, OFF_SUBSCRIPT);                     /* jae */
+        if (k > 0) {
+            emit(0x59);                                 /* pop rcx */
+            depth--;
+            emit2(0x69, 0xC9);                          /* imul ecx, dim */
+            imm32((long)n->arr->dims[k]);
+            emit2(0x01, 0xC8);                          /* add eax, ecx */
+        }
+        if (k < n->nkids - 1) {
+            emit(0x50);                                 /* push rax */
+            depth++;
+        }
+    }
+    mov_imm64(1, (unsigned long)n->arr->data);          /* mov rcx, data */
+    emit4(0x48, 0x8D, 0x04, 0xC1);                      /* lea rax, [rcx+rax*8] */
+}
+
+/*
+ * Binary operator - left in slot 0, right in slot 1, then the operation
+ */
+static void
+gen_binop(n)
+node_t *n;
+{
+    node_t *left;
+    node_t *right;
+    int cls;
+    int op;
+
+    left = n->kid[0];
+    right = n->kid[1];
+    op = n->op;
+
+    /* Class the operation works in: integer or double */
+    switch (op) {
+        case '+':
+        case '-':
+        case '*':
+            cls = n->type;
+            break;
+        case '/':
+        case '^':
+            cls = TYPE_DBL;
+            break;
+        case '\\':
+        case '%':
+        case '&':
+        case '|':
+        case 'x':
+            cls = TYPE_INT;
+            break;
+        default:
+            cls = (left->type == TYPE_INT && right->type == TYPE_INT) ?
+                  TYPE_INT : TYPE_DBL;
+            break;
+    }
+
+    gen(left);
+    convert(0, left->type, cls);
+    if (is_leaf(right)) {
+        gen_leaf(right, 1);
+        convert(1, right->type, cls);
+    } else {
+        push0(cls);
+        gen(right);
+        convert(0, right->type, cls);
+        if (cls == TYPE_INT) {
+            emit2(0x89, 0xC1);                          /* mov ecx, eax */
+        } else {
+            emit4(0x66, 0x0F, 0x28, 0xC8);              /* movapd xmm1, xmm0 */
+        }
+        pop0(cls);
+    }
+
+    if (cls == TYPE_INT) {
+        switch (op) {
+            case '+': emit2(0x01, 0xC8); return;        /* add eax, ecx */
+            case '-': emit2(0x29, 0xC8); return;        /* sub eax, ecx */
+            case '*': emit3(0x0F, 0xAF, 0xC1); return;  /* imul eax, ecx */
+            case '&': emit2(0x21, 0xC8); return;        /* and eax, ecx */
+            case '|': emit2(0x09, 0xC8); return;        /* or eax, ecx */
+            case 'x': emit2(0x31, 0xC8); return;        /* xor eax, ecx */
+            case '\\':
+            case '%':
+                emit2(0x89, 0xC7);                      /* mov edi, eax */
+                emit2(0x89, 0xCE);                      /* mov esi, ecx */
+                call_helper(op == '%' ? (unsigned long)jit_mod :
+                            (unsigned long)jit_idiv);
+                return;
+        }
+        emit2(0x39, 0xC8);                              /* cmp eax, ecx */
+        switch (op) {
+            case 'e': emit3(0x0F, 0x94, 0xC0); break;   /* sete al */
+            case 'n': emit3(0x0F, 0x95, 0xC0); break;   /* setne al */
+            case '<': emit3(0x0F, 0x9C, 0xC0); break;   /* setl al */
+            case '>': emit3(0x0F, 0x9F, 0xC0); break;   /* setg al */
+            case 'l': emit3(0x0F, 0x9E, 0xC0); break;   /* setle al */
+            default: emit3(0x0F, 0x9D, 0xC0); break;    /* setge al */
+        }
+    } else {
+        switch (op) {
+            case '+': emit4(0xF2, 0x0F, 0x58, 0xC1); return;    /* addsd */
+            case '-': emit4(0xF2, 0x0F, 0x5C, 0xC1); return;    /* subsd */
+            case '*': emit4(0xF2, 0x0F, 0x59, 0xC1); return;    /* mulsd */
+            case '/': call_helper((unsigned long)jit_div); return;
+            case '^': call_helper((unsigned long)pow); return;
+        }
+        /* Unordered (NaN) operands compare unequal, as in C */
+        switch (op) {
+            case 'e':
+                emit4(0x66, 0x0F, 0x2E, 0xC1);          /* ucomisd xmm0, xmm1 */
+                emit3(0x0F, 0x94, 0xC0);                /* sete al */
+                emit3(0x0F, 0x9B, 0xC1);                /* setnp cl */
+                emit2(0x20, 0xC8);                      /* and al, cl */
+                break;
+            case 'n':
+                emit4(0x66, 0x0F, 0x2E, 0xC1);          /* ucomisd xmm0, xmm1 */
+                emit3(0x0F, 0x95, 0xC0);                /* setne al */
+                emit3(0x0F, 0x9A, 0xC1);                /* setp cl */
+                emit2(0x08, 0xC8);                      /* or al, cl */
+                break;
+            case '<':
+            case 'l':
+                emit4(0x66, 0x0F, 0x2E, 0xC8);          /* ucomisd xmm1, xmm0 */
+                emit3(0x0F, op == '<' ? 0x97 : 0x93, 0xC0); /* seta/setae */
+                break;
+            default:
+                emit4(0x66, 0x0F, 0x2E, 0xC1);          /* ucomisd xmm0, xmm1 */
+                emit3(0x0F, op == '>' ? 0x97 : 0x93, 0xC0); /* seta/setae */
+                break;
+        }
+    }
+    emit3(0x0F, 0xB6, 0xC0);                            /* movzx eax, al */
+    emit2(0xF7, 0xD8);                                  /* neg eax */
+}
+
+/*
+ * Evaluate an expression into slot 0
+ */
+static void
+gen(n)
+node_t *n;
+{
+    switch (n->kind) {
+        case N_CONST:
+        case N_VAR:
+            gen_leaf(n, 0);
+            break;
+
+        case N_ELEM:
+            gen_element(n);
+            load(0, n->type, 0);
+            break;
+
+        case N_FUNC:
+            gen(n->kid[0]);
+            convert(0, n->kid[0]->type, TYPE_DBL);
+            call_helper((unsigned long)n->fn);
+            break;
+
+        case N_NEG:
+            gen(n->kid[0]);
+            if (n->type == TYPE_INT) {
+                emit2(0xF7, 0xD8);                      /* neg eax */
+            } else {
+                emit5(0x66, 0x48, 0x0F, 0x7E, 0xC0);    /* movq rax, xmm0 */
+                emit5(0x48, 0x0F, 0xBA, 0xF8, 0x3F);    /* btc rax, 63 */
+                emit5(0x66, 0x48, 0x0F, 0x6E, 0xC0);    /* movq xmm0, rax */
+            }
+            break;
+
+        case N_NOT:
+            gen(n->kid[0]);
+            convert(0, n->kid[0]->type, TYPE_INT);
+            emit2(0xF7, 0xD0);                          /* not eax */
+            break;
+
+        default:
+            gen_binop(n);
+            break;
+    }
+}
+
+/*
+ * Parse and evaluate an expression into slot 0, returns its type
+ */
+static int
+expression()
+{
+    node_t *n;
+
+    nnodes = 0;
+    n = p_or();
+    if (!n || fail) {
+        fail = 1;
+        return TYPE_SNG;
+    }
+    gen(n);
+    return n->type;
+}
+
+/*
+ * Jump if slot 0 holds zero, as the test of do_if()
+ * Returns the offset to patch
+ */
+static int
+jump_if_zero(type)
+int type;
+{
+    if (type == TYPE_INT) {
+        emit2(0x85, 0xC0);                              /* test eax, eax */
+    } else {
+        emit4(0x66, 0x0F, 0x57, 0xC9);                  /* xorpd xmm1, xmm1 */
+        emit4(0x66, 0x0F, 0x2E, 0xC1);                  /* ucomisd xmm0, xmm1 */
+        emit2(0x7A, 0x06);                              /* jp over the je */
+    }
+    return jcc_forward(0x4);                            /* je */
+}
+
+/*
+ * Statements
+ */
+
+/*
+ * Read a name the way do_let() and do_for() do
+ */
+static void
+read_name(name, suffix)
+char *name;
+int suffix;
+{
+    char *p;
+    int c;
+
+    skip_spaces();
+    p = name;
+    while (1) {
+        c = peek_char();
+        if (!(IS_ALNUM(c) || c == '.' ||
+              (suffix && (c == '$' || c == '%' || c == '!' || c == '#')))) {
+            break;
+        }
+        if (p - name < NAMLEN) {
+            *p++ = get_next_char();
+        } else {
+            get_next_char();
+        }
+    }
+    *p = '\0';
+}
+
+/*
+ * Skip the '=' of an assignment
+ */
+static int
+equals()
+{
+    skip_spaces();
+    if (peek_char() == '=' || match_token(TOK_EQ)) {
+        if (peek_char() == '=') {
+            get_next_char();
+        }
+        return 1;
+    }
+    fail = 1;
+    return 0;
+}
+
+/*
+ * Assignment to a numeric variable or array element
+ */
+static void
+c_let()
+{
+    char name[NAMLEN+1];
+    node_t *elem;
+    var_t *var;
+    int type;
+
+    read_name(name, 1);
+    if (name[0] == '\0' || strchr(name, '$')) {
+        fail = 1;
+        return;
+    }
+
+    skip_spaces();
+    if (peek_char() == '(') {
+        get_next_char();
+        nnodes = 0;
+        elem = p_subscripts(name);
+        if (!elem || !equals()) {
+            fail = 1;
+            return;
+        }
+        gen_element(elem);
+        emit(0x50);                                     /* push rax */
+        depth++;
+        type = expression();
+        emit(0x5A);                                     /* pop rdx */
+        depth--;
+        store(elem->arr->type, type);
+        return;
+    }
+
+    if (!equals()) {
+        return;
+    }
+    type = expression();
+    var = find_variable(name, 1);
+    if (var->type == TYPE_STR) {
+        fail = 1;
+        return;
+    }
+    mov_imm64(2, (unsigned long)&var->value);           /* mov rdx, var */
+    store(var->type, type);
+}
+
+/*
+ * GOTO or THEN/ELSE with a line number
+ */
+static void
+c_goto()
+{
+    long n;
+    line_t *line;
+
+    skip_spaces();
+    if (!IS_DIGIT(peek_char())) {
+        fail = 1;
+        return;
+    }
+    n = 0L;
+    while (IS_DIGIT(peek_char())) {
+        n = n * 10L + (get_next_char() - '0');
+        if (n > (long)MAXLIN) {
+            fail = 1;
+            return;
+        }
+    }
+    line = find_line((int)n);
+    if (!line) {
+        fail = 1;
+        return;
+    }
+
+    /* continue_program() only sees a jump if the line number changes */
+    if (line == g_state->curline_ptr) {
+        line = next_line(line);
+    }
+    goto_line(line);
+}
+
+/*
+ * IF statement
+ */
+static void
+c_if()
+{
+    int type;
+    int iffalse;
+    int done;
+
+    type = expression();
+    if (fail) {
+        return;
+    }
+    skip_spaces();
+    match_token(TOK_THEN);
+    skip_spaces();
+
+    iffalse = jump_if_zero(type);
+
+    /* THEN branch: a line number or statements up to ELSE */
+    if (IS_DIGIT(peek_char())) {
+        c_goto();
+        skip_spaces();
+        if (peek_char() != '\0' && peek_char() != TOK_ELSE) {
+            fail = 1;
+        }
+    } else if (compile_statements(1) != TOK_ELSE && peek_char() != '\0') {
+        fail = 1;
+    }
+    done = jmp_forward();
+
+    /* ELSE branch */
+    patch(iffalse, len);
+    if (peek_char() == TOK_ELSE) {
+        get_next_char();
+        skip_spaces();
+        if (IS_DIGIT(peek_char())) {
+            c_goto();
+        } else {
+            compile_statements(1);
+        }
+        if (peek_char() != '\0') {
+            fail = 1;
+        }
+    }
+    patch(done, len);
+}
+
+/*
+ * FOR statement
+ */
+static void
+c_for(line)
+line_t *line;
+{
+    char name[NAMLEN+1];
+    var_t *var;
+    int type;
+
+    read_name(name, 0);
+    if (name[0] == '\0' || !equals()) {
+        fail = 1;
+        return;
+    }
+    var = find_variable(name, 1);
+
+    /* Start value goes in first, as do_for() stores it */
+    type = expression();
+    convert(0, type, TYPE_DBL);
+    mov_imm64(2, (unsigned long)&var->value);
+    store(var->type, TYPE_DBL);
+
+    skip_spaces();
+    if (!match_token(TOK_TO)) {
+        fail = 1;
+        return;
+    }
+    type = expression();
+    convert(0, type, TYPE_DBL);
+
+    skip_spaces();
+    if (match_token(TOK_STEP)) {
+        push0(TYPE_DBL);
+        type = expression();
+        convert(0, type, TYPE_DBL);
+        emit4(0x66, 0x0F, 0x28, 0xC8);                  /* movapd xmm1, xmm0 */
+        pop0(TYPE_DBL);
+    } else {
+        load_double(1, 1.0);
+    }
+    if (match_token(TOK_PARALLEL) || fail) {
+        fail = 1;
+        return;
+    }
+
+    mov_imm64(7, (unsigned long)var);                   /* mov rdi, var */
+    emit(0xBE);                                         /* mov esi, line */
+    imm32((long)line->linenum);
+    mov_imm64(2, (unsigned long)g_state->txtptr);       /* mov rdx, text */
+    call_helper((unsigned long)jit_for);
+
+    /* NEXT comes back here while the loop runs, maybe from another line */
+    if (nforloops < STACK_SIZE) {
+        forloops[nforloops].text = g_state->txtptr;
+        forloops[nforloops].offset = len;
+        nforloops++;
+    }
+    mov_imm64(2, (unsigned long)&g_state->curlin);      /* mov rdx, &curlin */
+    emit2(0xC7, 0x02);                                  /* mov [rdx], line */
+    imm32((long)line->linenum);
+}
+
+/*
+ * NEXT statement
+ */
+static void
+c_next()
+{
+    char name[NAMLEN+1];
+    var_t *var;
+    unsigned char *text;
+    int target;
+
+    var = NULL;
+    skip_spaces();
+    if (IS_ALPHA(peek_char())) {
+        read_name(name, 0);
+        var = find_variable(name, 1);
+    }
+
+    /* The innermost FOR compiled before this NEXT, if any */
+    text = NULL;
+    target = 0;
+    if (nforloops > 0) {
+        nforloops--;
+        text = forloops[nforloops].text;
+        target = forloops[nforloops].offset;
+    }
+
+    mov_imm64(7, (unsigned long)var);                   /* mov rdi, var */
+    mov_imm64(6, (unsigned long)text);                  /* mov rsi, text */
+    call_helper((unsigned long)jit_next);
+    if (text) {
+        emit3(0x83, 0xF8, 0x01);                        /* cmp eax, 1 */
+        jcc_to(0x4, target);                            /* je */
+    }
+    emit3(0x83, 0xF8, 0x02);                            /* cmp eax, 2 */
+    jcc_to(0x4, OFF_EPILOGUE);                          /* je */
+}
+
+/*
+ * Compile statements up to the end of the line (or an ELSE inside IF)
+ * Returns the character that ended them
+ */
+static int
+compile_statements(inif)
+int inif;
+{
+    int c;
+    int token;
+
+    while (!fail) {
+        depth = 0;
+        skip_spaces();
+        c = peek_char();
+        if (c == ':') {
+            get_next_char();
+            skip_spaces();
+            c = peek_char();
+        }
+        if (c == '\0') {
+            return c;
+        }
+        if (inif && c == TOK_ELSE) {
+            return c;
+        }
+
+        if (IS_ALPHA(c)) {
+            c_let();
+        } else {
+            token = get_next_char();
+            if ((token & 0xFF) == 0xFF) {
+                token = (token << 8) | get_next_char();
+            }
+            switch (token) {
+                case TOK_LET:
+                    c_let();
+                    break;
+                case TOK_IF:
+                    if (inif) {
+                        /* do_if() pairs nested ELSEs its own way */
+                        fail = 1;
+                        break;
+                    }
+                    c_if();
+                    return '\0';
+                case TOK_GOTO:
+                    c_goto();
+                    break;
+                case TOK_FOR:
+                    c_for(g_state->curline_ptr);
+                    break;
+                case TOK_NEXT:
+                    c_next();
+                    break;
+                case TOK_REM:
+                    skip_to_eol();
+                    return '\0';
+                default:
+                    fail = 1;
+                    break;
+            }
+        }
+
+        /* Like continue_program(), anything but ':' ends the line */
+        skip_spaces();
+        c = peek_char();
+        if (c != ':' && !(inif && c == TOK_ELSE)) {
+            if (inif && c != '\0') {
+                fail = 1;
+            }
+            return c;
+        }
+    }
+    return '\0';
+}
+
+/*
+ * Compile one line; falls through to the code of the next line
+ * Returns 0 if the line uses anything outside the subset
+ */
+static int
+compile_line(line)
+line_t *line;
+{
+    int bit;
+
+    g_state->txtptr = line->text;
+    g_state->curline_ptr = line;
+    fail = 0;
+
+    mov_imm64(2, (unsigned long)&g_state->curlin);      /* mov rdx, &curlin */
+    emit2(0xC7, 0x02);                                  /* mov [rdx], line */
+    imm32((long)line->linenum);
+
+    /* Set the line's coverage bit unless it is set (see cover.c) */
+    if ((g_state->profiling & PROF_COVER) && cover_get()) {
+        mov_imm64(0, (unsigned long)cover_bit(line->linenum, &bit));
+        emit3(0xF6, 0x00, bit);                         /* test [rax], bit */
+        emit2(0x75, 0x04);                              /* jnz +4 */
+        emit4(0xF0, 0x80, 0x08, bit);                   /* lock or [rax], bit */
+    }
+
+    compile_statements(0);
+    return !fail;
+}
+
+/*
+ * Line table
+ */
+
+/*
+ * Find (or add) the table entry for a line
+ */
+static jit_line_t *
+lookup(jit, line)
+struct jit_s *jit;
+line_t *line;
+{
+    jit_line_t *old;
+    jit_line_t *e;
+    unsigned long h;
+    int oldcap;
+    int i;
+
+    /* Keep the table at most half full */
+    if (jit->nlines * 2 >= jit->cap) {
+        old = jit->lines;
+        oldcap = jit->cap;
+        jit->cap = oldcap ? oldcap * 2 : 256;
+        jit->lines = (jit_line_t *)calloc((size_t)jit->cap,
+                                          sizeof(jit_line_t));
+        if (!jit->lines) {
+            jit->lines = old;
+            jit->cap = oldcap;
+            jit->enabled = 0;
+            return NULL;
+        }
+        jit->nlines = 0;
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].line) {
+                e = lookup(jit, old[i].line);
+                *e = old[i];
+            }
+        }
+        if (old) {
+            free(old);
+        }
+    }
+
+    h = ((unsigned long)line >> 2) * 2654435761UL;
+    i = (int)(h & (unsigned long)(jit->cap - 1));
+    while (jit->lines[i].line && jit->lines[i].line != line) {
+        i = (i + 1) & (jit->cap - 1);
+    }
+    e = &jit->lines[i];
+    if (!e->line) {
+        e->line = line;
+        jit->nlines++;
+    }
+    return e;
+}
+
+/*
+ * Check whether a line can be compiled, remembering the answer
+ */
+static int
+compilable(jit, line)
+struct jit_s *jit;
+line_t *line;
+{
+    jit_line_t *e;
+    int ok;
+
+    e = lookup(jit, line);
+    if (!e || e->state != LINE_COUNTING) {
+        return 0;
+    }
+    first = NULL;
+    nforloops = 0;
+    len = 0;
+    ok = compile_line(line);
+    len = 0;
+    if (!ok) {
+        e = lookup(jit, line);
+        if (e) {
+            e->state = LINE_FAILED;
+        }
+    }
+    return ok;
+}
+
+/*
+ * Compile the run of lines around a hot line
+ */
+static void
+compile_region(jit, hot)
+struct jit_s *jit;
+line_t *hot;
+{
+    line_t *line;
+    line_t *prev;
+    line_t *start;
+    region_t *r;
+    jit_line_t *e;
+    unsigned char *code;
+    size_t size;
+    int offsets[MAXREGION + 1];
+    char name[40];
+    int n;
+    int i;
+    int k;
+
+    if (!compilable(jit, hot)) {
+        return;
+    }
+
+    /* Extend backwards over compilable lines (lines are in memory order) */
+    start = hot;
+    n = 1;
+    while (n < MAXREGION / 2) {
+        prev = NULL;
+        line = (line_t *)g_state->txttab;
+        while (line && line != start) {
+            prev = line;
+            line = next_line(line);
+        }
+        if (!prev || !compilable(jit, prev)) {
+            break;
+        }
+        start = prev;
+        n++;
+    }
+
+    /* And forwards */
+    last = hot;
+    while (n < MAXREGION) {
+        line = next_line(last);
+        if (!line || !compilable(jit, line)) {
+            break;
+        }
+        last = line;
+        n++;
+    }
+    first = start;
+
+    /* Prologue (entry address in rdi), epilogue, error stub */
+    len = 0;
+    fail = 0;
+    nfixups = 0;
+    nforloops = 0;
+    emit(0x55);                                         /* push rbp */
+    emit3(0x48, 0x89, 0xE5);                            /* mov rbp, rsp */
+    emit2(0xFF, 0xE7);                                  /* jmp rdi */
+    emit3(0x48, 0x89, 0xEC);                            /* mov rsp, rbp */
+    emit(0x5D);                                         /* pop rbp */
+    emit(0xC3);                                         /* ret */
+    emit4(0x48, 0x83, 0xE4, 0xF0);                      /* and rsp, -16 */
+    emit(0xBF);                                         /* mov edi, err */
+    imm32((long)ERR_SUBSCRIPT);
+    depth = 0;
+    call_helper((unsigned long)error);
+
+    /* The lines, then an exit to the line after the region */
+    line = first;
+    for (i = 0; i < n; i++) {
+        offsets[i] = len;
+        if (!compile_line(line)) {
+            break;
+        }
+        line = next_line(line);
+    }
+    offsets[n] = len;
+    depth = 0;
+    exit_to(line);
+
+    /* Jumps between lines */
+    for (k = 0; k < nfixups && !fail; k++) {
+        line = first;
+        for (i = 0; i < n && line != fixups[k].line; i++) {
+            line = next_line(line);
+        }
+        patch(fixups[k].at, offsets[i]);
+    }
+
+    if (fail || len == 0) {
+        e = lookup(jit, hot);
+        if (e) {
+            e->state = LINE_FAILED;
+        }
+        first = NULL;
+        return;
+    }
+
+    /* Copy into executable memory */
+    size = (size_t)len;
+    code = (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANON, -1, (off_t)0);
+    r = (region_t *)malloc(sizeof(region_t));
+    if (code == (unsigned char *)MAP_FAILED || !r) {
+        if (code != (unsigned char *)MAP_FAILED) {
+            munmap((void *)code, size);
+        }
+        if (r) {
+            free(r);
+        }
+        jit->enabled = 0;
+        first = NULL;
+        return;
+    }
+    memcpy(code, buf, size);
+    mprotect((void *)code, size, PROT_READ | PROT_EXEC);
+    r->code = code;
+    r->size = size;
+    r->next = jit->regions;
+    jit->regions = r;
+
+    /* Tell perf which line each piece of code implements (see perf.c) */
+    if (perf_on) {
+        sprintf(name, "BASIC lines %d-%d (entry)", first->linenum,
+                last->linenum);
+        perf_code(code, (unsigned long)offsets[0], name);
+        line = first;
+        for (i = 0; i < n; i++) {
+            sprintf(name, "BASIC line %d", line->linenum);
+            perf_code(code + offsets[i],
+                      (unsigned long)(offsets[i + 1] - offsets[i]), name);
+            line = next_line(line);
+        }
+        sprintf(name, "BASIC lines %d-%d (exit)", first->linenum,
+                last->linenum);
+        perf_code(code + offsets[n], (unsigned long)(len - offsets[n]), name);
+    }
+
+    line = first;
+    for (i = 0; i < n; i++) {
+        e = lookup(jit, line);
+        if (e) {
+            e->state = LINE_COMPILED;
+            e->code = code;
+            e->entry = code + offsets[i];
+        }
+        line = next_line(line);
+    }
+    first = NULL;
+}
+
+/*
+ * Set up the JIT for the current interpreter state
+ */
+static struct jit_s *
+jit_create()
+{
+    struct jit_s *jit;
+    char *env;
+
+    jit = (struct jit_s *)calloc(1, sizeof(struct jit_s));
+    if (!jit) {
+        return NULL;
+    }
+    jit->enabled = 1;
+    jit->hot = JIT_HOT;
+    env = getenv("GWBASIC_JIT");
+    if (env) {
+        jit->hot = atoi(env);
+        jit->enabled = jit->hot > 0;
+    }
+    g_state->jit = jit;
+    return jit;
+}
+
+/*
+ * Called by continue_program() at the start of every line
+ * Returns 1 if the line ran as compiled code, which has left the
+ * interpreter's position wherever the program went next
+ */
+int
+jit_run()
+{
+    struct jit_s *jit;
+    jit_line_t *e;
+    line_t *line;
+    unsigned char *saved;
+    void (*fn)();
+
+    if (g_state->sched || g_state->tracing || sample_on ||
+        (g_state->profiling & (PROF_LINES | PROF_TRACE)) ||
+        g_state->forstop > 0) {
+        return 0;
+    }
+    jit = g_state->jit;
+    if (!jit) {
+        jit = jit_create();
+        if (!jit) {
+            return 0;
+        }
+    }
+    if (!jit->enabled) {
+        return 0;
+    }
+
+    line = g_state->curline_ptr;
+    e = lookup(jit, line);
+    if (!e) {
+        return 0;
+    }
+    if (e->state == LINE_COUNTING && ++e->count >= jit->hot) {
+        /* Compiling parses the program text - keep our place */
+        saved = g_state->txtptr;
+        compile_region(jit, line);
+        g_state->txtptr = saved;
+        g_state->curline_ptr = line;
+        g_state->curlin = line->linenum;
+        e = lookup(jit, line);
+        if (!e) {
+            return 0;
+        }
+    }
+    if (e->state != LINE_COMPILED) {
+        return 0;
+    }
+
+    fn = (void (*)())e->code;
+    (*fn)(e->entry);
+    return 1;
+}
+
+/*
+ * Discard all compiled code
+ */
+void
+jit_release()
+{
+    struct jit_s *jit;
+    region_t *r;
+    region_t *next;
+
+    jit = g_state->jit;
+    if (!jit) {
+        return;
+    }
+    for (r = jit->regions; r != NULL; r = next) {
+        next = r->next;
+        munmap((void *)r->code, r->size);
+        free(r);
+    }
+    if (jit->lines) {
+        free(jit->lines);
+    }
+    free(jit);
+    g_state->jit = NULL;
+}
+
+#else
+
+/*
+ * No JIT on this system - every line is interpreted
+ */
+int
+jit_run()
+{
+    return 0;
+}
+
+void
+jit_release()
+{
+}
+
+#endif /* GW_JIT && __x86_64__ */
@@ -7,7 +7,7 @@
 #include "gwbasic.h"
 
 /* Global state */
-state_t *g_state = NULL;
+GW_TLS state_t *g_state = NULL;
 
 /*
  * Initialize interpreter state
@@ -17,6 +17,9 @@ init_state()
 {
     int i;
     long memsize;
+#if !IS_16BIT
+    char *env;
+#endif
 
     g_state = (state_t *)malloc(sizeof(state_t));
     if (!g_state) {
@@ -27,6 +30,14 @@ init_state()
     /* Allocate memory for BASIC program and data */
     /* Try progressively smaller sizes if allocation fails */
     memsize = PROGRAM_SIZE;
+#if !IS_16BIT
+    /* GWBASIC_MEM asks for more, for very large programs */
+    env = getenv("GWBASIC_MEM");
+    if (env && atol(env) > memsize) {
+        /* Whole string heap blocks (see strings.c) */
+        memsize = atol(env) & ~15L;
+    }
+#endif
     g_state->txttab = NULL;
     while (memsize >= 4096L && !g_state->txttab) {
         g_state->txttab = (unsigned char *)malloc((unsigned)memsize);
@@ -49,6 +60,9 @@ init_state()
     g_state->strend = g_state->txttab + 2;
     g_state->fretop = g_state->txttab + memsize;
     g_state->memsiz = g_state->txttab + memsize;
+    g_state->strheap = 1;
+    g_state->strfree = NULL;
+    g_state->strslabs = NULL;
 
     /* Initialize state */
     g_state->curlin = 0;
@@ -59,6 +73,7 @@ init_state()
     g_state->arrlist = NULL;
 
     g_state->forsp = 0;
+    g_state->forstop = 0;
     g_state->gosubsp = 0;
     g_state->whilesp = 0;
 
@@ -70,8 +85,31 @@ init_state()
 
     g_state->running = 0;
     g_state->tracing = 0;
+    g_state->profiling = (profile_all ? PROF_LINES : 0) |
+                         (trace_on ? PROF_TRACE : 0) |
+                         (cover_on ? PROF_COVER : 0) |
+                         (calls_on ? PROF_CALLS : 0);
+    g_state->prof = NULL;
+    g_state->regions = NULL;
+    g_state->cover = NULL;
+    g_state->calls = NULL;
+
+    g_state->sched = 0;
+    g_state->yield = 0;
+    g_state->slice = 0;
+    g_state->wakeup = 0.0;
+    g_state->waitfd = -1;
+    g_state->inwait = NULL;
+
+    g_state->segbase = NULL;
+    g_state->segshared = 0;
+
+    g_state->usrtab = NULL;
+
+    g_state->jit = NULL;
 
     g_state->rndseed = 1;
+    g_state->tmpused = 0;
 
     /* Clear input buffer */
     for (i = 0; i < BUFLEN + 1; i++) {
@@ -86,35 +124,135 @@ void
 cleanup()
 {
     if (g_state) {
-        if (g_state->txttab) {
-            free(g_state->txttab);
+        /* A program left by SYSTEM still gets its profile */
+        profile_report();
+        cover_report();
+        calls_report();
+        if (memstat_on) {
+            memstat_report(stderr);
         }
         clear_variables();
         clear_arrays();
+        string_release();
+        if (g_state->txttab) {
+            free(g_state->txttab);
+        }
+        mem_release();
+        usr_release();
+        cover_release();
+        calls_release();
         free(g_state);
         g_state = NULL;
     }
 }
 
+#ifndef GW_NO_MAIN
 /*
  * Main entry point
+ * GW_NO_MAIN leaves it out for programs that link the interpreter
+ * (bench/micro.c)
  */
 int
 main(argc, argv)
 int argc;
 char **argv;
 {
+    char *outname;
+    char *statsname;
+    char *tracename;
+    int emit;           /* 1 for --emit-c, 2 for --compile */
+    int timed;          /* --trace-time */
+    int nfiles;
     int result;
+    int i;
+
+    /* Options - the remaining arguments are program files */
+    emit = 0;
+    outname = NULL;
+    statsname = NULL;
+    tracename = NULL;
+    timed = 0;
+    nfiles = 0;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emit-c") == 0) {
+            emit = 1;
+        } else if (strcmp(argv[i], "--compile") == 0) {
+            emit = 2;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile_all = 1;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsname = argv[++i];
+        } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+            if (sample_start(argv[++i]) != 0) {
+                fprintf(stderr, "Cannot start sampling\n");
+            }
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracename = argv[++i];
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            if (perf_start() != 0) {
+                fprintf(stderr, "Cannot write perf symbols\n");
+            }
+        } else if (strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+            cover_start(argv[++i]);
+        } else if (strcmp(argv[i], "--memstat") == 0) {
+            memstat_on = 1;
+        } else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+            if (calls_start(argv[++i]) != 0) {
+                fprintf(stderr, "Cannot write %s\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--trace-time") == 0) {
+            timed = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outname = argv[++i];
+        } else {
+            argv[1 + nfiles++] = argv[i];
+        }
+    }
+    argc = 1 + nfiles;
+
+    /* Statements go to the ring file with --trace */
+    if (tracename && trace_start(tracename, timed) != 0) {
+        fprintf(stderr, "Cannot trace to %s\n", tracename);
+    }
+
+    /* Counters go out on SIGUSR1, and at exit with --stats */
+    stats_start(statsname);
 
     /* Initialize interpreter */
     init_state();
 
+    /* Translate a program to C or an executable instead of running it */
+    if (emit) {
+        if (nfiles != 1) {
+            fprintf(stderr, "Usage: %s --emit-c prog.bas [-o prog.c]\n",
+                    argv[0]);
+            fprintf(stderr, "       %s --compile prog.bas [-o prog]\n",
+                    argv[0]);
+            cleanup();
+            return 1;
+        }
+        if (emit == 2) {
+            result = compile_program(argv[1], outname);
+        } else {
+            result = emit_c(argv[1], outname);
+        }
+        cleanup();
+        return result;
+    }
+
     /* Print banner */
     printf("GW-BASIC 3.23\n");
     printf("(C) Copyright Microsoft 1983-1991\n");
     printf("C Port (C) 2025 Andy Taylor\n");
     printf("%ld Bytes free\n\n", (long)(g_state->fretop - g_state->strend));
 
+    /* Several programs: run them side by side as scheduled jobs */
+    if (argc > 2) {
+        result = sched_run(argv + 1, argc - 1);
+        cleanup();
+        return result ? 1 : 0;
+    }
+
     /* Check if a file was specified */
     if (argc > 1) {
         /* Load and run the specified file */
@@ -135,3 +273,4 @@ char **argv;
     cleanup();
     return 0;
 }
+#endif /* GW_NO_MAIN */
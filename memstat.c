@@ -0,0 +1,214 @@
+/*
+ * memstat.c - Memory census of a program's data
+ *
+ * FRE() only measures program memory, which holds the program text and
+ * the string data, but variables, arrays and string descriptors are on
+ * the C heap.  memstat_report() walks varlist and arrlist and lists the
+ * bytes held under each name, largest first: the descriptor, the array
+ * data and, for strings, every string_t and the room for characters too
+ * long to be kept in it (empty strings take nothing).  Totals follow for the
+ * strings, the program text, the string space in use (garbage included,
+ * until the next collection) and the interpreter's own structures.
+ *
+ * The MEMSTAT statement writes the census to standard output; with
+ * --memstat it is written to standard error when the interpreter
+ * exits.  Sizes are the bytes requested, without the C library's
+ * per-block overhead; a string shared by several names is counted
+ * under each of them.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+/* One name in the census */
+typedef struct {
+    char name[NAMLEN+4];    /* With type suffix and () for arrays */
+    int type;
+    long elements;
+    long bytes;             /* Descriptor, data and strings */
+    long strbytes;          /* Of which strings */
+} census_t;
+
+/* --memstat: report at exit */
+int memstat_on = 0;
+
+/*
+ * Bytes held by a string
+ */
+static long
+string_bytes(s)
+string_t *s;
+{
+    if (!s || (s->flags & STR_STATIC)) {
+        return 0L;
+    }
+    return (long)sizeof(string_t) +
+           (s->ptr != s->buf ? (long)s->cap + 1L : 0L);
+}
+
+/*
+ * Bytes held by a string outside the program buffer: its descriptor,
+ * and its data when that was malloc'ed instead of taken from the
+ * string space
+ */
+static long
+string_outside(s)
+string_t *s;
+{
+    if (!s || (s->flags & STR_STATIC)) {
+        return 0L;
+    }
+    return (long)sizeof(string_t) +
+           (s->ptr != s->buf && !(s->flags & STR_HEAP) ?
+            (long)s->cap + 1L : 0L);
+}
+
+/*
+ * Name with its type suffix
+ */
+static void
+census_name(e, name, type, array)
+census_t *e;
+const char *name;
+int type;
+int array;
+{
+    const char *suffix;
+
+    switch (type) {
+        case TYPE_INT: suffix = "%"; break;
+        case TYPE_DBL: suffix = "#"; break;
+        case TYPE_STR: suffix = "$"; break;
+        default: suffix = "!"; break;
+    }
+    sprintf(e->name, "%s%s%s", name, suffix, array ? "()" : "");
+    e->type = type;
+}
+
+/*
+ * Order by bytes, then name
+ */
+static int
+by_bytes(a, b)
+const void *a;
+const void *b;
+{
+    const census_t *x;
+    const census_t *y;
+
+    x = (const census_t *)a;
+    y = (const census_t *)b;
+    if (x->bytes != y->bytes) {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+/*
+ * Write the census of the current program's data to fp
+ */
+void
+memstat_report(fp)
+FILE *fp;
+{
+    census_t *list;
+    census_t *e;
+    var_t *var;
+    array_t *arr;
+    long varbytes;
+    long arrbytes;
+    long strbytes;
+    long outbytes;
+    long nstrings;
+    long text;
+    long buffer;
+    int nvars;
+    int narrs;
+    int n;
+    int i;
+
+    nvars = 0;
+    for (var = g_state->varlist; var; var = var->next) {
+        nvars++;
+    }
+    narrs = 0;
+    for (arr = g_state->arrlist; arr; arr = arr->next) {
+        narrs++;
+    }
+    list = (census_t *)malloc((nvars + narrs + 1) * sizeof(census_t));
+    if (!list) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+
+    /* Simple variables */
+    n = 0;
+    varbytes = 0L;
+    strbytes = 0L;
+    outbytes = 0L;
+    nstrings = 0L;
+    for (var = g_state->varlist; var; var = var->next) {
+        e = &list[n++];
+        census_name(e, var->name, var->type, 0);
+        e->elements = 1L;
+        e->strbytes = 0L;
+        if (var->type == TYPE_STR && var->value.strval) {
+            e->strbytes = string_bytes(var->value.strval);
+            outbytes += string_outside(var->value.strval);
+            nstrings++;
+        }
+        e->bytes = (long)sizeof(var_t) + e->strbytes;
+        varbytes += (long)sizeof(var_t);
+        strbytes += e->strbytes;
+    }
+
+    /* Arrays: data and the strings they own */
+    arrbytes = 0L;
+    for (arr = g_state->arrlist; arr; arr = arr->next) {
+        e = &list[n++];
+        census_name(e, arr->name, arr->type, 1);
+        e->elements = arr->data ? (long)arr->size : 0L;
+        e->strbytes = 0L;
+        if (arr->type == TYPE_STR && arr->data) {
+            for (i = 0; i < arr->size; i++) {
+                if (arr->data[i].strval) {
+                    e->strbytes += string_bytes(arr->data[i].strval);
+                    outbytes += string_outside(arr->data[i].strval);
+                    nstrings++;
+                }
+            }
+        }
+        e->bytes = (long)sizeof(array_t) +
+                   e->elements * (long)sizeof(value_t) + e->strbytes;
+        arrbytes += e->bytes - e->strbytes;
+        strbytes += e->strbytes;
+    }
+
+    qsort((void *)list, (size_t)n, sizeof(census_t), by_bytes);
+    fflush(stdout);
+    fprintf(fp, "%-14s %8s %10s %10s %6s\n", "name", "elements", "bytes",
+            "strings", "%");
+    for (i = 0; i < n; i++) {
+        e = &list[i];
+        fprintf(fp, "%-14s %8ld %10ld %10ld %6.2f\n", e->name, e->elements,
+                e->bytes, e->strbytes,
+                varbytes + arrbytes + strbytes > 0 ?
+                100.0 * e->bytes / (varbytes + arrbytes + strbytes) : 0.0);
+    }
+    free(list);
+
+    /* Totals */
+    text = (long)(g_state->vartab - g_state->txttab);
+    buffer = (long)(g_state->memsiz - g_state->txttab);
+    fprintf(fp, "Variables:     %10ld bytes in %d\n", varbytes, nvars);
+    fprintf(fp, "Arrays:        %10ld bytes in %d\n", arrbytes, narrs);
+    fprintf(fp, "Descriptors:   %10ld bytes in %ld strings\n", outbytes,
+            nstrings);
+    fprintf(fp, "Program text:  %10ld bytes of %ld\n", text, buffer);
+    fprintf(fp, "String space:  %10ld bytes of %ld\n",
+            (long)(g_state->memsiz - g_state->fretop), buffer - text);
+    fprintf(fp, "Interpreter:   %10ld bytes\n", (long)sizeof(state_t));
+    fprintf(fp, "Total:         %10ld bytes\n",
+            varbytes + arrbytes + outbytes + buffer + (long)sizeof(state_t));
+}
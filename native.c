@@ -0,0 +1,453 @@
+/*
+ * native.c - Calling C functions in shared objects with USR and CALL
+ *
+ *   DEF USRn = "library", "symbol", "signature"
+ *   X = USRn(args)        call, using the return value
+ *   CALL USRn(args)       call, discarding the return value
+ *
+ * n is a digit 0-9 (USR alone means USR0).  The library is loaded with
+ * dlopen() and the symbol looked up once, when DEF USR runs; the
+ * signature is parsed at the same time into a dispatch key, so a call
+ * only evaluates its arguments and jumps through a switch.
+ *
+ * The signature is "r:args" - a return type, a colon and up to four
+ * argument types:
+ *
+ *   return  d  double          arguments  d  double
+ *           i  int                        i  int
+ *           l  long                       l  long
+ *           v  none (returns 0)           s  const char * to a string
+ *                                         p  pointer to a variable
+ *
+ * A p argument must be a variable or array reference and is passed by
+ * address without copying: V passes &V, A(i) the address of that
+ * element, and A() the array's data.  Elements are value_t slots, so
+ * the data of a double (#) array is a plain double[].
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#define HAVE_DLOPEN 1
+#include <dlfcn.h>
+#endif
+
+/* K&R C compatible character tests - ctype macros may fail on old systems */
+#define IS_ALPHA(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_ALNUM(c) (IS_ALPHA(c) || IS_DIGIT(c))
+
+#define USR_COUNT   10  /* USR0 .. USR9 */
+#define USR_MAXARGS 4   /* Arguments per call */
+
+/* Declared native function */
+struct usr_s {
+    void *handle;               /* Library from dlopen(), NULL if unset */
+    void *fn;                   /* Entry point from dlsym() */
+    int ret;                    /* Return type letter */
+    int nargs;                  /* Number of arguments */
+    int key;                    /* nargs << 4 | mask of double arguments */
+    char args[USR_MAXARGS];     /* Argument type letters */
+};
+
+/*
+ * Get the USR number from a function name, or -1 if it isn't one
+ */
+int
+usr_index(name)
+const char *name;
+{
+    if (name[0] != 'U' || name[1] != 'S' || name[2] != 'R') {
+        return -1;
+    }
+    if (name[3] == '\0') {
+        return 0;
+    }
+    if (IS_DIGIT(name[3]) && name[4] == '\0') {
+        return name[3] - '0';
+    }
+    return -1;
+}
+
+/*
+ * Close every library and forget all definitions
+ */
+void
+usr_release()
+{
+    int i;
+
+    if (!g_state->usrtab) {
+        return;
+    }
+#ifdef HAVE_DLOPEN
+    for (i = 0; i < USR_COUNT; i++) {
+        if (g_state->usrtab[i].handle) {
+            dlclose(g_state->usrtab[i].handle);
+        }
+    }
+#else
+    i = 0;
+#endif
+    free(g_state->usrtab);
+    g_state->usrtab = NULL;
+}
+
+/*
+ * Parse a signature string into a table entry
+ * Returns 0 if it is malformed
+ */
+static int
+parse_signature(u, sig)
+struct usr_s *u;
+const char *sig;
+{
+    int c;
+
+    if (!sig[0] || sig[1] != ':' || !strchr("dilv", sig[0])) {
+        return 0;
+    }
+    u->ret = sig[0];
+    u->nargs = 0;
+    u->key = 0;
+    for (sig += 2; *sig; sig++) {
+        c = *sig;
+        if (c == ' ' || c == ',') {
+            continue;
+        }
+        if (!strchr("dilsp", c) || u->nargs == USR_MAXARGS) {
+            return 0;
+        }
+        if (c == 'd') {
+            u->key |= 1 << u->nargs;
+        }
+        u->args[u->nargs++] = c;
+    }
+    u->key |= u->nargs << 4;
+    return 1;
+}
+
+/*
+ * DEF USRn - load a library function and record its signature
+ * Returns 0, or the error for the caller to raise once it has freed
+ * the strings it passed
+ */
+int
+usr_define(n, lib, sym, sig)
+int n;
+const char *lib;
+const char *sym;
+const char *sig;
+{
+#ifdef HAVE_DLOPEN
+    struct usr_s u;
+    if (!parse_signature(&u, sig)) {
+        return ERR_ILLEGAL_FUNC;
+    }
+
+    if (!g_state->usrtab) {
+        g_state->usrtab = (struct usr_s *)calloc(USR_COUNT,
+                                                 sizeof(struct usr_s));
+        if (!g_state->usrtab) {
+            return ERR_OUT_OF_MEM;
+        }
+    }
+
+    u.handle = dlopen(*lib ? lib : (char *)NULL, RTLD_NOW);
+    if (!u.handle) {
+        return ERR_FILE_NOTFND;
+    }
+    u.fn = dlsym(u.handle, sym);
+    if (!u.fn) {
+        dlclose(u.handle);
+        return ERR_UNDEF_USER;
+    }
+
+    /* Redefinition replaces the old entry */
+    if (g_state->usrtab[n].handle) {
+        dlclose(g_state->usrtab[n].handle);
+    }
+    g_state->usrtab[n] = u;
+    return 0;
+#else
+    /* No dynamic loading on this system - arguments unused */
+    if (n || lib || sym || sig) {
+        /* do nothing */
+    }
+    return ERR_ILLEGAL_FUNC;
+#endif
+}
+
+/*
+ * Parse a variable or array reference and return its storage
+ */
+static void *
+parse_reference()
+{
+    char name[NAMLEN+2];
+    char *p;
+    int c;
+    int indices[8];
+    int nindices;
+    array_t *arr;
+    var_t *var;
+
+    skip_spaces();
+    p = name;
+    if (!IS_ALPHA(peek_char())) {
+        syntax_error();
+        return NULL;
+    }
+    while (IS_ALNUM(peek_char()) || peek_char() == '.') {
+        c = get_next_char();
+        if (p - name < NAMLEN) {
+            *p++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+        }
+    }
+    c = peek_char();
+    if (c == '$' || c == '%' || c == '!' || c == '#') {
+        *p++ = get_next_char();
+    }
+    *p = '\0';
+
+    skip_spaces();
+    if (peek_char() != '(') {
+        var = find_variable(name, 1);
+        if (var->type == TYPE_STR) {
+            error(ERR_TYPE_MISM);
+            return NULL;
+        }
+        return (void *)&var->value;
+    }
+    get_next_char();
+
+    arr = find_array(name, 0);
+    if (!arr || arr->type == TYPE_STR) {
+        error(arr ? ERR_TYPE_MISM : ERR_SUBSCRIPT);
+        return NULL;
+    }
+
+    /* A() - the whole array */
+    skip_spaces();
+    if (peek_char() == ')') {
+        get_next_char();
+        if (arr->ndims == 0) {
+            error(ERR_SUBSCRIPT);
+            return NULL;
+        }
+        return (void *)arr->data;
+    }
+
+    /* A(i, ...) - one element */
+    nindices = 0;
+    while (nindices < 8) {
+        indices[nindices++] = eval_integer();
+        skip_spaces();
+        if (peek_char() != ',') {
+            break;
+        }
+        get_next_char();
+    }
+    skip_spaces();
+    if (peek_char() != ')') {
+        syntax_error();
+        return NULL;
+    }
+    get_next_char();
+    return (void *)array_element(name, indices, nindices);
+}
+
+/*
+ * Call a function returning an integer class value
+ */
+static long
+call_long(fn, key, lv, dv)
+void *fn;
+int key;
+long *lv;
+double *dv;
+{
+    switch (key) {
+        case 0x00: return ((long (*)(void))fn)();
+        case 0x10: return ((long (*)(long))fn)(lv[0]);
+        case 0x11: return ((long (*)(double))fn)(dv[0]);
+        case 0x20: return ((long (*)(long, long))fn)(lv[0], lv[1]);
+        case 0x21: return ((long (*)(double, long))fn)(dv[0], lv[1]);
+        case 0x22: return ((long (*)(long, double))fn)(lv[0], dv[1]);
+        case 0x23: return ((long (*)(double, double))fn)(dv[0], dv[1]);
+        case 0x30: return ((long (*)(long, long, long))fn)(lv[0], lv[1], lv[2]);
+        case 0x31: return ((long (*)(double, long, long))fn)(dv[0], lv[1], lv[2]);
+        case 0x32: return ((long (*)(long, double, long))fn)(lv[0], dv[1], lv[2]);
+        case 0x33: return ((long (*)(double, double, long))fn)(dv[0], dv[1], lv[2]);
+        case 0x34: return ((long (*)(long, long, double))fn)(lv[0], lv[1], dv[2]);
+        case 0x35: return ((long (*)(double, long, double))fn)(dv[0], lv[1], dv[2]);
+        case 0x36: return ((long (*)(long, double, double))fn)(lv[0], dv[1], dv[2]);
+        case 0x37: return ((long (*)(double, double, double))fn)(dv[0], dv[1], dv[2]);
+        case 0x40: return ((long (*)(long, long, long, long))fn)(lv[0], lv[1], lv[2], lv[3]);
+        case 0x41: return ((long (*)(double, long, long, long))fn)(dv[0], lv[1], lv[2], lv[3]);
+        case 0x42: return ((long (*)(long, double, long, long))fn)(lv[0], dv[1], lv[2], lv[3]);
+        case 0x43: return ((long (*)(double, double, long, long))fn)(dv[0], dv[1], lv[2], lv[3]);
+        case 0x44: return ((long (*)(long, long, double, long))fn)(lv[0], lv[1], dv[2], lv[3]);
+        case 0x45: return ((long (*)(double, long, double, long))fn)(dv[0], lv[1], dv[2], lv[3]);
+        case 0x46: return ((long (*)(long, double, double, long))fn)(lv[0], dv[1], dv[2], lv[3]);
+        case 0x47: return ((long (*)(double, double, double, long))fn)(dv[0], dv[1], dv[2], lv[3]);
+        case 0x48: return ((long (*)(long, long, long, double))fn)(lv[0], lv[1], lv[2], dv[3]);
+        case 0x49: return ((long (*)(double, long, long, double))fn)(dv[0], lv[1], lv[2], dv[3]);
+        case 0x4A: return ((long (*)(long, double, long, double))fn)(lv[0], dv[1], lv[2], dv[3]);
+        case 0x4B: return ((long (*)(double, double, long, double))fn)(dv[0], dv[1], lv[2], dv[3]);
+        case 0x4C: return ((long (*)(long, long, double, double))fn)(lv[0], lv[1], dv[2], dv[3]);
+        case 0x4D: return ((long (*)(double, long, double, double))fn)(dv[0], lv[1], dv[2], dv[3]);
+        case 0x4E: return ((long (*)(long, double, double, double))fn)(lv[0], dv[1], dv[2], dv[3]);
+        case 0x4F: return ((long (*)(double, double, double, double))fn)(dv[0], dv[1], dv[2], dv[3]);
+    }
+    return 0L;
+}
+
+/*
+ * Call a function returning a double
+ */
+static double
+call_double(fn, key, lv, dv)
+void *fn;
+int key;
+long *lv;
+double *dv;
+{
+    switch (key) {
+        case 0x00: return ((double (*)(void))fn)();
+        case 0x10: return ((double (*)(long))fn)(lv[0]);
+        case 0x11: return ((double (*)(double))fn)(dv[0]);
+        case 0x20: return ((double (*)(long, long))fn)(lv[0], lv[1]);
+        case 0x21: return ((double (*)(double, long))fn)(dv[0], lv[1]);
+        case 0x22: return ((double (*)(long, double))fn)(lv[0], dv[1]);
+        case 0x23: return ((double (*)(double, double))fn)(dv[0], dv[1]);
+        case 0x30: return ((double (*)(long, long, long))fn)(lv[0], lv[1], lv[2]);
+        case 0x31: return ((double (*)(double, long, long))fn)(dv[0], lv[1], lv[2]);
+        case 0x32: return ((double (*)(long, double, long))fn)(lv[0], dv[1], lv[2]);
+        case 0x33: return ((double (*)(double, double, long))fn)(dv[0], dv[1], lv[2]);
+        case 0x34: return ((double (*)(long, long, double))fn)(lv[0], lv[1], dv[2]);
+        case 0x35: return ((double (*)(double, long, double))fn)(dv[0], lv[1], dv[2]);
+        case 0x36: return ((double (*)(long, double, double))fn)(lv[0], dv[1], dv[2]);
+        case 0x37: return ((double (*)(double, double, double))fn)(dv[0], dv[1], dv[2]);
+        case 0x40: return ((double (*)(long, long, long, long))fn)(lv[0], lv[1], lv[2], lv[3]);
+        case 0x41: return ((double (*)(double, long, long, long))fn)(dv[0], lv[1], lv[2], lv[3]);
+        case 0x42: return ((double (*)(long, double, long, long))fn)(lv[0], dv[1], lv[2], lv[3]);
+        case 0x43: return ((double (*)(double, double, long, long))fn)(dv[0], dv[1], lv[2], lv[3]);
+        case 0x44: return ((double (*)(long, long, double, long))fn)(lv[0], lv[1], dv[2], lv[3]);
+        case 0x45: return ((double (*)(double, long, double, long))fn)(dv[0], lv[1], dv[2], lv[3]);
+        case 0x46: return ((double (*)(long, double, double, long))fn)(lv[0], dv[1], dv[2], lv[3]);
+        case 0x47: return ((double (*)(double, double, double, long))fn)(dv[0], dv[1], dv[2], lv[3]);
+        case 0x48: return ((double (*)(long, long, long, double))fn)(lv[0], lv[1], lv[2], dv[3]);
+        case 0x49: return ((double (*)(double, long, long, double))fn)(dv[0], lv[1], lv[2], dv[3]);
+        case 0x4A: return ((double (*)(long, double, long, double))fn)(lv[0], dv[1], lv[2], dv[3]);
+        case 0x4B: return ((double (*)(double, double, long, double))fn)(dv[0], dv[1], lv[2], dv[3]);
+        case 0x4C: return ((double (*)(long, long, double, double))fn)(lv[0], lv[1], dv[2], dv[3]);
+        case 0x4D: return ((double (*)(double, long, double, double))fn)(dv[0], lv[1], dv[2], dv[3]);
+        case 0x4E: return ((double (*)(long, double, double, double))fn)(lv[0], dv[1], dv[2], dv[3]);
+        case 0x4F: return ((double (*)(double, double, double, double))fn)(dv[0], dv[1], dv[2], dv[3]);
+    }
+    return 0.0;
+}
+
+/*
+ * USRn(args) - evaluate the arguments and call the native function
+ * The name has been read; the text pointer is at the argument list
+ */
+value_t
+usr_call(n, type)
+int n;
+int *type;
+{
+    struct usr_s *u;
+    long lv[USR_MAXARGS];
+    double dv[USR_MAXARGS];
+    string_t *temps[USR_MAXARGS];
+    value_t result;
+    int ntemps;
+    int i;
+
+    result.dblval = 0.0;
+    *type = TYPE_DBL;
+
+    if (!g_state->usrtab || !g_state->usrtab[n].handle) {
+        error(ERR_UNDEF_USER);
+        return result;
+    }
+    u = &g_state->usrtab[n];
+
+    /* Arguments, in the declared order */
+    ntemps = 0;
+    skip_spaces();
+    if (peek_char() == '(') {
+        get_next_char();
+        for (i = 0; i < u->nargs; i++) {
+            if (i > 0) {
+                skip_spaces();
+                if (peek_char() != ',') {
+                    break;
+                }
+                get_next_char();
+            }
+            switch (u->args[i]) {
+                case 'd':
+                    dv[i] = eval_numeric();
+                    break;
+                case 'i':
+                case 'l':
+                    lv[i] = (long)eval_numeric();
+                    break;
+                case 's':
+                    /* Pointer taken below - later arguments may move it */
+                    temps[ntemps++] = eval_string();
+                    break;
+                case 'p':
+                    lv[i] = (long)parse_reference();
+                    break;
+            }
+        }
+        skip_spaces();
+        if (i < u->nargs || peek_char() != ')') {
+            while (ntemps > 0) {
+                free_string(temps[--ntemps]);
+            }
+            syntax_error();
+            return result;
+        }
+        get_next_char();
+
+        /* String arguments, in order */
+        ntemps = 0;
+        for (i = 0; i < u->nargs; i++) {
+            if (u->args[i] == 's') {
+                lv[i] = (long)(temps[ntemps]->ptr ?
+                               temps[ntemps]->ptr : "");
+                ntemps++;
+            }
+        }
+    } else if (u->nargs > 0) {
+        syntax_error();
+        return result;
+    }
+
+    switch (u->ret) {
+        case 'd':
+            result.dblval = call_double(u->fn, u->key, lv, dv);
+            break;
+        case 'i':
+            result.dblval = (double)(int)call_long(u->fn, u->key, lv, dv);
+            break;
+        case 'l':
+            result.dblval = (double)call_long(u->fn, u->key, lv, dv);
+            break;
+        default:
+            call_long(u->fn, u->key, lv, dv);
+            break;
+    }
+
+    while (ntemps > 0) {
+        free_string(temps[--ntemps]);
+    }
+    return result;
+}
@@ -0,0 +1,481 @@
+/*
+ * parallel.c - PARALLEL FOR loops
+ *
+ * FOR I = a TO b [STEP s] PARALLEL [REDUCE v1, v2, ...]
+ *
+ * The iteration range is cut into contiguous chunks, one per thread.
+ * Each worker runs the loop body with its own copy of the interpreter
+ * state and a private copy of every scalar variable; arrays are shared.
+ * REDUCE variables start at zero in every worker and their results are
+ * added back into the program's variables when the loop ends.  Other
+ * scalar assignments made inside the body are discarded.  RND gives
+ * each worker a stream of its own, seeded from the program's, and the
+ * program's own stream moves on past the loop.
+ *
+ * Only bodies that are safe to run concurrently are split: numeric
+ * assignments, IF without line number jumps, nested FOR/NEXT and REM,
+ * with every array already DIMensioned.  Anything else (strings,
+ * PRINT, GOTO, GOSUB, ...) runs as an ordinary FOR loop.
+ *
+ * The number of threads comes from GWBASIC_THREADS, defaulting to the
+ * number of online processors.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(GW_THREADS)
+#include <pthread.h>
+#include <unistd.h>
+
+/* K&R C compatible character tests - ctype macros may fail on old systems */
+#define IS_ALPHA(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_ALNUM(c) (IS_ALPHA(c) || IS_DIGIT(c))
+
+#define MAX_THREADS 64
+
+/*
+ * Seed for stream n split off seed: the LCG in fn_rnd() gives streams
+ * that are just shifted copies of each other when started from nearby
+ * states, so the seed and n are mixed (32-bit finalizer) instead
+ */
+static unsigned long
+split_seed(seed, n)
+unsigned long seed;
+int n;
+{
+    unsigned long x;
+
+    x = (seed ^ ((unsigned long)n * 0x9E3779B9UL)) & 0xFFFFFFFFUL;
+    x ^= x >> 16;
+    x = (x * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    x ^= x >> 13;
+    x = (x * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    x ^= x >> 16;
+    return x & 0x7FFFFFFFUL;
+}
+
+/*
+ * Number of worker threads to use
+ */
+static int
+thread_count()
+{
+    char *env;
+    long n;
+
+    env = getenv("GWBASIC_THREADS");
+    if (env) {
+        n = atol(env);
+    } else {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    if (n > MAX_THREADS) {
+        n = MAX_THREADS;
+    }
+    return (int)n;
+}
+
+/*
+ * Check that the text after a THEN/ELSE is not a line number jump
+ */
+static int
+is_jump(t)
+unsigned char *t;
+{
+    while (*t == ' ' || *t == '\t') {
+        t++;
+    }
+    return IS_DIGIT(*t);
+}
+
+/*
+ * Scan the loop body from the current position to its matching NEXT
+ * Returns 1 if the body can safely run on several threads
+ */
+static int
+body_is_parallel()
+{
+    line_t *line;
+    unsigned char *t;
+    unsigned char *p;
+    char name[NAMLEN+1];
+    array_t *arr;
+    int depth;
+    int c;
+    int tok;
+    int i;
+
+    line = g_state->curline_ptr;
+    t = g_state->txtptr;
+    depth = 1;
+
+    while (1) {
+        c = *t & 0xFF;
+
+        /* End of line - continue with the next one */
+        if (c == '\0') {
+            p = ((unsigned char *)line) + line->len;
+            if (p[0] == 0 && p[1] == 0) {
+                return 0;  /* No matching NEXT */
+            }
+            line = (line_t *)p;
+            t = line->text;
+            continue;
+        }
+
+        /* Anything involving strings stays serial */
+        if (c == '"' || c == '$') {
+            return 0;
+        }
+
+        /* Two-byte tokens: operators and functions */
+        if (c == 0xFF) {
+            tok = (c << 8) | (t[1] & 0xFF);
+            t += 2;
+            if (tok == TOK_CHR || tok == TOK_STR || tok == TOK_LEFT ||
+                tok == TOK_RIGHT || tok == TOK_MID || tok == TOK_INSTR ||
+                tok == TOK_PARALLEL) {
+                return 0;
+            }
+            if (tok == TOK_THEN && is_jump(t)) {
+                return 0;
+            }
+            continue;
+        }
+
+        /* Statement tokens */
+        if (c & 0x80) {
+            t++;
+            switch (c) {
+                case TOK_LET:
+                case TOK_IF:
+                    break;
+                case TOK_ELSE:
+                    if (is_jump(t)) {
+                        return 0;
+                    }
+                    break;
+                case TOK_FOR:
+                    depth++;
+                    break;
+                case TOK_NEXT:
+                    if (--depth == 0) {
+                        return 1;
+                    }
+                    break;
+                case TOK_REM:
+                    while (*t) {
+                        t++;
+                    }
+                    break;
+                default:
+                    return 0;
+            }
+            continue;
+        }
+
+        /* Numbers (skip so exponents aren't taken for names) */
+        if (IS_DIGIT(c) || c == '.') {
+            while (IS_DIGIT(*t) || *t == '.' || *t == 'E' || *t == 'e' ||
+                   *t == 'D' || *t == 'd') {
+                if ((*t == 'E' || *t == 'e' || *t == 'D' || *t == 'd') &&
+                    (t[1] == '+' || t[1] == '-')) {
+                    t++;
+                }
+                t++;
+            }
+            continue;
+        }
+
+        /* Names - arrays must exist so workers never create one */
+        if (IS_ALPHA(c)) {
+            i = 0;
+            while (IS_ALNUM(*t) || *t == '.') {
+                if (i < NAMLEN) {
+                    name[i++] = *t;
+                }
+                t++;
+            }
+            if (*t == '%' || *t == '!' || *t == '#') {
+                t++;
+            }
+            name[i] = '\0';
+            p = t;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (*p == '(') {
+                arr = find_array(name, 0);
+                if (!arr || arr->ndims == 0) {
+                    return 0;
+                }
+            }
+            continue;
+        }
+
+        t++;
+    }
+}
+
+/*
+ * Copy the numeric scalar variables of the current state
+ */
+static var_t *
+clone_variables()
+{
+    var_t *var;
+    var_t *copy;
+    var_t *head;
+    var_t *tail;
+
+    head = NULL;
+    tail = NULL;
+    for (var = g_state->varlist; var != NULL; var = var->next) {
+        if (var->type == TYPE_STR) {
+            continue;
+        }
+        copy = (var_t *)malloc(sizeof(var_t));
+        if (!copy) {
+            break;
+        }
+        memcpy(copy, var, sizeof(var_t));
+        copy->next = NULL;
+        if (tail) {
+            tail->next = copy;
+        } else {
+            head = copy;
+        }
+        tail = copy;
+    }
+    return head;
+}
+
+/*
+ * Numeric value of a variable in the current state
+ */
+static double
+variable_value(name)
+const char *name;
+{
+    value_t val;
+    int type;
+
+    val = get_variable(name, &type);
+    switch (type) {
+        case TYPE_INT: return (double)val.intval;
+        case TYPE_SNG: return (double)val.sngval;
+        case TYPE_DBL: return val.dblval;
+    }
+    return 0.0;
+}
+
+/*
+ * Free a worker's variables and the worker, handing the string
+ * descriptors it took over to the parent
+ */
+static void
+release_worker(st, parent)
+state_t *st;
+state_t *parent;
+{
+    g_state = st;
+    clear_variables();
+    string_give(parent);
+    free(st);
+}
+
+/*
+ * Worker thread entry point
+ */
+static void *
+worker_main(arg)
+void *arg;
+{
+    g_state = (state_t *)arg;
+    continue_program();
+    return NULL;
+}
+
+/*
+ * Run a FOR loop with its iterations split across threads
+ * Called by do_for() after the FOR clause has been parsed; returns 0
+ * if the loop should run serially instead
+ */
+int
+parallel_for(varname, start, limit, step, reduce, nreduce)
+const char *varname;
+double start;
+double limit;
+double step;
+char reduce[][NAMLEN+1];
+int nreduce;
+{
+    state_t *parent;
+    state_t *workers[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    int started[MAX_THREADS];
+    forstack_t *fs;
+    value_t val;
+    double count;
+    double sum;
+    long lo;
+    long hi;
+    int nthreads;
+    int failed;
+    int i;
+    int k;
+
+    if (step == 0.0) {
+        return 0;
+    }
+
+    /* Iterations the serial loop would run (the body runs at least once) */
+    count = floor((limit - start) / step) + 1.0;
+    if (count < 1.0) {
+        count = 1.0;
+    }
+
+    nthreads = thread_count();
+    if ((double)nthreads > count) {
+        nthreads = (int)count;
+    }
+    if (nthreads < 2 || !body_is_parallel()) {
+        return 0;
+    }
+
+    parent = g_state;
+
+    /* One private interpreter state per chunk of iterations */
+    for (k = 0; k < nthreads; k++) {
+        lo = (long)(count * k / nthreads);
+        hi = (long)(count * (k + 1) / nthreads);
+
+        workers[k] = (state_t *)malloc(sizeof(state_t));
+        if (!workers[k]) {
+            while (--k >= 0) {
+                release_worker(workers[k], parent);
+            }
+            g_state = parent;
+            error(ERR_OUT_OF_MEM);
+            return 1;
+        }
+        memcpy(workers[k], parent, sizeof(state_t));
+        workers[k]->varlist = clone_variables();
+        workers[k]->lastvar = NULL;
+        workers[k]->jit = NULL;
+        workers[k]->profiling = parent->profiling & PROF_COVER;
+        workers[k]->prof = NULL;
+        workers[k]->regions = NULL;
+        workers[k]->strheap = 0;
+        workers[k]->strfree = NULL;
+        workers[k]->strslabs = NULL;
+        workers[k]->sched = 0;
+        workers[k]->tracing = 0;
+        workers[k]->rndseed = split_seed(parent->rndseed, k + 1);
+
+        /* The worker's own FOR entry covers iterations lo .. hi-1 */
+        fs = &workers[k]->forstack[workers[k]->forsp];
+        fs->linenum = parent->curlin;
+        fs->text = parent->txtptr;
+        strcpy(fs->varname, varname);
+        fs->limit = start + (double)(hi - 1) * step;
+        fs->step = step;
+        workers[k]->forsp++;
+        workers[k]->forstop = workers[k]->forsp;
+
+        g_state = workers[k];
+        val.dblval = start + (double)lo * step;
+        set_variable(varname, val, TYPE_DBL);
+        for (i = 0; i < nreduce; i++) {
+            val.dblval = 0.0;
+            set_variable(reduce[i], val, TYPE_DBL);
+        }
+        g_state = parent;
+    }
+
+    /* The program continues on a stream none of the workers used */
+    parent->rndseed = split_seed(parent->rndseed, 0);
+
+    /* Chunk 0 runs on this thread, the rest on new ones */
+    for (k = 1; k < nthreads; k++) {
+        started[k] = pthread_create(&threads[k], NULL, worker_main,
+                                    (void *)workers[k]) == 0;
+    }
+    worker_main((void *)workers[0]);
+    for (k = 1; k < nthreads; k++) {
+        if (started[k]) {
+            pthread_join(threads[k], NULL);
+        } else {
+            worker_main((void *)workers[k]);
+        }
+    }
+    g_state = parent;
+
+    /* A worker that didn't reach the end of its loop hit an error */
+    failed = 0;
+    for (k = 0; k < nthreads; k++) {
+        if (workers[k]->forsp >= workers[k]->forstop) {
+            failed = 1;
+        }
+    }
+
+    if (!failed) {
+        /* Fold reductions back into the program's variables */
+        for (i = 0; i < nreduce; i++) {
+            sum = variable_value(reduce[i]);
+            for (k = 0; k < nthreads; k++) {
+                g_state = workers[k];
+                sum += variable_value(reduce[i]);
+            }
+            g_state = parent;
+            val.dblval = sum;
+            set_variable(reduce[i], val, TYPE_DBL);
+        }
+
+        /* Loop variable keeps its last value, as after a serial loop */
+        val.dblval = start + (count - 1.0) * step;
+        set_variable(varname, val, TYPE_DBL);
+
+        /* Continue after the NEXT, where every worker stopped */
+        parent->curlin = workers[0]->curlin;
+        parent->txtptr = workers[0]->txtptr;
+        parent->curline_ptr = workers[0]->curline_ptr;
+    } else {
+        parent->running = 0;
+    }
+
+    for (k = 0; k < nthreads; k++) {
+        release_worker(workers[k], parent);
+    }
+    g_state = parent;
+    return 1;
+}
+
+#else
+
+/*
+ * No thread support - PARALLEL loops run serially
+ */
+int
+parallel_for(varname, start, limit, step, reduce, nreduce)
+const char *varname;
+double start;
+double limit;
+double step;
+char reduce[][NAMLEN+1];
+int nreduce;
+{
+    /* Arguments unused - suppress warnings */
+    if (varname || start || limit || step || reduce || nreduce) {
+        /* do nothing */
+    }
+    return 0;
+}
+
+#endif /* GW_THREADS */
@@ -16,9 +16,11 @@ int linenum;
     unsigned char *p;
     line_t *line;
 
+    STAT_INC(find_line);
     p = g_state->txttab;
     while (p[0] != 0 || p[1] != 0) {
         line = (line_t *)p;
+        STAT_INC(find_line_scanned);
         if (line->linenum == linenum) {
             return line;
         }
@@ -32,8 +34,9 @@ int linenum;
 
 /*
  * Insert or replace a program line
+ * Returns 0 on success, -1 if it doesn't fit below the string heap
  */
-void
+int
 insert_line(linenum, tokens, toklen)
 int linenum;
 unsigned char *tokens;
@@ -59,6 +62,9 @@ int toklen;
             /* Round up to even for PDP-11 word alignment */
             newlen = (newlen + 1) & ~1;
 
+            if (newlen > oldlen && !string_room((long)(newlen - oldlen))) {
+                return -1;
+            }
             if (newlen != oldlen) {
                 /* Need to move memory - use long for size calc */
                 movesize = (long)(g_state->vartab - p) - (long)oldlen;
@@ -71,12 +77,14 @@ int toklen;
                     memmove(p + newlen, p + oldlen, (size_t)movesize);
                     g_state->vartab -= (oldlen - newlen);
                 }
+                g_state->arytab = g_state->vartab;
+                g_state->strend = g_state->vartab;
             }
 
             /* Update line header */
             line->len = newlen;
             memcpy(line->text, tokens, toklen);
-            return;
+            return 0;
         }
         if (line->linenum > linenum) {
             insert_pos = p;
@@ -93,11 +101,16 @@ int toklen;
     newlen = sizeof(line_t) + toklen - 1;
     /* Round up to even for PDP-11 word alignment */
     newlen = (newlen + 1) & ~1;
+    if (!string_room((long)newlen)) {
+        return -1;
+    }
 
     /* Make room for new line - use long for size calc */
     movesize = (long)(g_state->vartab - insert_pos);
     memmove(insert_pos + newlen, insert_pos, (size_t)movesize);
     g_state->vartab += newlen;
+    g_state->arytab = g_state->vartab;
+    g_state->strend = g_state->vartab;
 
     /* Create new line */
     newline = (line_t *)insert_pos;
@@ -108,6 +121,7 @@ int toklen;
     /* Clear variables after modifying program */
     clear_variables();
     clear_arrays();
+    return 0;
 }
 
 /*
@@ -131,6 +145,8 @@ int linenum;
             movesize = (long)(g_state->vartab - (p + oldlen));
             memmove(p, p + oldlen, (size_t)movesize);
             g_state->vartab -= oldlen;
+            g_state->arytab = g_state->vartab;
+            g_state->strend = g_state->vartab;
 
             /* Clear variables after modifying program */
             clear_variables();
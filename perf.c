@@ -0,0 +1,278 @@
+/*
+ * perf.c - Symbols for Linux perf
+ *
+ * --perf makes Linux perf attribute samples to BASIC line numbers:
+ *
+ *   - JIT compiled code is announced line by line, as "BASIC line 120",
+ *     in /tmp/perf-<pid>.map, which perf report reads by itself, and in
+ *     the jitdump file /tmp/jit-<pid>.dump for perf inject --jit, which
+ *     keeps a copy of the code for perf annotate.
+ *
+ *   - Interpreted lines run through a small per-line trampoline, a
+ *     16-byte stub that sets up a frame and calls the interpreter.  Each
+ *     stub is announced the same way, as "BASIC line 120 (interpreted)",
+ *     so with call graphs (perf record -g) every sample in the
+ *     interpreter has the BASIC line it was executing on its stack.
+ *
+ *   perf record -g -k mono ./gwbasic --perf prog.bas
+ *   perf report --sort sym               (from the perf map)
+ *   perf inject --jit -i perf.data -o perf.jit.data   (jitdump)
+ *
+ * Stubs are named by line number only, so they stay valid when the
+ * program is edited and are never freed.  Linux on x86-64 only.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(PLATFORM_LINUX) && defined(__x86_64__)
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#define STUB_SIZE 16        /* Bytes per trampoline */
+#define STUB_PAGE 4096      /* Trampolines are made a page at a time */
+
+/* jitdump format (see tools/perf/util/jitdump.h in the kernel tree) */
+#define JITDUMP_MAGIC 0x4A695444UL
+#define JITDUMP_VERSION 1
+#define JIT_CODE_LOAD 0
+#define EM_X86_64 62
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int total_size;
+    unsigned int elf_mach;
+    unsigned int pad1;
+    unsigned int pid;
+    unsigned long timestamp;
+    unsigned long flags;
+} jd_header_t;
+
+typedef struct {
+    unsigned int id;
+    unsigned int total_size;
+    unsigned long timestamp;
+    unsigned int pid;
+    unsigned int tid;
+    unsigned long vma;
+    unsigned long code_addr;
+    unsigned long code_size;
+    unsigned long code_index;
+} jd_load_t;
+
+/* --perf: 1 while symbols are being written */
+int perf_on = 0;
+
+static FILE *mapfp;         /* /tmp/perf-<pid>.map */
+static FILE *dumpfp;        /* /tmp/jit-<pid>.dump, NULL if unavailable */
+static unsigned long codeindex;
+
+/* Trampolines by line number */
+static unsigned char *stubs[65536];
+static unsigned char *stubpage;
+static int stubused;
+
+/*
+ * jitdump timestamp - perf record -k mono uses the same clock
+ */
+static unsigned long
+timestamp()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000UL +
+           (unsigned long)ts.tv_nsec;
+}
+
+/*
+ * Announce size bytes of code at addr under a name
+ */
+void
+perf_code(addr, size, name)
+unsigned char *addr;
+unsigned long size;
+const char *name;
+{
+    jd_load_t rec;
+
+    if (!perf_on || size == 0) {
+        return;
+    }
+    fprintf(mapfp, "%lx %lx %s\n", (unsigned long)addr, size, name);
+    fflush(mapfp);
+
+    if (dumpfp) {
+        rec.id = JIT_CODE_LOAD;
+        rec.total_size = (unsigned int)(sizeof(rec) + strlen(name) + 1 +
+                                        size);
+        rec.timestamp = timestamp();
+        rec.pid = (unsigned int)getpid();
+        rec.tid = (unsigned int)syscall(SYS_gettid);
+        rec.vma = (unsigned long)addr;
+        rec.code_addr = (unsigned long)addr;
+        rec.code_size = size;
+        rec.code_index = codeindex++;
+        fwrite((char *)&rec, sizeof(rec), 1, dumpfp);
+        fwrite(name, 1, strlen(name) + 1, dumpfp);
+        fwrite((char *)addr, 1, (size_t)size, dumpfp);
+        fflush(dumpfp);
+    }
+}
+
+/*
+ * The trampoline of a line, made on first use
+ */
+static unsigned char *
+stub(linenum)
+int linenum;
+{
+    static unsigned char code[STUB_SIZE] = {
+        0x55,                   /* push rbp */
+        0x48, 0x89, 0xE5,       /* mov rbp, rsp */
+        0xFF, 0xD7,             /* call rdi */
+        0x5D,                   /* pop rbp */
+        0xC3,                   /* ret */
+        0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC
+    };
+    unsigned char *p;
+    char name[40];
+
+    linenum &= 0xFFFF;
+    if (stubs[linenum]) {
+        return stubs[linenum];
+    }
+    if (!stubpage || stubused + STUB_SIZE > STUB_PAGE) {
+        p = (unsigned char *)mmap(NULL, (size_t)STUB_PAGE,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANON, -1, (off_t)0);
+        if (p == (unsigned char *)MAP_FAILED) {
+            return NULL;
+        }
+        stubpage = p;
+        stubused = 0;
+    } else {
+        mprotect((void *)stubpage, (size_t)STUB_PAGE,
+                 PROT_READ | PROT_WRITE);
+    }
+    p = stubpage + stubused;
+    stubused += STUB_SIZE;
+    memcpy(p, code, sizeof(code));
+    mprotect((void *)stubpage, (size_t)STUB_PAGE, PROT_READ | PROT_EXEC);
+    stubs[linenum] = p;
+
+    sprintf(name, "BASIC line %d (interpreted)", linenum);
+    perf_code(p, (unsigned long)STUB_SIZE, name);
+    return p;
+}
+
+/*
+ * Run fn, the statements of the current line, through the line's
+ * trampoline; returns what fn returns
+ */
+int
+perf_line(fn)
+int (*fn)();
+{
+    int (*tramp)();
+    unsigned char *p;
+
+    p = stub(g_state->curlin);
+    if (!p) {
+        return (*fn)();
+    }
+    tramp = (int (*)())p;
+    return (*tramp)(fn);
+}
+
+/*
+ * Open the map and jitdump files
+ * Returns 0 on success, -1 if the map can't be written
+ */
+int
+perf_start()
+{
+    jd_header_t hdr;
+    char name[64];
+    void *map;
+    int fd;
+
+    sprintf(name, "/tmp/perf-%d.map", (int)getpid());
+    mapfp = fopen(name, "w");
+    if (!mapfp) {
+        return -1;
+    }
+    perf_on = 1;
+
+    /* perf finds the jitdump through an executable mapping of it */
+    sprintf(name, "/tmp/jit-%d.dump", (int)getpid());
+    fd = open(name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    map = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC,
+               MAP_PRIVATE, fd, (off_t)0);
+    dumpfp = fdopen(fd, "w");
+    if (map == MAP_FAILED || !dumpfp) {
+        if (dumpfp) {
+            fclose(dumpfp);
+            dumpfp = NULL;
+        } else {
+            close(fd);
+        }
+        return 0;
+    }
+
+    memset((char *)&hdr, 0, sizeof(hdr));
+    hdr.magic = (unsigned int)JITDUMP_MAGIC;
+    hdr.version = JITDUMP_VERSION;
+    hdr.total_size = sizeof(hdr);
+    hdr.elf_mach = EM_X86_64;
+    hdr.pid = (unsigned int)getpid();
+    hdr.timestamp = timestamp();
+    fwrite((char *)&hdr, sizeof(hdr), 1, dumpfp);
+    fflush(dumpfp);
+    return 0;
+}
+
+#else
+
+/*
+ * Not Linux on x86-64
+ */
+int perf_on = 0;
+
+int
+perf_start()
+{
+    fprintf(stderr, "perf symbols are only supported on x86-64 Linux\n");
+    return -1;
+}
+
+void
+perf_code(addr, size, name)
+unsigned char *addr;
+unsigned long size;
+const char *name;
+{
+    /* Arguments unused - suppress warnings */
+    if (addr && size && name) {
+        /* do nothing */
+    }
+}
+
+int
+perf_line(fn)
+int (*fn)();
+{
+    return (*fn)();
+}
+
+#endif
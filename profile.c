@@ -0,0 +1,395 @@
+/*
+ * profile.c - Per-line execution profiler
+ *
+ * With profiling on, continue_program() calls profile_line() every time
+ * it starts executing a line, or resumes one after a RETURN or NEXT.
+ * The time from one call to the next is charged to the line that was
+ * running, so each line collects the time spent in it, including any
+ * statements it calls (a GOSUB is charged to the subroutine's lines, a
+ * PARALLEL FOR to the FOR line).  Its count is the number of times it
+ * was entered at its start: coming back into the middle of it does not
+ * count again.  When the program ends, profile_report() lists
+ * the lines on stderr, most expensive first.
+ *
+ * Profiling is switched on for every program by --profile, or from a
+ * program with PROFILE ON and PROFILE OFF.  With it off, the only cost
+ * is one test of g_state->profiling per line, which sample.c also uses
+ * to have its ring buffer drained.
+ *
+ * Independently, a program can time named regions of its own with
+ * PROFILE START "name" and PROFILE STOP "name"; their totals are listed
+ * when it ends.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+/* Per-line totals */
+typedef struct {
+    line_t *line;       /* Line, NULL if the slot is free */
+    long count;         /* Times entered at its start */
+    double time;        /* Seconds spent in it */
+} prof_line_t;
+
+/* A named region (PROFILE START) */
+struct region_s {
+    struct region_s *next;
+    char *name;
+    long count;         /* Times stopped */
+    double total;       /* Seconds between START and STOP */
+    double min;
+    double max;
+    double started;     /* Time of START, or -1 if stopped */
+};
+
+struct prof_s {
+    prof_line_t *lines; /* Open addressing hash table */
+    int nlines;         /* Slots in use */
+    int cap;            /* Slots (a power of two) */
+    prof_line_t *cur;   /* Line running now, NULL if none */
+    double last;        /* When it started */
+};
+
+/* --profile: profile every program from its first line */
+int profile_all = 0;
+
+/*
+ * Find the totals of a line, adding them if create is set
+ */
+static prof_line_t *
+lookup(prof, line, create)
+struct prof_s *prof;
+line_t *line;
+int create;
+{
+    prof_line_t *old;
+    prof_line_t *e;
+    unsigned long h;
+    int oldcap;
+    int i;
+
+    /* Keep the table at most half full */
+    if (create && prof->nlines * 2 >= prof->cap) {
+        old = prof->lines;
+        oldcap = prof->cap;
+        prof->cap = oldcap ? oldcap * 2 : 256;
+        prof->lines = (prof_line_t *)calloc((size_t)prof->cap,
+                                            sizeof(prof_line_t));
+        if (!prof->lines) {
+            prof->lines = old;
+            prof->cap = oldcap;
+            return NULL;
+        }
+        prof->nlines = 0;
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].line) {
+                e = lookup(prof, old[i].line, 1);
+                *e = old[i];
+            }
+        }
+        if (old) {
+            free(old);
+        }
+    }
+
+    if (prof->cap == 0) {
+        return NULL;
+    }
+    h = ((unsigned long)line >> 2) * 2654435761UL;
+    i = (int)(h & (unsigned long)(prof->cap - 1));
+    while (prof->lines[i].line && prof->lines[i].line != line) {
+        i = (i + 1) & (prof->cap - 1);
+    }
+    e = &prof->lines[i];
+    if (!e->line) {
+        if (!create) {
+            return NULL;
+        }
+        e->line = line;
+        prof->nlines++;
+    }
+    return e;
+}
+
+/*
+ * Charge the time since the last line start to the running line
+ */
+static void
+charge(prof, now)
+struct prof_s *prof;
+double now;
+{
+    if (prof->cur) {
+        prof->cur->time += now - prof->last;
+    }
+    prof->last = now;
+}
+
+/*
+ * A line starts or resumes executing (txtptr not at its start)
+ */
+void
+profile_line(line)
+line_t *line;
+{
+    struct prof_s *prof;
+    double now;
+
+    /* The sampling profiler shares this hook */
+    if (g_state->profiling & PROF_DRAIN) {
+        g_state->profiling &= ~PROF_DRAIN;
+        sample_drain();
+    }
+    /* So does line coverage */
+    if (g_state->profiling & PROF_COVER) {
+        cover_line(line->linenum);
+    }
+    if (!(g_state->profiling & PROF_LINES)) {
+        return;
+    }
+
+    prof = g_state->prof;
+    if (!prof) {
+        prof = (struct prof_s *)calloc(1, sizeof(struct prof_s));
+        if (!prof) {
+            g_state->profiling &= ~PROF_LINES;
+            return;
+        }
+        g_state->prof = prof;
+    }
+
+    now = clock_mono();
+    charge(prof, now);
+    prof->cur = lookup(prof, line, 1);
+    if (prof->cur && g_state->txtptr == line->text) {
+        prof->cur->count++;
+    }
+}
+
+/*
+ * PROFILE ON
+ */
+void
+profile_start()
+{
+    g_state->profiling |= PROF_LINES;
+}
+
+/*
+ * PROFILE OFF - totals are kept for the report
+ */
+void
+profile_stop()
+{
+    if (g_state->prof) {
+        charge(g_state->prof, clock_mono());
+        g_state->prof->cur = NULL;
+    }
+    g_state->profiling &= ~PROF_LINES;
+}
+
+/*
+ * End a started region at time now
+ */
+static void
+region_stop(r, now)
+struct region_s *r;
+double now;
+{
+    double t;
+
+    t = now - r->started;
+    r->started = -1.0;
+    if (r->count == 0 || t < r->min) {
+        r->min = t;
+    }
+    if (t > r->max) {
+        r->max = t;
+    }
+    r->total += t;
+    r->count++;
+}
+
+/*
+ * PROFILE START name (start set) or PROFILE STOP name
+ * Returns 1 on success, 0 if the region is already started or was
+ * never started, -1 if out of memory
+ */
+int
+profile_region(name, start)
+const char *name;
+int start;
+{
+    struct region_s *r;
+    double now;
+
+    now = clock_mono();
+    for (r = g_state->regions; r; r = r->next) {
+        if (strcmp(r->name, name) == 0) {
+            break;
+        }
+    }
+    if (!r) {
+        if (!start) {
+            return 0;
+        }
+        r = (struct region_s *)calloc(1, sizeof(struct region_s));
+        if (!r || !(r->name = (char *)malloc(strlen(name) + 1))) {
+            if (r) {
+                free(r);
+            }
+            return -1;
+        }
+        strcpy(r->name, name);
+        r->started = -1.0;
+        r->next = g_state->regions;
+        g_state->regions = r;
+    }
+
+    if (start) {
+        if (r->started >= 0.0) {
+            return 0;
+        }
+        r->started = now;
+        return 1;
+    }
+    if (r->started < 0.0) {
+        return 0;
+    }
+    region_stop(r, now);
+    return 1;
+}
+
+/*
+ * List the named regions, in the order first started, and free them
+ */
+static void
+region_report()
+{
+    struct region_s *list;
+    struct region_s *r;
+    double now;
+
+    if (!g_state->regions || g_state->forstop > 0) {
+        return;
+    }
+
+    /* The list is newest first - reverse it */
+    list = NULL;
+    while ((r = g_state->regions) != NULL) {
+        g_state->regions = r->next;
+        r->next = list;
+        list = r;
+    }
+
+    now = clock_mono();
+    fflush(stdout);
+    fprintf(stderr, "\nRegions:\n");
+    fprintf(stderr, "%-20s %10s %12s %12s %12s %12s\n", "name", "count",
+            "seconds", "mean", "min", "max");
+    while ((r = list) != NULL) {
+        list = r->next;
+        /* Regions still open end here */
+        if (r->started >= 0.0) {
+            region_stop(r, now);
+        }
+        fprintf(stderr, "%-20.20s %10ld %12.6f %12.6f %12.6f %12.6f\n",
+                r->name, r->count, r->total, r->total / r->count,
+                r->min, r->max);
+        free(r->name);
+        free(r);
+    }
+}
+
+/*
+ * Order lines by time, then by count
+ */
+static int
+by_time(a, b)
+const void *a;
+const void *b;
+{
+    const prof_line_t *x;
+    const prof_line_t *y;
+
+    x = *(const prof_line_t **)a;
+    y = *(const prof_line_t **)b;
+    if (x->time != y->time) {
+        return x->time < y->time ? 1 : -1;
+    }
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return x->line->linenum - y->line->linenum;
+}
+
+/*
+ * Write the report for the program that just ended and start afresh
+ */
+void
+profile_report()
+{
+    struct prof_s *prof;
+    prof_line_t **order;
+    prof_line_t *e;
+    unsigned char *p;
+    line_t *line;
+    double total;
+    long starts;
+    char *text;
+    int n;
+    int i;
+
+    region_report();
+
+    prof = g_state->prof;
+    if (!prof) {
+        return;
+    }
+    g_state->prof = NULL;
+    charge(prof, clock_mono());
+
+    /* Only lines still in the program - the table may be stale */
+    order = (prof_line_t **)malloc((prof->nlines + 1) * sizeof(prof_line_t *));
+    n = 0;
+    total = 0.0;
+    starts = 0L;
+    p = g_state->txttab;
+    while (order && (p[0] != 0 || p[1] != 0)) {
+        line = (line_t *)p;
+        e = lookup(prof, line, 0);
+        if (e && e->count > 0) {
+            order[n++] = e;
+            total += e->time;
+            starts += e->count;
+        }
+        p += line->len;
+    }
+
+    if (n > 0) {
+        qsort((void *)order, (size_t)n, sizeof(prof_line_t *), by_time);
+        fprintf(stderr, "\nProfile: %.6f seconds, %ld line starts\n",
+                total, starts);
+        fprintf(stderr, "   line       count      seconds      %%  text\n");
+        for (i = 0; i < n; i++) {
+            e = order[i];
+            text = detokenize_line(e->line->text);
+            fprintf(stderr, "%7d %11ld %12.6f %6.2f  %s\n",
+                    e->line->linenum, e->count, e->time,
+                    total > 0.0 ? 100.0 * e->time / total : 0.0,
+                    text ? text : "");
+            if (text) {
+                free(text);
+            }
+        }
+    }
+
+    if (order) {
+        free(order);
+    }
+    if (prof->lines) {
+        free(prof->lines);
+    }
+    free(prof);
+}
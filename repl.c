@@ -158,7 +158,9 @@ repl()
                 /* Add or replace this line */
                 tokens = tokenize_line(text, &len);
                 if (tokens) {
-                    insert_line(linenum, tokens, len);
+                    if (insert_line(linenum, tokens, len) < 0) {
+                        printf("%s\n", error_message(ERR_OUT_OF_MEM));
+                    }
                     free(tokens);
                 }
             }
@@ -222,7 +224,13 @@ const char *filename;
             if (*text != '\0') {
                 tokens = tokenize_line(text, &len);
                 if (tokens) {
-                    insert_line(linenum, tokens, len);
+                    if (insert_line(linenum, tokens, len) < 0) {
+                        free(tokens);
+                        fclose(fp);
+                        printf("%s in %d\n", error_message(ERR_OUT_OF_MEM),
+                               linenum);
+                        return -1;
+                    }
                     free(tokens);
                 }
             }
@@ -230,6 +238,11 @@ const char *filename;
     }
 
     fclose(fp);
+
+    /* Coverage is reported against this file */
+    if (cover_on) {
+        cover_source(filename);
+    }
     return 0;
 }
 
@@ -0,0 +1,410 @@
+/*
+ * runtime.c - Runtime support for programs translated to C
+ *
+ * gwbasic --emit-c turns a BASIC program into one C function,
+ * basic_program(), which calls the routines here together with the
+ * interpreter's strings.c, functions.c, arrays.c and error.c.  This
+ * file provides main(), so it is linked into translated programs only,
+ * never into the interpreter itself.
+ *
+ * String expressions produce temporary strings that are collected
+ * here and freed by rt_release() once the statement that made them
+ * has finished.  GOSUB and FOR record a numbered continuation point;
+ * RETURN and NEXT hand that number back to the translated program,
+ * which jumps to it through a switch.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+/* Interpreter state - only the error trap and a few fields are used */
+GW_TLS state_t *g_state;
+
+#ifdef GW_STATS
+/* Counters of the interpreter's strings.c and arrays.c, never shown */
+stats_t gw_stats;
+#endif
+
+/* Array subscripts, one row per array reference in a statement */
+int rt_ix[RT_ROWS][8];
+
+/* Temporary strings of the current statement */
+static string_t **temps;
+static int ntemps;
+static int maxtemps;
+
+/* PRINT column, as tracked by do_print() */
+static int col;
+
+/* GOSUB continuation points */
+static int gosubstack[STACK_SIZE];
+static int gosubsp;
+
+/* FOR loops */
+typedef struct {
+    void *var;          /* Loop variable */
+    int type;           /* Its type */
+    double limit;       /* TO value */
+    double step;        /* STEP value */
+    int resume;         /* Continuation point after the FOR */
+} rt_for_t;
+
+static rt_for_t forstack[STACK_SIZE];
+static int forsp;
+
+/* Unread part of the last INPUT line */
+static char *inp;
+
+/*
+ * Register a temporary string, returns it
+ */
+string_t *
+rt_tmp(str)
+string_t *str;
+{
+    string_t **newtemps;
+
+    if (ntemps == maxtemps) {
+        maxtemps = maxtemps ? maxtemps * 2 : 16;
+        newtemps = (string_t **)realloc(temps, maxtemps * sizeof(string_t *));
+        if (!newtemps) {
+            error(ERR_OUT_OF_STR);
+            return str;
+        }
+        temps = newtemps;
+    }
+    temps[ntemps++] = str;
+    return str;
+}
+
+/*
+ * Temporary copy of a string literal
+ */
+string_t *
+rt_lit(s)
+const char *s;
+{
+    return rt_tmp(string_from_cstr(s));
+}
+
+/*
+ * Free the temporaries of the statement just finished
+ */
+void
+rt_release()
+{
+    while (ntemps > 0) {
+        free_string(temps[--ntemps]);
+    }
+}
+
+/*
+ * String assignment - the destination shares src (see strings.c)
+ */
+void
+rt_let(dest, src)
+string_t **dest;
+string_t *src;
+{
+    string_t *copy;
+
+    copy = copy_string(src);
+    if (*dest) {
+        free_string(*dest);
+    }
+    *dest = copy;
+}
+
+/*
+ * Division operators
+ */
+double
+rt_div(a, b)
+double a;
+double b;
+{
+    if (b == 0.0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a / b;
+}
+
+int
+rt_idiv(a, b)
+int a;
+int b;
+{
+    if (b == 0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a / b;
+}
+
+int
+rt_mod(a, b)
+int a;
+int b;
+{
+    if (b == 0) {
+        error(ERR_DIV_ZERO);
+    }
+    return a % b;
+}
+
+/*
+ * PRINT items - output and column counting match do_print()
+ */
+void
+rt_print_begin()
+{
+    col = 0;
+}
+
+void
+rt_print_int(n)
+int n;
+{
+    printf("%d", n);
+    col += 6;
+}
+
+void
+rt_print_num(x, width)
+double x;
+int width;
+{
+    printf("%g", x);
+    col += width;
+}
+
+void
+rt_print_str(s)
+string_t *s;
+{
+    if (s && s->ptr) {
+        printf("%.*s", s->len, s->ptr);
+        col += s->len;
+    }
+}
+
+void
+rt_print_comma()
+{
+    col = (col / 14 + 1) * 14;
+}
+
+void
+rt_print_tab(n)
+int n;
+{
+    while (col < n) {
+        putchar(' ');
+        col++;
+    }
+}
+
+/*
+ * GOSUB - remember where to come back to
+ */
+void
+rt_gosub(resume)
+int resume;
+{
+    if (gosubsp >= STACK_SIZE) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    gosubstack[gosubsp++] = resume;
+}
+
+/*
+ * RETURN - continuation point of the matching GOSUB
+ */
+int
+rt_return()
+{
+    if (gosubsp == 0) {
+        error(ERR_RETURN);
+        return 0;
+    }
+    return gosubstack[--gosubsp];
+}
+
+/*
+ * FOR - the loop variable has already been set to its start value
+ */
+void
+rt_for(var, type, limit, step, resume)
+void *var;
+int type;
+double limit;
+double step;
+int resume;
+{
+    if (forsp >= STACK_SIZE) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    forstack[forsp].var = var;
+    forstack[forsp].type = type;
+    forstack[forsp].limit = limit;
+    forstack[forsp].step = step;
+    forstack[forsp].resume = resume;
+    forsp++;
+}
+
+/*
+ * NEXT - step the loop variable (the innermost loop's if var is NULL)
+ * Returns the continuation point to jump back to, or 0 when finished
+ */
+int
+rt_next(var, type)
+void *var;
+int type;
+{
+    rt_for_t *fs;
+    double current;
+
+    if (forsp == 0) {
+        error(ERR_NEXT_NO_FOR);
+        return 0;
+    }
+    fs = &forstack[forsp - 1];
+    if (!var) {
+        var = fs->var;
+        type = fs->type;
+    }
+
+    switch (type) {
+        case TYPE_INT: current = (double)*(int *)var; break;
+        case TYPE_DBL: current = *(double *)var; break;
+        default: current = (double)*(float *)var; break;
+    }
+    current += fs->step;
+
+    if (fs->step >= 0 ? current > fs->limit : current < fs->limit) {
+        forsp--;
+        return 0;
+    }
+
+    switch (type) {
+        case TYPE_INT: *(int *)var = (int)current; break;
+        case TYPE_DBL: *(double *)var = current; break;
+        default: *(float *)var = (float)current; break;
+    }
+    return fs->resume;
+}
+
+/*
+ * INPUT - show the prompt and read a line
+ * Returns 0 at end of file, when no variables are assigned
+ */
+int
+rt_input(prompt)
+const char *prompt;
+{
+    printf("%s", prompt ? prompt : "? ");
+    fflush(stdout);
+    if (fgets(g_state->inputbuf, BUFLEN, stdin) == NULL) {
+        return 0;
+    }
+    inp = g_state->inputbuf;
+    return 1;
+}
+
+/*
+ * Check whether the input line has anything left for another variable
+ */
+int
+rt_input_more()
+{
+    return *inp != '\0';
+}
+
+/*
+ * Next comma separated number from the input line
+ */
+double
+rt_input_num()
+{
+    double val;
+
+    while (*inp == ' ' || *inp == '\t') {
+        inp++;
+    }
+    val = atof(inp);
+    while (*inp && *inp != ',' && *inp != '\n') {
+        inp++;
+    }
+    if (*inp == ',') {
+        inp++;
+    }
+    return val;
+}
+
+/*
+ * Next comma separated string from the input line
+ */
+string_t *
+rt_input_str()
+{
+    string_t *str;
+    char *p;
+    int c;
+
+    while (*inp == ' ' || *inp == '\t') {
+        inp++;
+    }
+    p = inp;
+    while (*p && *p != ',' && *p != '\n') {
+        p++;
+    }
+    c = *p;
+    *p = '\0';
+    str = string_from_cstr(inp);
+    inp = c ? p + 1 : p;
+    return rt_tmp(str);
+}
+
+/*
+ * Translated programs have no JIT; arrays.c still discards its code
+ */
+void
+jit_release()
+{
+}
+
+/*
+ * Run the translated program
+ */
+int
+main(argc, argv)
+int argc;
+char **argv;
+{
+    /* Arguments unused - suppress warnings */
+    if (argc || argv) {
+        /* do nothing */
+    }
+
+    g_state = (state_t *)calloc(1, sizeof(state_t));
+    if (!g_state) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    g_state->rndseed = 1;
+    g_state->waitfd = -1;
+
+    if (setjmp(g_state->errtrap) != 0) {
+        printf("%s in %d\n", error_message(g_state->errnum),
+               g_state->errlin);
+        return 1;
+    }
+
+    basic_program();
+    rt_release();
+    string_release();
+    free(g_state);
+    return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * sample.c - Statistical profiler driven by SIGPROF
+ *
+ * --sample FILE starts an ITIMER_PROF interval timer.  Each SIGPROF
+ * records the line being executed together with the lines of the
+ * active GOSUBs into a ring buffer.  The handler takes no locks and
+ * allocates nothing: it claims a slot by bumping the head index and
+ * marks it ready once written.  The interpreter drains the ring at the
+ * next line start after it gets half full (the handler asks for that by
+ * setting PROF_DRAIN in g_state->profiling), adding each sample to a
+ * table of distinct stacks.  At exit the table is written to FILE in
+ * folded-stack format, one line per stack:
+ *
+ *   40;100;210 37
+ *
+ * meaning 37 samples in line 210, reached by a GOSUB in line 100 that
+ * was itself called from line 40.  flamegraph.pl and similar tools
+ * render this directly.
+ *
+ * Only CPU time is sampled, so time spent waiting in INPUT or SLEEP
+ * does not show up.  The JIT is off while sampling (sample_on), as it
+ * is for --trace and --profile: a loop running as machine code never
+ * reaches a line start, so the ring would overflow and drop samples.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(__211BSD__) || defined(pdp11) || !defined(__STDC__)
+#include <sys/types.h>
+#endif
+#include <sys/time.h>
+#include <signal.h>
+
+#ifdef SIGPROF
+
+#define SAMPLE_USEC 1000L   /* Sampling interval (CPU time) */
+#define SAMPLE_DEPTH 16     /* Innermost GOSUB levels kept per sample */
+#if IS_16BIT
+#define RING_SIZE 256       /* Samples between drains */
+#else
+#define RING_SIZE 65536
+#endif
+
+/* One sample: lines[0] is the outermost caller, lines[depth-1] curlin */
+typedef struct {
+    volatile int ready;     /* Written and not yet drained */
+    int depth;
+    int lines[SAMPLE_DEPTH];
+} sample_t;
+
+/* Distinct stack and how often it was seen */
+typedef struct {
+    int depth;              /* 0 if the slot is free */
+    int lines[SAMPLE_DEPTH];
+    long count;
+} folded_t;
+
+static sample_t *ring;
+static volatile unsigned long head;     /* Next slot to claim */
+static volatile unsigned long tail;     /* Next slot to drain */
+static volatile unsigned long dropped;  /* Samples lost to a full ring */
+
+static folded_t *stacks;    /* Open addressing hash table */
+static int nstacks;
+static int capstacks;
+static long nsamples;
+
+static char *outname;       /* Folded output file */
+
+/* --sample: the SIGPROF timer is running (jit.c stays off) */
+int sample_on = 0;
+
+/*
+ * SIGPROF handler - async-signal-safe, g_state is the interrupted
+ * thread's interpreter
+ */
+static void
+on_sigprof(sig)
+int sig;
+{
+    state_t *st;
+    sample_t *s;
+    unsigned long i;
+    int first;
+    int k;
+
+    /* Signal number unused - suppress warnings */
+    if (sig) {
+        /* do nothing */
+    }
+
+    st = g_state;
+    if (!st || !st->running || st->curlin < 0) {
+        return;
+    }
+    if (head - tail >= (unsigned long)RING_SIZE) {
+        dropped++;
+        return;
+    }
+
+#if defined(__GNUC__)
+    i = __sync_fetch_and_add(&head, 1UL);
+#else
+    i = head++;
+#endif
+    /* Another thread may race us to the last free slot - rare enough
+     * that overwriting its sample is acceptable */
+    s = &ring[i % (unsigned long)RING_SIZE];
+
+    first = st->gosubsp - (SAMPLE_DEPTH - 1);
+    if (first < 0) {
+        first = 0;
+    }
+    s->depth = 0;
+    for (k = first; k < st->gosubsp; k++) {
+        s->lines[s->depth++] = st->gosubstack[k].linenum;
+    }
+    s->lines[s->depth++] = st->curlin;
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    s->ready = 1;
+
+    /* Only the main interpreter drains - PARALLEL FOR workers don't */
+    if (head - tail >= (unsigned long)(RING_SIZE / 2) && st->forstop == 0) {
+        st->profiling |= PROF_DRAIN;
+    }
+}
+
+/*
+ * Count a stack in the table
+ */
+static void
+add_stack(s)
+sample_t *s;
+{
+    folded_t *old;
+    folded_t *e;
+    unsigned long h;
+    int oldcap;
+    int i;
+    int k;
+
+    if (nstacks * 2 >= capstacks) {
+        old = stacks;
+        oldcap = capstacks;
+        capstacks = oldcap ? oldcap * 2 : 256;
+        stacks = (folded_t *)calloc((size_t)capstacks, sizeof(folded_t));
+        if (!stacks) {
+            stacks = old;
+            capstacks = oldcap;
+            dropped++;
+            return;
+        }
+        nstacks = 0;
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].depth > 0) {
+                h = 0;
+                for (k = 0; k < old[i].depth; k++) {
+                    h = h * 31UL + (unsigned long)old[i].lines[k];
+                }
+                k = (int)(h & (unsigned long)(capstacks - 1));
+                while (stacks[k].depth > 0) {
+                    k = (k + 1) & (capstacks - 1);
+                }
+                stacks[k] = old[i];
+                nstacks++;
+            }
+        }
+        if (old) {
+            free(old);
+        }
+    }
+
+    h = 0;
+    for (k = 0; k < s->depth; k++) {
+        h = h * 31UL + (unsigned long)s->lines[k];
+    }
+    i = (int)(h & (unsigned long)(capstacks - 1));
+    while ((e = &stacks[i])->depth > 0) {
+        if (e->depth == s->depth &&
+            memcmp(e->lines, s->lines, s->depth * sizeof(int)) == 0) {
+            break;
+        }
+        i = (i + 1) & (capstacks - 1);
+    }
+    if (e->depth == 0) {
+        e->depth = s->depth;
+        memcpy(e->lines, s->lines, s->depth * sizeof(int));
+        nstacks++;
+    }
+    e->count++;
+    nsamples++;
+}
+
+/*
+ * Move the samples taken so far from the ring into the table
+ */
+void
+sample_drain()
+{
+    sample_t *s;
+
+    if (!ring) {
+        return;
+    }
+    while (tail != head) {
+        s = &ring[tail % (unsigned long)RING_SIZE];
+        if (!s->ready) {
+            /* Claimed but still being written */
+            break;
+        }
+#if defined(__GNUC__)
+        __sync_synchronize();
+#endif
+        add_stack(s);
+        s->ready = 0;
+        tail++;
+    }
+}
+
+/*
+ * Stop sampling and write the folded stacks (run by atexit)
+ */
+static void
+sample_finish()
+{
+    struct itimerval it;
+    FILE *fp;
+    int i;
+    int k;
+
+    memset((char *)&it, 0, sizeof(it));
+    setitimer(ITIMER_PROF, &it, (struct itimerval *)0);
+    signal(SIGPROF, SIG_IGN);
+    sample_drain();
+
+    fp = fopen(outname, "w");
+    if (!fp) {
+        fprintf(stderr, "Cannot write %s\n", outname);
+        return;
+    }
+    for (i = 0; i < capstacks; i++) {
+        if (stacks[i].depth == 0) {
+            continue;
+        }
+        for (k = 0; k < stacks[i].depth; k++) {
+            fprintf(fp, k ? ";%d" : "%d", stacks[i].lines[k]);
+        }
+        fprintf(fp, " %ld\n", stacks[i].count);
+    }
+    fclose(fp);
+
+    fprintf(stderr, "%ld samples written to %s", nsamples, outname);
+    if (dropped > 0) {
+        fprintf(stderr, " (%lu dropped)", (unsigned long)dropped);
+    }
+    fprintf(stderr, "\n");
+}
+
+/*
+ * Start sampling; the folded stacks go to name when the process exits
+ * Returns 0 on success, -1 if sampling can't be set up
+ */
+int
+sample_start(name)
+const char *name;
+{
+    struct itimerval it;
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    struct sigaction sa;
+#endif
+
+    ring = (sample_t *)calloc((size_t)RING_SIZE, sizeof(sample_t));
+    outname = (char *)malloc(strlen(name) + 1);
+    if (!ring || !outname) {
+        return -1;
+    }
+    strcpy(outname, name);
+    atexit(sample_finish);
+
+    /* Restart interrupted reads so INPUT is not disturbed */
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    memset((char *)&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigprof;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &sa, (struct sigaction *)0);
+#else
+    signal(SIGPROF, on_sigprof);
+#endif
+
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = SAMPLE_USEC;
+    it.it_value = it.it_interval;
+    if (setitimer(ITIMER_PROF, &it, (struct itimerval *)0) != 0) {
+        return -1;
+    }
+    sample_on = 1;
+    return 0;
+}
+
+#else
+
+/*
+ * No SIGPROF on this system
+ */
+int sample_on = 0;
+
+int
+sample_start(name)
+const char *name;
+{
+    fprintf(stderr, "Sampling is not supported: %s not written\n", name);
+    return -1;
+}
+
+void
+sample_drain()
+{
+}
+
+#endif /* SIGPROF */
@@ -0,0 +1,367 @@
+/*
+ * sched.c - Cooperative scheduler for running many programs at once
+ *
+ * Every job is a complete interpreter instance (its own state_t).
+ * Jobs run on a single thread and give up the CPU when they SLEEP,
+ * when INPUT would block, or when their statement time slice runs
+ * out.  Sleeping jobs wait in a timer heap ordered by wake time and
+ * jobs blocked on input wait in poll(), so idle jobs cost nothing.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(__211BSD__) || defined(pdp11) || !defined(__STDC__)
+/* 2.11 BSD - no poll(), use select() */
+#include <sys/types.h>
+#include <sys/time.h>
+extern int select();
+#define USE_SELECT 1
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define SCHED_SLICE 1000  /* Statements per time slice */
+
+/* Job table entry */
+typedef struct {
+    state_t *state;     /* Interpreter instance */
+    const char *name;   /* Program file */
+} job_t;
+
+static job_t *jobs;     /* All jobs */
+static int njobs;
+
+static int *runq;       /* Circular queue of runnable jobs */
+static int runhead;
+static int runcount;
+
+static int *timers;     /* Min-heap of sleeping jobs by wake time */
+static int ntimers;
+
+static int *waiters;    /* Jobs blocked on a descriptor */
+static int nwaiters;
+
+/*
+ * Add job to the run queue
+ */
+static void
+make_runnable(j)
+int j;
+{
+    runq[(runhead + runcount) % njobs] = j;
+    runcount++;
+}
+
+/*
+ * Wake time of the job at heap position i
+ */
+static double
+timer_key(i)
+int i;
+{
+    return jobs[timers[i]].state->wakeup;
+}
+
+/*
+ * Push a sleeping job onto the timer heap
+ */
+static void
+timer_push(j)
+int j;
+{
+    int i;
+    int parent;
+    int tmp;
+
+    i = ntimers++;
+    timers[i] = j;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (timer_key(parent) <= timer_key(i)) {
+            break;
+        }
+        tmp = timers[parent];
+        timers[parent] = timers[i];
+        timers[i] = tmp;
+        i = parent;
+    }
+}
+
+/*
+ * Remove the job with the earliest wake time
+ */
+static int
+timer_pop()
+{
+    int top;
+    int i;
+    int child;
+    int tmp;
+
+    top = timers[0];
+    timers[0] = timers[--ntimers];
+    i = 0;
+    while (1) {
+        child = 2 * i + 1;
+        if (child >= ntimers) {
+            break;
+        }
+        if (child + 1 < ntimers && timer_key(child + 1) < timer_key(child)) {
+            child++;
+        }
+        if (timer_key(i) <= timer_key(child)) {
+            break;
+        }
+        tmp = timers[child];
+        timers[child] = timers[i];
+        timers[i] = tmp;
+        i = child;
+    }
+    return top;
+}
+
+/*
+ * Wait until a blocked descriptor is ready or timeout expires
+ * timeout < 0 waits forever; marks ready waiters with waitfd = -1
+ */
+static void
+wait_events(timeout)
+double timeout;
+{
+    int i;
+#ifdef USE_SELECT
+    fd_set rfds;
+    struct timeval tv;
+    int maxfd;
+
+    FD_ZERO(&rfds);
+    maxfd = -1;
+    for (i = 0; i < nwaiters; i++) {
+        FD_SET(jobs[waiters[i]].state->waitfd, &rfds);
+        if (jobs[waiters[i]].state->waitfd > maxfd) {
+            maxfd = jobs[waiters[i]].state->waitfd;
+        }
+    }
+    if (timeout >= 0.0) {
+        tv.tv_sec = (long)timeout;
+        tv.tv_usec = (long)((timeout - (double)tv.tv_sec) * 1.0e6);
+    }
+    if (select(maxfd + 1, &rfds, 0, 0, timeout >= 0.0 ? &tv : 0) <= 0) {
+        return;
+    }
+    for (i = 0; i < nwaiters; i++) {
+        if (FD_ISSET(jobs[waiters[i]].state->waitfd, &rfds)) {
+            jobs[waiters[i]].state->waitfd = -1;
+        }
+    }
+#else
+    struct pollfd *fds;
+    int ms;
+
+    fds = NULL;
+    if (nwaiters > 0) {
+        fds = (struct pollfd *)malloc(nwaiters * sizeof(struct pollfd));
+        if (!fds) {
+            return;
+        }
+    }
+    for (i = 0; i < nwaiters; i++) {
+        fds[i].fd = jobs[waiters[i]].state->waitfd;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+
+    /* Round up so a timer is never polled for just before it is due */
+    ms = timeout < 0.0 ? -1 : (int)(timeout * 1000.0 + 0.999);
+
+    if (poll(fds, (nfds_t)nwaiters, ms) > 0) {
+        for (i = 0; i < nwaiters; i++) {
+            if (fds[i].revents) {
+                jobs[waiters[i]].state->waitfd = -1;
+            }
+        }
+    }
+    if (fds) {
+        free(fds);
+    }
+#endif
+}
+
+/*
+ * Check whether a read on fd would not block
+ */
+int
+sched_readable(fd)
+int fd;
+{
+#ifdef USE_SELECT
+    fd_set rfds;
+    struct timeval tv;
+
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    return select(fd + 1, &rfds, 0, 0, &tv) > 0;
+#else
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) > 0;
+#endif
+}
+
+/*
+ * Create a job for a program file
+ * Returns 1 if added, 0 if there is nothing to run, -1 if it can't load
+ */
+static int
+add_job(name)
+const char *name;
+{
+    init_state();
+    if (load_file(name) != 0) {
+        fprintf(stderr, "Cannot load %s\n", name);
+        cleanup();
+        return -1;
+    }
+    g_state->sched = 1;
+    if (setjmp(g_state->errtrap) != 0 || !start_program(0)) {
+        cleanup();
+        return 0;
+    }
+    jobs[njobs].state = g_state;
+    jobs[njobs].name = name;
+    njobs++;
+    return 1;
+}
+
+/*
+ * Load every program as a job and run them all to completion
+ * Returns number of programs that could not be loaded
+ */
+int
+sched_run(files, nfiles)
+char **files;
+int nfiles;
+{
+    state_t *saved;
+    state_t *st;
+    int failed;
+    int alive;
+    int i;
+    int j;
+    int n;
+    double now;
+    double timeout;
+
+    saved = g_state;
+    failed = 0;
+
+    jobs = (job_t *)malloc(nfiles * sizeof(job_t));
+    runq = (int *)malloc(nfiles * sizeof(int));
+    timers = (int *)malloc(nfiles * sizeof(int));
+    waiters = (int *)malloc(nfiles * sizeof(int));
+    if (!jobs || !runq || !timers || !waiters) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    /* stdin must be unbuffered so poll() sees every pending byte */
+    setvbuf(stdin, (char *)NULL, _IONBF, 0);
+
+    /* Create one interpreter instance per program */
+    njobs = 0;
+    runhead = 0;
+    runcount = 0;
+    ntimers = 0;
+    nwaiters = 0;
+    for (i = 0; i < nfiles; i++) {
+        if (add_job(files[i]) < 0) {
+            failed++;
+        }
+    }
+    for (j = 0; j < njobs; j++) {
+        make_runnable(j);
+    }
+
+    alive = njobs;
+    while (alive > 0) {
+        /* Give every runnable job one time slice */
+        n = runcount;
+        while (n-- > 0) {
+            j = runq[runhead];
+            runhead = (runhead + 1) % njobs;
+            runcount--;
+
+            st = jobs[j].state;
+            g_state = st;
+            st->yield = 0;
+            st->slice = SCHED_SLICE;
+            continue_program();
+
+            if (!st->running) {
+                /* Job finished */
+                cleanup();
+                jobs[j].state = NULL;
+                alive--;
+            } else if (st->waitfd >= 0) {
+                waiters[nwaiters++] = j;
+            } else if (st->wakeup > 0.0) {
+                timer_push(j);
+            } else {
+                make_runnable(j);
+            }
+        }
+
+        if (alive == 0) {
+            break;
+        }
+
+        /* Sleep until the next timer unless something can run now */
+        now = clock_mono();
+        if (runcount > 0) {
+            timeout = 0.0;
+        } else if (ntimers > 0) {
+            timeout = timer_key(0) - now;
+            if (timeout < 0.0) {
+                timeout = 0.0;
+            }
+        } else {
+            timeout = -1.0;
+        }
+        if (nwaiters > 0 || timeout > 0.0) {
+            wait_events(timeout);
+        }
+
+        /* Wake jobs whose input arrived */
+        for (i = 0; i < nwaiters; ) {
+            if (jobs[waiters[i]].state->waitfd < 0) {
+                make_runnable(waiters[i]);
+                waiters[i] = waiters[--nwaiters];
+            } else {
+                i++;
+            }
+        }
+
+        /* Wake jobs whose sleep has expired */
+        now = clock_mono();
+        while (ntimers > 0 && timer_key(0) <= now) {
+            j = timer_pop();
+            jobs[j].state->wakeup = 0.0;
+            make_runnable(j);
+        }
+    }
+
+    free(jobs);
+    free(runq);
+    free(timers);
+    free(waiters);
+    g_state = saved;
+    return failed;
+}
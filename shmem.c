@@ -0,0 +1,298 @@
+/*
+ * shmem.c - Memory segments for PEEK, POKE and DEF SEG
+ *
+ * PEEK and POKE address the current segment.  By default that is a
+ * private block owned by the interpreter; DEF SEG = "name" maps the
+ * POSIX shared memory object /name instead (creating it if needed), so
+ * cooperating BASIC processes see each other's POKEs directly.
+ *
+ *   DEF SEG = "name"      select shared segment (SEG_SIZE bytes)
+ *   DEF SEG               back to the private segment
+ *   POKE a, v             store byte v at offset a
+ *   POKE a, s$            store the bytes of s$ starting at offset a
+ *   PEEK(a)               byte at offset a
+ *   PEEK$(a, n)           n bytes starting at offset a, as a string
+ *   ATOMADD(a, d)         add d to the 32-bit word at a, return new value
+ *   ATOMCAS(a, old, new)  store new at a if it holds old, return old value
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#define HAVE_SHM 1
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Segment size - offsets are 0 .. SEG_SIZE-1 */
+#if IS_16BIT
+#define SEG_SIZE 4096L
+#else
+#define SEG_SIZE 65536L
+#endif
+
+/*
+ * Unmap or free the current segment
+ */
+void
+mem_release()
+{
+    if (!g_state->segbase) {
+        return;
+    }
+#ifdef HAVE_SHM
+    if (g_state->segshared) {
+        munmap((void *)g_state->segbase, (size_t)SEG_SIZE);
+    } else {
+        free(g_state->segbase);
+    }
+#else
+    free(g_state->segbase);
+#endif
+    g_state->segbase = NULL;
+    g_state->segshared = 0;
+}
+
+#ifdef HAVE_SHM
+/*
+ * Wait for the process that created a shared object to size it: until
+ * then it is empty, and touching the mapping would raise SIGBUS.
+ * Returns 1 once it is SEG_SIZE bytes, 0 if that takes over a second.
+ */
+static int
+shm_wait(fd)
+int fd;
+{
+    struct stat st;
+    int tries;
+
+    for (tries = 0; tries < 100; tries++) {
+        if (fstat(fd, &st) != 0) {
+            return 0;
+        }
+        if (st.st_size >= (off_t)SEG_SIZE) {
+            return 1;
+        }
+        usleep(10000);
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Select a segment: a shared memory object by name, or the private
+ * segment if name is NULL or empty
+ */
+void
+mem_select(name)
+const char *name;
+{
+#ifdef HAVE_SHM
+    char path[NAMLEN+2];
+    int fd;
+    int created;
+    void *base;
+#endif
+
+    mem_release();
+
+    if (!name || !*name) {
+        return;  /* Private segment is allocated on first use */
+    }
+
+#ifdef HAVE_SHM
+    if (strlen(name) > NAMLEN || strchr(name, '/')) {
+        error(ERR_ILLEGAL_FUNC);
+        return;
+    }
+    path[0] = '/';
+    strcpy(path + 1, name);
+
+    /* Size the object only when we are the one creating it */
+    created = 1;
+    fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        created = 0;
+        fd = shm_open(path, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        error(ERR_FILE_NOTFND);
+        return;
+    }
+    if (created && ftruncate(fd, (off_t)SEG_SIZE) != 0) {
+        close(fd);
+        shm_unlink(path);
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    if (!created && !shm_wait(fd)) {
+        close(fd);
+        error(ERR_FILE_NOTFND);
+        return;
+    }
+
+    base = mmap(NULL, (size_t)SEG_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, (off_t)0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    g_state->segbase = (unsigned char *)base;
+    g_state->segshared = 1;
+#else
+    /* No shared memory on this system */
+    error(ERR_ILLEGAL_FUNC);
+#endif
+}
+
+/*
+ * Get pointer to count bytes at offset addr in the current segment
+ */
+static unsigned char *
+mem_addr(addr, count)
+long addr;
+long count;
+{
+    if (!g_state->segbase) {
+        g_state->segbase = (unsigned char *)calloc((size_t)SEG_SIZE, 1);
+        if (!g_state->segbase) {
+            error(ERR_OUT_OF_MEM);
+            return NULL;
+        }
+        g_state->segshared = 0;
+    }
+    if (addr < 0L || count < 0L || addr + count > SEG_SIZE) {
+        error(ERR_ILLEGAL_FUNC);
+        return NULL;
+    }
+    return g_state->segbase + addr;
+}
+
+/*
+ * Get pointer to an aligned 32-bit word for the atomic operations
+ */
+static int *
+mem_word(addr)
+long addr;
+{
+    if (addr % (long)sizeof(int) != 0L) {
+        error(ERR_ILLEGAL_FUNC);
+        return NULL;
+    }
+    return (int *)mem_addr(addr, (long)sizeof(int));
+}
+
+/*
+ * PEEK - read a byte
+ */
+int
+mem_peek(addr)
+long addr;
+{
+    return *mem_addr(addr, 1L);
+}
+
+/*
+ * POKE - write a byte
+ */
+void
+mem_poke(addr, value)
+long addr;
+int value;
+{
+    if (value < 0 || value > 255) {
+        error(ERR_ILLEGAL_FUNC);
+        return;
+    }
+    *mem_addr(addr, 1L) = (unsigned char)value;
+}
+
+/*
+ * PEEK$ - read a block of bytes as a string
+ */
+string_t *
+mem_peek_string(addr, count)
+long addr;
+int count;
+{
+    unsigned char *p;
+    string_t *str;
+
+    if (count > 255) {
+        error(ERR_ILLEGAL_FUNC);
+        return NULL;
+    }
+    p = mem_addr(addr, (long)count);
+    str = temp_string(count);
+    if (count > 0) {
+        memcpy(str->ptr, p, count);
+    }
+    return str;
+}
+
+/*
+ * POKE with a string - write a block of bytes
+ */
+void
+mem_poke_string(addr, str)
+long addr;
+string_t *str;
+{
+    unsigned char *p;
+
+    p = mem_addr(addr, (long)str->len);
+    if (str->len > 0) {
+        memcpy(p, str->ptr, str->len);
+    }
+}
+
+/*
+ * ATOMADD - atomically add to a word, returns the new value
+ */
+long
+mem_atomic_add(addr, delta)
+long addr;
+long delta;
+{
+    int *w;
+
+    w = mem_word(addr);
+#if defined(__GNUC__)
+    return (long)__sync_add_and_fetch(w, (int)delta);
+#else
+    *w += (int)delta;
+    return (long)*w;
+#endif
+}
+
+/*
+ * ATOMCAS - atomically replace a word if it holds the expected value
+ * Returns the value the word held before, so the swap happened if it
+ * equals oldval
+ */
+long
+mem_atomic_cas(addr, oldval, newval)
+long addr;
+long oldval;
+long newval;
+{
+    int *w;
+    int prev;
+
+    w = mem_word(addr);
+#if defined(__GNUC__)
+    prev = __sync_val_compare_and_swap(w, (int)oldval, (int)newval);
+#else
+    prev = *w;
+    if (prev == (int)oldval) {
+        *w = (int)newval;
+    }
+#endif
+    return (long)prev;
+}
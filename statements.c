@@ -139,10 +139,14 @@ do_input()
     int has_prompt;
     string_t *str;
     char *line;
+    unsigned char *stmt;
 
     has_prompt = 0;
     prompt[0] = '\0';
 
+    /* Remember the INPUT token so a scheduled job can restart it */
+    stmt = g_state->txtptr - 1;
+
     skip_spaces();
 
     /* Check for string literal prompt */
@@ -161,13 +165,25 @@ do_input()
         }
     }
 
-    /* Print prompt */
-    if (has_prompt) {
-        printf("%s", prompt);
-    } else {
-        printf("? ");
+    /* Print prompt (once, even if the job has to wait for input) */
+    if (g_state->inwait != stmt) {
+        if (has_prompt) {
+            printf("%s", prompt);
+        } else {
+            printf("? ");
+        }
+        fflush(stdout);
     }
-    fflush(stdout);
+
+    /* Scheduled job: don't block, wait for stdin then re-execute */
+    if (g_state->sched && !sched_readable(0)) {
+        g_state->inwait = stmt;
+        g_state->waitfd = 0;
+        g_state->txtptr = stmt;
+        g_state->yield = 1;
+        return;
+    }
+    g_state->inwait = NULL;
 
     /* Read input */
     if (fgets(g_state->inputbuf, BUFLEN, stdin) == NULL) {
@@ -254,6 +270,69 @@ do_input()
     }
 }
 
+/*
+ * A$ = A$ + expr appends to the variable's own string, in place if it
+ * has the room (see append_string)
+ * The text pointer is after the '='; returns 0, with it left there, if
+ * the assignment has some other form
+ */
+static int
+let_append(varname)
+char *varname;
+{
+    char name[NAMLEN+1];
+    unsigned char *saved;
+    char *p;
+    var_t *var;
+    value_t val;
+    int type;
+
+    p = varname + strlen(varname);
+    if (p == varname || p[-1] != '$') {
+        return 0;
+    }
+
+    saved = g_state->txtptr;
+    skip_spaces();
+    p = name;
+    while (IS_ALNUM(peek_char()) || peek_char() == '.' ||
+           peek_char() == '$' || peek_char() == '%' ||
+           peek_char() == '!' || peek_char() == '#') {
+        if (p - name < NAMLEN) {
+            *p++ = get_next_char();
+        } else {
+            get_next_char();
+        }
+    }
+    *p = '\0';
+    skip_spaces();
+    if (strcmp(name, varname) != 0) {
+        g_state->txtptr = saved;
+        return 0;
+    }
+    if (!match_token(TOK_PLUS)) {
+        if (peek_char() != '+') {
+            g_state->txtptr = saved;
+            return 0;
+        }
+        get_next_char();
+    }
+
+    val = eval_expr(&type);
+    if (type != TYPE_STR) {
+        error(ERR_TYPE_MISM);
+        return 1;
+    }
+    var = find_variable(varname, 1);
+    if (var) {
+        var->value.strval = append_string(var->value.strval, val.strval);
+    }
+    if (val.strval) {
+        free_string(val.strval);
+    }
+    return 1;
+}
+
 /*
  * LET statement (assignment)
  */
@@ -267,6 +346,8 @@ do_let()
     int indices[8];
     int nindices;
     value_t *elem;
+    array_t *arr;
+    double dval;
 
     /* Parse variable name (with length limit) */
     skip_spaces();
@@ -323,12 +404,36 @@ do_let()
         /* Assign to array element */
         elem = array_element(varname, indices, nindices);
         if (elem) {
-            /* Free old string in array element before overwriting */
-            if (type == TYPE_STR && elem->strval) {
-                free_string(elem->strval);
+            arr = find_array(varname, 0);
+            if (type == TYPE_STR || arr->type == TYPE_STR) {
+                if (type != arr->type) {
+                    if (type == TYPE_STR && val.strval) {
+                        free_string(val.strval);
+                    }
+                    error(ERR_TYPE_MISM);
+                }
+                /* Free old string in array element before overwriting */
+                if (elem->strval) {
+                    free_string(elem->strval);
+                }
+                /* A temporary gets a durable copy */
+                elem->strval = val.strval ? copy_string(val.strval) : NULL;
+                if (val.strval) {
+                    free_string(val.strval);
+                }
+            } else {
+                /* Store numbers in the array's element type */
+                switch (type) {
+                    case TYPE_INT: dval = (double)val.intval; break;
+                    case TYPE_SNG: dval = (double)val.sngval; break;
+                    default: dval = val.dblval; break;
+                }
+                switch (arr->type) {
+                    case TYPE_INT: elem->intval = (int)dval; break;
+                    case TYPE_DBL: elem->dblval = dval; break;
+                    default: elem->sngval = (float)dval; break;
+                }
             }
-            *elem = val;
-            /* Note: array now owns val.strval, don't free it */
         } else {
             /* array_element returned NULL (error) - free the string if needed */
             if (type == TYPE_STR && val.strval) {
@@ -349,6 +454,10 @@ do_let()
             syntax_error();
         }
 
+        if (let_append(varname)) {
+            return;
+        }
+
         /* Evaluate expression */
         val = eval_expr(&type);
 
@@ -449,6 +558,10 @@ do_if()
             }
 
             execute_statement();
+            if (g_state->yield) {
+                /* Job yielded - resume from here later */
+                return;
+            }
             skip_spaces();
 
             /* Check what's next */
@@ -501,6 +614,9 @@ do_if()
                 /* Execute ELSE part */
                 while (peek_char() != '\0' && g_state->running) {
                     execute_statement();
+                    if (g_state->yield) {
+                        return;
+                    }
                     skip_spaces();
                     if (peek_char() == ':') {
                         get_next_char();
@@ -577,6 +693,11 @@ do_gosub()
     g_state->curlin = target;
     g_state->txtptr = line->text;
     g_state->curline_ptr = line;  /* Update line pointer for fast advance */
+
+    /* Time the call with --calls (see calls.c) */
+    if (g_state->profiling & PROF_CALLS) {
+        calls_enter(target);
+    }
 }
 
 /*
@@ -597,6 +718,9 @@ do_return()
     g_state->gosubsp--;
     g_state->curlin = g_state->gosubstack[g_state->gosubsp].linenum;
     g_state->txtptr = g_state->gosubstack[g_state->gosubsp].text;
+    if (g_state->profiling & PROF_CALLS) {
+        calls_leave();
+    }
 
     /* Update line pointer for fast advance */
     line = find_line(g_state->curlin);
@@ -617,6 +741,9 @@ do_for()
     double limit;
     double step;
     value_t val;
+    char reduce[MAXREDUCE][NAMLEN+1];
+    int nreduce;
+    int parallel;
 
     /* Parse variable name (with length limit) */
     skip_spaces();
@@ -663,12 +790,56 @@ do_for()
         step = eval_numeric();
     }
 
+    /* Check for PARALLEL [REDUCE var, ...] */
+    parallel = 0;
+    nreduce = 0;
+    if (match_token(TOK_PARALLEL)) {
+        parallel = 1;
+        if (match_token(TOK_REDUCE)) {
+            for (;;) {
+                if (nreduce >= MAXREDUCE) {
+                    error(ERR_ILLEGAL_FUNC);
+                    return;
+                }
+                skip_spaces();
+                p = reduce[nreduce];
+                while (IS_ALNUM(peek_char()) || peek_char() == '.' ||
+                       peek_char() == '%' || peek_char() == '!' ||
+                       peek_char() == '#') {
+                    if (p - reduce[nreduce] < NAMLEN) {
+                        *p++ = get_next_char();
+                    } else {
+                        get_next_char();  /* Skip excess characters */
+                    }
+                }
+                *p = '\0';
+                if (reduce[nreduce][0] == '\0') {
+                    syntax_error();
+                }
+                nreduce++;
+
+                skip_spaces();
+                if (peek_char() == ',') {
+                    get_next_char();
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+
     /* Check stack space */
     if (g_state->forsp >= STACK_SIZE) {
         error(ERR_OUT_OF_MEM);
         return;
     }
 
+    /* Split the iterations across threads if the body allows it */
+    if (parallel && parallel_for(varname, start_val, limit, step,
+                                 reduce, nreduce)) {
+        return;
+    }
+
     /* Push FOR loop info */
     g_state->forstack[g_state->forsp].linenum = g_state->curlin;
     g_state->forstack[g_state->forsp].text = g_state->txtptr;
@@ -750,6 +921,11 @@ do_next()
     if (done) {
         /* Exit loop */
         g_state->forsp--;
+
+        /* A PARALLEL FOR worker stops when its own loop ends */
+        if (g_state->forsp < g_state->forstop) {
+            g_state->running = 0;
+        }
     } else {
         /* Continue loop */
         val.dblval = current;
@@ -1111,6 +1287,11 @@ do_save()
 void
 do_system()
 {
+    /* A scheduled job only ends itself, not the whole process */
+    if (g_state->sched) {
+        g_state->running = 0;
+        return;
+    }
     cleanup();
     exit(0);
 }
@@ -1140,6 +1321,13 @@ do_sleep()
         tenths = 1;
     }
 
+    /* Scheduled job: let other jobs run until the wake time */
+    if (g_state->sched) {
+        g_state->wakeup = clock_mono() + (double)tenths / 10.0;
+        g_state->yield = 1;
+        return;
+    }
+
 #if defined(__211BSD__) || defined(pdp11) || !defined(__STDC__)
     /* 2.11 BSD - use select() for delay */
     tv.tv_sec = tenths / 10;
@@ -1150,3 +1338,267 @@ do_sleep()
     usleep((unsigned int)tenths * 100000);
 #endif
 }
+
+/*
+ * DEF USRn = "library", "symbol", "signature"
+ * The three strings are all evaluated before any C copy is made, and
+ * the copies are freed before an error from usr_define() is raised
+ */
+static void
+def_usr(n)
+int n;
+{
+    string_t *parts[3];
+    char *cstr[3];
+    int err;
+    int i;
+
+    skip_spaces();
+    if (peek_char() == '=') {
+        get_next_char();
+    } else if (!match_token(TOK_EQ)) {
+        syntax_error();
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        if (i > 0) {
+            skip_spaces();
+            if (peek_char() != ',') {
+                while (--i >= 0) {
+                    free_string(parts[i]);
+                }
+                syntax_error();
+                return;
+            }
+            get_next_char();
+        }
+        parts[i] = eval_string();
+    }
+
+    err = 0;
+    for (i = 0; i < 3; i++) {
+        cstr[i] = string_to_cstr(parts[i]);
+        free_string(parts[i]);
+        if (!cstr[i]) {
+            err = ERR_OUT_OF_MEM;
+        }
+    }
+    if (!err) {
+        err = usr_define(n, cstr[0], cstr[1], cstr[2]);
+    }
+    for (i = 0; i < 3; i++) {
+        if (cstr[i]) {
+            free(cstr[i]);
+        }
+    }
+    if (err) {
+        error(err);
+    }
+}
+
+/*
+ * DEF statement - DEF SEG and DEF USR are supported
+ * DEF SEG = "name" selects a shared memory segment for PEEK/POKE,
+ * DEF SEG on its own returns to the private segment
+ */
+void
+do_def()
+{
+    char name[NAMLEN+1];
+    char *p;
+    char *cname;
+    value_t val;
+    int type;
+    int c;
+
+    /* Parse what is being defined - safe uppercase for old systems */
+    skip_spaces();
+    p = name;
+    while (IS_ALNUM(peek_char())) {
+        c = get_next_char();
+        if (p - name < NAMLEN) {
+            if (c >= 'a' && c <= 'z') {
+                c = c - 'a' + 'A';
+            }
+            *p++ = c;
+        }
+    }
+    *p = '\0';
+
+    if (usr_index(name) >= 0) {
+        def_usr(usr_index(name));
+        return;
+    }
+
+    if (strcmp(name, "SEG") != 0) {
+        syntax_error();
+        return;
+    }
+
+    skip_spaces();
+    if (peek_char() == '=' || match_token(TOK_EQ)) {
+        if (peek_char() == '=') {
+            get_next_char();
+        }
+        val = eval_expr(&type);
+        if (type == TYPE_STR) {
+            cname = string_to_cstr(val.strval);
+            free_string(val.strval);
+            if (!cname) {
+                error(ERR_OUT_OF_MEM);
+                return;
+            }
+            mem_select(cname);
+            free(cname);
+            return;
+        }
+        /* Numeric segment addresses all mean the private segment */
+    }
+    mem_select((char *)NULL);
+}
+
+/*
+ * CALL statement - CALL USRn(args), discarding the result
+ */
+void
+do_call()
+{
+    char name[NAMLEN+1];
+    char *p;
+    int c;
+    int type;
+
+    skip_spaces();
+    p = name;
+    while (IS_ALNUM(peek_char())) {
+        c = get_next_char();
+        if (p - name < NAMLEN) {
+            if (c >= 'a' && c <= 'z') {
+                c = c - 'a' + 'A';
+            }
+            *p++ = c;
+        }
+    }
+    *p = '\0';
+
+    if (usr_index(name) < 0) {
+        syntax_error();
+        return;
+    }
+    usr_call(usr_index(name), &type);
+}
+
+/*
+ * PROFILE statement - PROFILE ON, PROFILE OFF, or PROFILE START or
+ * PROFILE STOP followed by a region name
+ */
+void
+do_profile()
+{
+    string_t *str;
+    char word[6];
+    char *name;
+    char *p;
+    int start;
+    int ok;
+    int c;
+
+    if (match_token(TOK_ON)) {
+        profile_start();
+        return;
+    }
+
+    /* PROFILE STOP "name" - STOP is a keyword */
+    start = 0;
+    if (!match_token(TOK_STOP)) {
+        skip_spaces();
+        p = word;
+        while (IS_ALPHA(peek_char()) && p - word < 5) {
+            c = get_next_char();
+            *p++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+        }
+        *p = '\0';
+        if (strcmp(word, "OFF") == 0) {
+            profile_stop();
+            return;
+        }
+        if (strcmp(word, "START") != 0) {
+            syntax_error();
+            return;
+        }
+        start = 1;
+    }
+
+    /* PROFILE START "name" and PROFILE STOP "name" */
+    str = eval_string();
+    if (!str) {
+        return;
+    }
+    name = string_to_cstr(str);
+    free_string(str);
+    if (!name) {
+        error(ERR_OUT_OF_MEM);
+        return;
+    }
+    ok = profile_region(name, start);
+    free(name);
+    if (ok <= 0) {
+        error(ok < 0 ? ERR_OUT_OF_MEM : ERR_ILLEGAL_FUNC);
+    }
+}
+
+/*
+ * STATS statement - print the hot-path counters as JSON
+ */
+void
+do_stats()
+{
+    stats_dump(stdout);
+}
+
+/*
+ * MEMSTAT statement - print the memory census of variables and arrays
+ */
+void
+do_memstat()
+{
+    memstat_report(stdout);
+}
+
+/*
+ * POKE statement - POKE address, byte or POKE address, string
+ */
+void
+do_poke()
+{
+    long addr;
+    value_t val;
+    int type;
+
+    addr = (long)eval_numeric();
+
+    skip_spaces();
+    if (peek_char() != ',') {
+        syntax_error();
+        return;
+    }
+    get_next_char();
+
+    val = eval_expr(&type);
+    switch (type) {
+        case TYPE_INT:
+            mem_poke(addr, val.intval);
+            break;
+        case TYPE_SNG:
+            mem_poke(addr, (int)val.sngval);
+            break;
+        case TYPE_DBL:
+            mem_poke(addr, (int)val.dblval);
+            break;
+        case TYPE_STR:
+            mem_poke_string(addr, val.strval);
+            free_string(val.strval);
+            break;
+    }
+}
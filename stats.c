@@ -0,0 +1,280 @@
+/*
+ * stats.c - Hot-path counters
+ *
+ * Built with make STATS=1 (-DGW_STATS), the interpreter counts work on
+ * its hot paths with STAT_INC/STAT_ADD (see gwbasic.h): line lookups,
+ * variable lookups and cache hits, string allocation, array accesses,
+ * tokenizing and every statement executed.  Without GW_STATS the
+ * macros expand to nothing.
+ *
+ * The counters are written as one JSON object
+ *   - by the STATS statement, to standard output
+ *   - on SIGUSR1, to the --stats file or standard error
+ *   - at exit, to the --stats file ("-" for standard error)
+ *
+ * The JSON is formatted by hand into a static buffer and written with
+ * write(), so the SIGUSR1 handler can do it directly.  Counters are
+ * longs, updated atomically in threaded builds so that PARALLEL FOR
+ * workers count exactly (the handler may still see a snapshot taken
+ * mid-update).  Statements run as JIT compiled code are not counted.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#ifdef GW_STATS
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+stats_t gw_stats;
+
+static char *outname;           /* --stats file, NULL if none */
+static char jsonbuf[16384];     /* Formatted counters */
+
+/* Named counters, in output order */
+static struct {
+    const char *name;
+    long *count;
+} counters[] = {
+    {"find_line", &gw_stats.find_line},
+    {"find_line_scanned", &gw_stats.find_line_scanned},
+    {"find_variable", &gw_stats.find_variable},
+    {"lastvar_hits", &gw_stats.lastvar_hits},
+    {"alloc_string", &gw_stats.alloc_string},
+    {"alloc_string_bytes", &gw_stats.alloc_string_bytes},
+    {"free_string", &gw_stats.free_string},
+    {"free_string_bytes", &gw_stats.free_string_bytes},
+    {"string_collect", &gw_stats.string_collect},
+    {"temp_string", &gw_stats.temp_string},
+    {"array_element", &gw_stats.array_element},
+    {"tokenize_line", &gw_stats.tokenize_line},
+    {"tokenize_bytes", &gw_stats.tokenize_bytes},
+    {NULL, NULL}
+};
+
+/*
+ * Append a string to the buffer
+ */
+static char *
+put_str(p, end, s)
+char *p;
+char *end;
+const char *s;
+{
+    while (*s && p < end) {
+        *p++ = *s++;
+    }
+    return p;
+}
+
+/*
+ * Append a decimal number to the buffer
+ */
+static char *
+put_long(p, end, n)
+char *p;
+char *end;
+long n;
+{
+    char digits[24];
+    int k;
+
+    if (n < 0) {
+        p = put_str(p, end, "-");
+        n = -n;
+    }
+    k = 0;
+    do {
+        digits[k++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n > 0 && k < 23);
+    while (k > 0 && p < end) {
+        *p++ = digits[--k];
+    }
+    return p;
+}
+
+/*
+ * Format the counters as JSON, returns the length
+ * Uses nothing but the buffer, so it is safe in a signal handler
+ */
+static int
+format_json()
+{
+    char *p;
+    char *end;
+    const char *name;
+    int token;
+    int first;
+    int i;
+
+    p = jsonbuf;
+    end = jsonbuf + sizeof(jsonbuf) - 8;
+
+    p = put_str(p, end, "{");
+    for (i = 0; counters[i].name != NULL; i++) {
+        p = put_str(p, end, i ? ",\n \"" : "\"");
+        p = put_str(p, end, counters[i].name);
+        p = put_str(p, end, "\": ");
+        p = put_long(p, end, *counters[i].count);
+    }
+
+    /* Statements by keyword, slot 0 is an assignment without LET */
+    p = put_str(p, end, ",\n \"statements\": {");
+    first = 1;
+    for (i = 0; i < STAT_TOKENS; i++) {
+        if (gw_stats.statements[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            name = "LET (implied)";
+        } else {
+            token = i < 256 ? i : (0xFF00 | (i - 256));
+            name = token_name(token);
+        }
+        p = put_str(p, end, first ? "\"" : ", \"");
+        if (name) {
+            p = put_str(p, end, name);
+        } else {
+            p = put_str(p, end, "token ");
+            p = put_long(p, end, (long)i);
+        }
+        p = put_str(p, end, "\": ");
+        p = put_long(p, end, gw_stats.statements[i]);
+        first = 0;
+    }
+    p = put_str(p, end, "}}\n");
+    return (int)(p - jsonbuf);
+}
+
+/*
+ * Write the counters to a file descriptor
+ */
+static void
+write_json(fd)
+int fd;
+{
+    int n;
+    int done;
+    int k;
+
+    n = format_json();
+    done = 0;
+    while (done < n) {
+        k = (int)write(fd, jsonbuf + done, (size_t)(n - done));
+        if (k <= 0) {
+            break;
+        }
+        done += k;
+    }
+}
+
+/*
+ * Write the counters to the --stats file, or to standard error
+ */
+static void
+write_out()
+{
+    int fd;
+
+    if (!outname || strcmp(outname, "-") == 0) {
+        write_json(2);
+        return;
+    }
+    fd = open(outname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        write_json(fd);
+        close(fd);
+    }
+}
+
+/*
+ * SIGUSR1 handler
+ */
+static void
+on_sigusr1(sig)
+int sig;
+{
+    /* Signal number unused - suppress warnings */
+    if (sig) {
+        /* do nothing */
+    }
+    write_out();
+}
+
+/*
+ * Write the counters at exit
+ */
+static void
+stats_finish()
+{
+    fflush(stdout);
+    write_out();
+}
+
+/*
+ * Write the counters to a stdio stream (the STATS statement)
+ */
+void
+stats_dump(fp)
+FILE *fp;
+{
+    fflush(fp);
+    write_json(fileno(fp));
+}
+
+/*
+ * Install the SIGUSR1 handler; with a file name, also write the
+ * counters there when the process exits
+ */
+void
+stats_start(name)
+const char *name;
+{
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    struct sigaction sa;
+
+    memset((char *)&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigusr1;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, (struct sigaction *)0);
+#else
+    signal(SIGUSR1, on_sigusr1);
+#endif
+
+    if (name) {
+        outname = (char *)malloc(strlen(name) + 1);
+        if (outname) {
+            strcpy(outname, name);
+            atexit(stats_finish);
+        }
+    }
+}
+
+#else
+
+/*
+ * Counters compiled out - STATS prints an empty object
+ */
+void
+stats_dump(fp)
+FILE *fp;
+{
+    fprintf(fp, "{}\n");
+}
+
+void
+stats_start(name)
+const char *name;
+{
+    if (name) {
+        fprintf(stderr, "Counters not compiled in (make STATS=1): "
+                "%s not written\n", name);
+    }
+}
+
+#endif /* GW_STATS */
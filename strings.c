@@ -1,42 +1,281 @@
 /*
  * strings.c - String memory management
  *
+ * String data lives in the string heap, the top of program memory:
+ * blocks are taken downward from memsiz by moving fretop, the way
+ * GW-BASIC does, and the free space between strend and fretop is
+ * shared with the program text.  Each block ends in a header naming
+ * the descriptor that owns it:
+ *
+ *   fretop                                         memsiz
+ *     | data ... | owner,size | data ... | owner,size |
+ *
+ * Freeing a string only drops it from its descriptor (the newest block,
+ * at fretop, is popped at once).  When the heap runs into strend, or on
+ * FRE(""), string_collect() slides the blocks still owned up to memsiz
+ * and updates their descriptors.  Variables and array elements hold
+ * descriptors, which come from a pool and never move, so a collection
+ * can happen in any allocation; the only rule is not to keep a string's
+ * ptr in a local across one.
+ *
+ * If the heap is full even after a collection the data is malloc'ed,
+ * as it is for PARALLEL FOR workers and compiled programs (strheap 0).
+ *
+ * Strings are immutable once built, so copy_string() shares: reading a
+ * variable or assigning one only counts another holder in refs, and
+ * free_string() frees when the last one lets go.  The one change made
+ * in place is append_string(), for A$ = A$ + X$: only when refs is 1,
+ * and only into the room (cap) the string has beyond its length.
+ *
+ * Strings shorter than STR_INLINE are kept in the descriptor's own buf
+ * and take no space in the heap, and every empty string is the one
+ * static empty_string.  ptr is never NULL.
+ *
+ * While a program runs, the strings an expression builds on the way
+ * (literals, concatenations, LEFT$ and the like) are temporaries from
+ * temp_string(): descriptor and data are bumped off the state's
+ * tmparena, free_string() ignores them, and run_statements() drops the
+ * lot after every statement.  copy_string() gives a temporary a durable
+ * copy, so one assigned to a variable or an array element survives.
+ *
  * K&R C v2 compatible
  */
 
 #include "gwbasic.h"
 
+#define STR_SLAB 256        /* Descriptors malloc'ed at a time */
+
+/* At the top of every block in the string heap */
+typedef struct {
+    string_t *owner;        /* Descriptor the data was allocated for */
+    long size;              /* Whole block, header included */
+} strhdr_t;
+
+/* Descriptors are malloc'ed STR_SLAB at a time and chained off the
+   state, so that string_release() can give them back */
+struct strslab_s {
+    struct strslab_s *next;
+    string_t desc[STR_SLAB];
+};
+
+/* alloc_string(0) - shared by everyone, not reference counted */
+static string_t empty_string = {0, STR_STATIC, 1, 0, {0}, empty_string.buf};
+
+/* Block size for a string of len characters - headers stay aligned */
+#define STR_BLOCK(len) ((((long)(len) + (long)sizeof(strhdr_t)) / \
+                         (long)sizeof(strhdr_t) + 1L) * (long)sizeof(strhdr_t))
+
 /*
- * Allocate a string of given length
+ * A descriptor from the free list, refilled a slab at a time
+ * Returns NULL if out of memory
  */
-string_t *
-alloc_string(len)
+static string_t *
+new_descriptor()
+{
+    string_t *str;
+    struct strslab_s *slab;
+    int i;
+
+    str = g_state->strfree;
+    if (!str) {
+        slab = (struct strslab_s *)malloc(sizeof(struct strslab_s));
+        if (!slab) {
+            return NULL;
+        }
+        slab->next = g_state->strslabs;
+        g_state->strslabs = slab;
+        for (i = STR_SLAB - 1; i > 0; i--) {
+            slab->desc[i].ptr = (char *)g_state->strfree;
+            g_state->strfree = &slab->desc[i];
+        }
+        str = &slab->desc[0];
+    } else {
+        g_state->strfree = (string_t *)str->ptr;
+    }
+    str->flags = 0;
+    str->refs = 1;
+    return str;
+}
+
+/*
+ * Take a block for cap characters from the string heap
+ * Returns NULL if it is full
+ */
+static char *
+heap_alloc(str, cap)
+string_t *str;
+int cap;
+{
+    strhdr_t *hdr;
+    long size;
+
+    size = STR_BLOCK(cap);
+    if (!g_state->strheap) {
+        return NULL;
+    }
+    if ((long)(g_state->fretop - g_state->strend) < size) {
+        string_collect();
+        if ((long)(g_state->fretop - g_state->strend) < size) {
+            return NULL;
+        }
+    }
+    g_state->fretop -= size;
+    hdr = (strhdr_t *)(g_state->fretop + size - sizeof(strhdr_t));
+    hdr->owner = str;
+    hdr->size = size;
+    return (char *)g_state->fretop;
+}
+
+/*
+ * Compact the string heap: slide the blocks still owned by their
+ * descriptors up to memsiz, and raise fretop over the space freed
+ */
+void
+string_collect()
+{
+    unsigned char *p;
+    unsigned char *base;
+    unsigned char *dest;
+    strhdr_t *hdr;
+    string_t *owner;
+    long size;
+
+    if (!g_state->strheap) {
+        return;
+    }
+    STAT_INC(string_collect);
+    p = g_state->memsiz;
+    dest = g_state->memsiz;
+    while (p > g_state->fretop) {
+        hdr = (strhdr_t *)(p - sizeof(strhdr_t));
+        owner = hdr->owner;
+        size = hdr->size;
+        base = p - size;
+
+        /* A freed descriptor points elsewhere, or is on the free list */
+        if ((owner->flags & STR_HEAP) && owner->ptr == (char *)base) {
+            dest -= size;
+            if (dest != base) {
+                memmove(dest, base, (size_t)size);
+                owner->ptr = (char *)dest;
+            }
+        }
+        p = base;
+    }
+    g_state->fretop = dest;
+}
+
+/*
+ * Make sure n more bytes of program text fit below the string heap,
+ * collecting it if need be
+ * Returns 1 if they do, 0 if not
+ */
+int
+string_room(n)
+long n;
+{
+    if ((long)(g_state->fretop - g_state->strend) >= n) {
+        return 1;
+    }
+    string_collect();
+    return (long)(g_state->fretop - g_state->strend) >= n;
+}
+
+/*
+ * Give back the descriptor slabs when the state goes away; strings
+ * still held by anything are gone with them, and no more are taken
+ * from the string heap, whose memory is the program buffer
+ */
+void
+string_release()
+{
+    struct strslab_s *slab;
+
+    while ((slab = g_state->strslabs) != NULL) {
+        g_state->strslabs = slab->next;
+        free(slab);
+    }
+    g_state->strfree = NULL;
+    g_state->strheap = 0;
+}
+
+/*
+ * Hand the current state's descriptors, free or not, and their slabs
+ * over to st (a PARALLEL FOR worker's, to the program's)
+ */
+void
+string_give(st)
+state_t *st;
+{
+    struct strslab_s *slab;
+    string_t *str;
+
+    while ((str = g_state->strfree) != NULL) {
+        g_state->strfree = (string_t *)str->ptr;
+        str->ptr = (char *)st->strfree;
+        st->strfree = str;
+    }
+    while ((slab = g_state->strslabs) != NULL) {
+        g_state->strslabs = slab->next;
+        slab->next = st->strslabs;
+        st->strslabs = slab;
+    }
+}
+
+/*
+ * A string of len characters with room for cap: in its own buf, in the
+ * string heap or, failing that, malloc'ed
+ */
+static string_t *
+alloc_room(len, cap)
 int len;
+int cap;
 {
     string_t *str;
 
-    str = (string_t *)malloc(sizeof(string_t));
+    str = new_descriptor();
     if (!str) {
         error(ERR_OUT_OF_STR);
         return NULL;
     }
 
-    if (len > 0) {
-        str->ptr = (char *)malloc(len + 1);
+    if (cap < STR_INLINE) {
+        str->ptr = str->buf;
+        str->cap = STR_INLINE - 1;
+    } else if ((str->ptr = heap_alloc(str, cap)) != NULL) {
+        /* The whole block, which STR_BLOCK() gives back for free_string */
+        str->cap = (int)(STR_BLOCK(cap) - (long)sizeof(strhdr_t)) - 1;
+        str->flags = STR_HEAP;
+    } else {
+        str->ptr = (char *)malloc(cap + 1);
+        str->cap = cap;
         if (!str->ptr) {
-            free(str);
+            str->ptr = (char *)g_state->strfree;
+            g_state->strfree = str;
             error(ERR_OUT_OF_STR);
             return NULL;
         }
-        str->ptr[len] = '\0';
-    } else {
-        str->ptr = NULL;
     }
-
+    str->ptr[len] = '\0';
     str->len = len;
     return str;
 }
 
+/*
+ * Allocate a string of given length
+ */
+string_t *
+alloc_string(len)
+int len;
+{
+    STAT_INC(alloc_string);
+    STAT_ADD(alloc_string_bytes, (long)len);
+    if (len <= 0) {
+        return &empty_string;
+    }
+    return alloc_room(len, len);
+}
+
 /*
  * Free a string
  */
@@ -44,16 +283,31 @@ void
 free_string(str)
 string_t *str;
 {
-    if (str) {
-        if (str->ptr) {
+    if (str && !(str->flags & (STR_STATIC | STR_TEMP))) {
+        if (--str->refs > 0) {
+            return;
+        }
+        STAT_INC(free_string);
+        STAT_ADD(free_string_bytes, (long)str->len);
+        if (str->flags & STR_HEAP) {
+            /* The newest block goes back at once, others wait for
+               string_collect() */
+            if (g_state->strheap &&
+                str->ptr == (char *)g_state->fretop) {
+                g_state->fretop += STR_BLOCK(str->cap);
+            }
+        } else if (str->ptr != str->buf) {
             free(str->ptr);
         }
-        free(str);
+        str->flags = 0;
+        str->ptr = (char *)g_state->strfree;
+        g_state->strfree = str;
     }
 }
 
 /*
- * Copy a string
+ * Copy a string - the copy shares src, which must not change while
+ * both are held; a temporary is copied for real
  */
 string_t *
 copy_string(src)
@@ -64,18 +318,17 @@ string_t *src;
     if (!src) {
         return alloc_string(0);
     }
-
-    dest = alloc_string(src->len);
-    if (!dest) {
-        return NULL;
+    if (src->flags & STR_TEMP) {
+        dest = alloc_string(src->len);
+        if (dest && src->len > 0) {
+            memcpy(dest->ptr, src->ptr, src->len);
+        }
+        return dest;
     }
-
-    if (src->len > 0 && src->ptr) {
-        memcpy(dest->ptr, src->ptr, src->len);
-        dest->ptr[src->len] = '\0';
+    if (!(src->flags & STR_STATIC)) {
+        src->refs++;
     }
-
-    return dest;
+    return src;
 }
 
 /*
@@ -99,7 +352,7 @@ string_t *s2;
         return NULL;
     }
 
-    result = alloc_string(newlen);
+    result = temp_string(newlen);
     if (!result) {
         return NULL;
     }
@@ -115,6 +368,55 @@ string_t *s2;
     return result;
 }
 
+/*
+ * Append src to dest, giving up the caller's hold on dest, and return
+ * the result: dest itself, changed in place, if nothing else holds it
+ * and it has the room.  A new string gets twice the room it needs, so
+ * A$ = A$ + X$ in a loop copies A$ only a few times on its way to 255.
+ */
+string_t *
+append_string(dest, src)
+string_t *dest;
+string_t *src;
+{
+    string_t *result;
+    int newlen;
+    int cap;
+
+    if (!dest) {
+        return copy_string(src);
+    }
+    if (!src || src->len == 0) {
+        return dest;
+    }
+
+    newlen = dest->len + src->len;
+    if (newlen > 255) {
+        error(ERR_STRING_LONG);
+        return dest;
+    }
+
+    if (dest->refs == 1 && !(dest->flags & (STR_STATIC | STR_TEMP)) &&
+        newlen <= dest->cap) {
+        memcpy(dest->ptr + dest->len, src->ptr, src->len);
+        dest->ptr[newlen] = '\0';
+        dest->len = newlen;
+        return dest;
+    }
+
+    cap = newlen * 2 > 255 ? 255 : newlen * 2;
+    STAT_INC(alloc_string);
+    STAT_ADD(alloc_string_bytes, (long)newlen);
+    result = alloc_room(newlen, cap);
+    if (!result) {
+        return dest;
+    }
+    memcpy(result->ptr, dest->ptr, dest->len);
+    memcpy(result->ptr + dest->len, src->ptr, src->len);
+    free_string(dest);
+    return result;
+}
+
 /*
  * Compare two strings
  * Returns: <0 if s1 < s2, 0 if s1 == s2, >0 if s1 > s2
@@ -151,11 +453,45 @@ string_t *s2;
 }
 
 /*
- * Create string from C string
+ * A temporary string of given length, valid until the statement ends
+ * Outside a running program, or when tmparena is full, it is an
+ * ordinary string
  */
 string_t *
-string_from_cstr(cstr)
+temp_string(len)
+int len;
+{
+    string_t *str;
+    int need;
+
+    if (len <= 0) {
+        return &empty_string;
+    }
+    need = (int)sizeof(string_t) + (len < STR_INLINE ? 0 : len + 1);
+    need = (need + (int)sizeof(long) - 1) & ~((int)sizeof(long) - 1);
+    if (!g_state->running || g_state->tmpused + need > TMP_ARENA) {
+        return alloc_string(len);
+    }
+
+    STAT_INC(temp_string);
+    str = (string_t *)((char *)g_state->tmparena + g_state->tmpused);
+    g_state->tmpused += need;
+    str->flags = STR_TEMP;
+    str->refs = 1;
+    str->cap = len;
+    str->ptr = len < STR_INLINE ? str->buf : (char *)(str + 1);
+    str->ptr[len] = '\0';
+    str->len = len;
+    return str;
+}
+
+/*
+ * String from C string, made by alloc
+ */
+static string_t *
+from_cstr(cstr, alloc)
 const char *cstr;
+string_t *(*alloc)();
 {
     string_t *str;
     int len;
@@ -169,7 +505,7 @@ const char *cstr;
         len = 255;
     }
 
-    str = alloc_string(len);
+    str = (*alloc)(len);
     if (!str) {
         return NULL;
     }
@@ -182,6 +518,26 @@ const char *cstr;
     return str;
 }
 
+/*
+ * Create string from C string
+ */
+string_t *
+string_from_cstr(cstr)
+const char *cstr;
+{
+    return from_cstr(cstr, alloc_string);
+}
+
+/*
+ * Temporary string from C string (see temp_string)
+ */
+string_t *
+temp_from_cstr(cstr)
+const char *cstr;
+{
+    return from_cstr(cstr, temp_string);
+}
+
 /*
  * Convert string to C string (caller must free)
  */
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# emitc.sh - Check that translated programs behave like the interpreter
+#
+# Builds each program with --compile (which translates it with --emit-c
+# and links libgwrt.a) and compares its output with the interpreter's
+# (minus the banner).  The generated code must compile without
+# warnings.
+#
+# Usage: test/emitc.sh [prog.bas ...]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+tmp=/tmp/emitc.$$
+
+if [ $# -eq 0 ]; then
+    set -- test/run_all_tests.bas test/emitc_arrays.bas
+fi
+
+status=0
+for prog in "$@"; do
+    if ! $GWBASIC --compile $prog -o $tmp 2> $tmp.err; then
+        cat $tmp.err
+        echo "$prog: translation failed"
+        status=1
+        continue
+    fi
+    if grep -q warning $tmp.err; then
+        cat $tmp.err
+        echo "$prog: compiler warnings"
+        status=1
+    fi
+    $tmp < /dev/null > $tmp.out 2>&1
+    $GWBASIC $prog < /dev/null 2>&1 | tail -n +6 > $tmp.ref
+    if cmp -s $tmp.ref $tmp.out; then
+        echo "$prog: ok"
+    else
+        echo "$prog: output differs"
+        diff $tmp.ref $tmp.out
+        status=1
+    fi
+done
+
+rm -f $tmp $tmp.out $tmp.ref $tmp.err
+exit $status
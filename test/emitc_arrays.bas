@@ -0,0 +1,9 @@
+10 REM Array references side by side and nested in one statement
+20 DIM A(10), B%(3, 3)
+30 FOR J = 0 TO 10: A(J) = J * J: NEXT J
+40 FOR J = 0 TO 3: B%(J, 3 - J) = J + 1: NEXT J
+50 PRINT A(3) - A(4); A(A(2)) + A(A(1) + 1) * A(5)
+60 PRINT B%(0, 3) * 10 + B%(3, 0); B%(B%(0, 3), 2) - B%(2, B%(0, 3))
+70 IF A(2) < A(3) THEN PRINT A(10) / A(5) ELSE PRINT "WRONG"
+80 A(A(1)) = A(2) + A(3): PRINT A(1)
+90 END
@@ -0,0 +1,18 @@
+10 REM PARALLEL FOR checks - run with GWBASIC_THREADS=4 (test/parallel.sh)
+20 DIM A(7)
+30 FOR I = 0 TO 7 PARALLEL
+40 A(I) = INT(RND(1) * 100000)
+50 NEXT I
+60 REM Each chunk draws its own random numbers
+70 SAME = 0
+80 FOR I = 0 TO 5: FOR K = I + 1 TO 7
+90 IF A(I) = A(K) THEN SAME = SAME + 1
+100 NEXT K: NEXT I
+110 IF SAME = 0 THEN 130
+120 PRINT "FAIL: CHUNKS REPEAT RND"; A(0); A(2); A(4); A(6): STOP
+130 REM The program's own sequence moves past the loop
+140 X = INT(RND(1) * 100000)
+150 FOR I = 0 TO 7
+160 IF X = A(I) THEN PRINT "FAIL: RND NOT ADVANCED": STOP
+170 NEXT I
+180 PRINT "PARALLEL RND: PASSED"
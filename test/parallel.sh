@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# parallel.sh - Run the PARALLEL FOR checks with several threads
+#
+# test/parallel.bas checks itself and ends with a PASSED line; it is
+# run with GWBASIC_THREADS set so that the loop is split even on a
+# single processor.
+#
+# Usage: test/parallel.sh [threads ...]
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+
+if [ $# -eq 0 ]; then
+    set -- 2 4
+fi
+
+status=0
+for n in "$@"; do
+    out=`GWBASIC_THREADS=$n $GWBASIC test/parallel.bas < /dev/null 2>&1`
+    if echo "$out" | grep -q PASSED; then
+        echo "test/parallel.bas ($n threads): ok"
+    else
+        echo "test/parallel.bas ($n threads): failed"
+        echo "$out" | tail -n +6
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,15 @@
+10 REM PEEK/POKE on the private segment
+20 POKE 100, 42
+30 IF PEEK(100) = 42 THEN 50
+40 PRINT "FAIL: PEEK(100) <> 42": STOP
+50 POKE 200, "ABC"
+60 IF PEEK$(200, 3) = "ABC" THEN 80
+70 PRINT "FAIL: PEEK$(200,3) <> ABC": STOP
+80 IF ATOMADD(0, 3) = 3 THEN 100
+90 PRINT "FAIL: ATOMADD": STOP
+100 IF ATOMCAS(0, 3, 7) = 3 THEN 120
+110 PRINT "FAIL: ATOMCAS": STOP
+120 IF ATOMADD(0, 0) = 7 THEN 140
+130 PRINT "FAIL: ATOMCAS DID NOT STORE": STOP
+140 PRINT "PEEK/POKE: PASS"
+150 END
@@ -0,0 +1,8 @@
+10 REM Line counts for test/profile.sh
+20 FOR I = 1 TO 5
+30 GOSUB 100: X = X + 1
+40 NEXT I
+50 FOR J = 1 TO 3: Y = Y + J: NEXT J
+60 END
+100 Z = Z + 1
+110 RETURN
@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# profile.sh - Check the line counts of --profile
+#
+# A line is counted when it is entered at its start, not again when a
+# RETURN or NEXT comes back into the middle of it.
+#
+# Usage: test/profile.sh
+#
+
+GWBASIC=${GWBASIC:-./gwbasic}
+tmp=/tmp/profile.$$
+
+# line count, sorted by line
+cat > $tmp.ref <<'END'
+10 1
+20 1
+30 5
+40 5
+50 1
+60 1
+100 5
+110 5
+END
+
+$GWBASIC --profile test/profile.bas < /dev/null 2>&1 > /dev/null |
+    awk '$1 ~ /^[0-9]+$/ { print $1, $2 }' | sort -n > $tmp.out
+if cmp -s $tmp.ref $tmp.out; then
+    echo "test/profile.bas: ok"
+    status=0
+else
+    echo "test/profile.bas: counts differ"
+    diff $tmp.ref $tmp.out
+    status=1
+fi
+
+rm -f $tmp.ref $tmp.out
+exit $status
@@ -241,16 +241,24 @@
 2410 TESTCOUNT = TESTCOUNT + 1
 2420 IFRESULT = 0
 2430 IF 1 = 2 THEN IFRESULT = 1 ELSE IFRESULT = 2
-2440 IF IFRESULT = 2 THEN 2460
+2440 IF IFRESULT = 2 THEN 2452
 2450 PRINT "FAIL: IF FALSE ELSE": STOP
-2460 PRINT "  IF/THEN/ELSE: PASS"
-2470 REM
+2452 TESTCOUNT = TESTCOUNT + 1
+2454 IFRESULT = 0: IF 1 = 1 THEN GOSUB 2500: IFRESULT = 3 ELSE IFRESULT = 4
+2456 IF IFRESULT = 3 THEN 2462
+2458 PRINT "FAIL: ELSE AFTER GOSUB IN THEN": STOP
+2462 TESTCOUNT = TESTCOUNT + 1
+2464 IFRESULT = 5: ELSE IFRESULT = 6
+2466 IF IFRESULT = 5 THEN 2470
+2468 PRINT "FAIL: ELSE OUTSIDE IF": STOP
+2470 PRINT "  IF/THEN/ELSE: PASS"
+2472 REM
 2480 REM === ALL TESTS PASSED ===
 2490 GOTO 2540
 2500 GOSUBRESULT = 1
 2510 RETURN
 2520 GOSUB 2500
-2530 GOSUBRESULT = GOSUBRESULT + 1
+2530 GOSUBRESULT = GOSUBRESULT + 1: RETURN
 2540 PRINT
 2550 PRINT "================================"
 2560 PRINT "ALL "; TESTCOUNT; " TESTS PASSED!"
@@ -0,0 +1,10 @@
+10 REM DEF USR / CALL with functions from the C library
+20 DEF USR0 = "", "strlen", "l:s"
+30 DEF USR1 = "", "abs", "i:i"
+40 IF USR0("HELLO") = 5 THEN 60
+50 PRINT "FAIL: USR0(HELLO) <> 5": STOP
+60 IF USR1(-42) = 42 THEN 80
+70 PRINT "FAIL: USR1(-42) <> 42": STOP
+80 CALL USR0("")
+90 PRINT "USR CALL: PASS"
+100 END
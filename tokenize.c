@@ -72,6 +72,10 @@ static keyword_t keywords[] = {
     {"SYSTEM", TOK_SYSTEM},
     {"CHAIN", TOK_CHAIN},
     {"COMMON", TOK_COMMON},
+    {"CALL", TOK_CALL},
+    {"PROFILE", TOK_PROFILE},
+    {"STATS", TOK_STATS},
+    {"MEMSTAT", TOK_MEMSTAT},
     {"TAB", TOK_TAB},
     {"TO", TOK_TO},
     {"THEN", TOK_THEN},
@@ -105,6 +109,11 @@ static keyword_t keywords[] = {
     {"RIGHT$", TOK_RIGHT},
     {"MID$", TOK_MID},
     {"INSTR", TOK_INSTR},
+    {"PARALLEL", TOK_PARALLEL},
+    {"REDUCE", TOK_REDUCE},
+    {"ATOMADD", TOK_ATOMADD},
+    {"ATOMCAS", TOK_ATOMCAS},
+    {"TIMER", TOK_TIMER},
     /* Operators - needed for detokenization */
     {"=", TOK_EQ},
     {"+", TOK_PLUS},
@@ -157,6 +166,23 @@ const char *word;
     return 0; /* Not a keyword */
 }
 
+/*
+ * Keyword for a token, NULL if there is none
+ */
+const char *
+token_name(token)
+int token;
+{
+    int i;
+
+    for (i = 0; keywords[i].keyword != NULL; i++) {
+        if (keywords[i].token == token) {
+            return keywords[i].keyword;
+        }
+    }
+    return NULL;
+}
+
 /*
  * Check if character is valid in identifier
  */
@@ -194,6 +220,9 @@ int *len;
     int allocated;
     int offset;
 
+    STAT_INC(tokenize_line);
+    STAT_ADD(tokenize_bytes, (long)strlen(line));
+
     /* Allocate token buffer */
     allocated = BUFLEN * 2;
     tokens = (unsigned char *)malloc(allocated);
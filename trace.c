@@ -0,0 +1,182 @@
+/*
+ * trace.c - Binary execution trace in a memory-mapped ring file
+ *
+ * --trace FILE records every statement a program executes as a small
+ * fixed-size record: line number, statement token and, with
+ * --trace-time, the time since the start.  FILE holds a trace_hdr_t
+ * and a ring of records (see gwbasic.h); once full, the oldest records
+ * are overwritten.  The file is mapped shared, so writing a record is
+ * a couple of stores and the kernel gets the data to disk even if the
+ * interpreter is killed, which makes tracing long runs affordable.
+ *
+ * gwtrace turns the file into text.  When a traced program stops with
+ * an error the last statements are also listed on stderr.
+ *
+ * TRON still prints line numbers; the two can be used together.
+ * Traced lines are always interpreted, never JIT compiled.
+ *
+ * K&R C v2 compatible
+ */
+
+#include "gwbasic.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TRACE_RECS 65536L   /* Default ring size, GWBASIC_TRACE_SIZE */
+
+/* --trace: trace every program from its first statement */
+int trace_on = 0;
+
+static trace_hdr_t *hdr;    /* Mapped file */
+static char *recs;          /* First record */
+static double start;        /* Time of trace_start() */
+
+/*
+ * Record the statement at txtptr
+ */
+void
+trace_statement()
+{
+    trace_rec_t *r;
+    unsigned char *p;
+
+    if (!hdr || g_state->curlin < 0) {
+        return;
+    }
+    r = (trace_rec_t *)(recs + (hdr->count % (unsigned long)hdr->nrecs) *
+                        (unsigned long)hdr->recsize);
+    p = g_state->txtptr;
+    r->line = g_state->curlin;
+    if (!(p[0] & 0x80)) {
+        r->token = 0;
+    } else if (p[0] == 0xFF) {
+        r->token = (unsigned short)(0xFF00 | p[1]);
+    } else {
+        r->token = p[0];
+    }
+    r->pad = 0;
+    if (hdr->recsize == sizeof(trace_rec_t)) {
+        r->time = clock_mono() - start;
+    }
+    hdr->count++;
+}
+
+/*
+ * List the last n statements recorded
+ */
+void
+trace_tail(fp, n)
+FILE *fp;
+int n;
+{
+    trace_rec_t *r;
+    const char *name;
+    unsigned long i;
+
+    if (!hdr || !(g_state->profiling & PROF_TRACE) || hdr->count == 0) {
+        return;
+    }
+    i = hdr->count > (unsigned long)n ? hdr->count - n : 0UL;
+    if (hdr->count - i > (unsigned long)hdr->nrecs) {
+        i = hdr->count - hdr->nrecs;
+    }
+    fprintf(fp, "Last statements:\n");
+    for (; i < hdr->count; i++) {
+        r = (trace_rec_t *)(recs + (i % (unsigned long)hdr->nrecs) *
+                            (unsigned long)hdr->recsize);
+        name = r->token ? token_name(r->token) : "LET";
+        fprintf(fp, "%7d  %s\n", r->line, name ? name : "?");
+    }
+}
+
+/*
+ * Map the ring file and start tracing
+ * Returns 0 on success, -1 if the file can't be set up
+ */
+int
+trace_start(name, timed)
+const char *name;
+int timed;
+{
+    char *env;
+    long nrecs;
+    long size;
+    void *map;
+    int fd;
+
+    nrecs = TRACE_RECS;
+    env = getenv("GWBASIC_TRACE_SIZE");
+    if (env && atol(env) > 0) {
+        nrecs = atol(env);
+    }
+
+    hdr = NULL;
+    size = (long)sizeof(trace_hdr_t) +
+           nrecs * (long)(timed ? sizeof(trace_rec_t) : 8);
+    fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+    map = mmap((void *)0, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, (off_t)0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    hdr = (trace_hdr_t *)map;
+    memcpy(hdr->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    hdr->recsize = timed ? (int)sizeof(trace_rec_t) : 8;
+    hdr->nrecs = (int)nrecs;
+    hdr->count = 0UL;
+    recs = (char *)map + sizeof(trace_hdr_t);
+    start = clock_mono();
+    trace_on = 1;
+    return 0;
+}
+
+#else
+
+/*
+ * No mmap on this system
+ */
+int trace_on = 0;
+
+int
+trace_start(name, timed)
+const char *name;
+int timed;
+{
+    /* Timestamp flag unused - suppress warnings */
+    if (timed) {
+        /* do nothing */
+    }
+    fprintf(stderr, "Tracing is not supported: %s not written\n", name);
+    return -1;
+}
+
+void
+trace_statement()
+{
+}
+
+void
+trace_tail(fp, n)
+FILE *fp;
+int n;
+{
+    /* Arguments unused - suppress warnings */
+    if (fp && n) {
+        /* do nothing */
+    }
+}
+
+#endif
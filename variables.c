@@ -72,6 +72,7 @@ int create;
     char normname[NAMLEN+1];
     int type;
 
+    STAT_INC(find_variable);
     type = 0;
     normalize_name(normname, name, &type);
 
@@ -79,6 +80,7 @@ int create;
     if (g_state->lastvar &&
         strcmp(g_state->lastvar->name, normname) == 0 &&
         g_state->lastvar->type == type) {
+        STAT_INC(lastvar_hits);
         return g_state->lastvar;
     }
 
@@ -226,6 +228,9 @@ clear_variables()
     var_t *var;
     var_t *next;
 
+    /* Compiled code refers to the variables */
+    jit_release();
+
     for (var = g_state->varlist; var != NULL; var = next) {
         next = var->next;
 